@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "content_hash.hpp"
+#include <cstring> // std::memcpy
+#include <algorithm> // std::min
+
+static const uint64_t c1 = 0x87c37b91114253d5;
+static const uint64_t c2 = 0x4cf5ad432745937f;
+
+static inline uint64_t rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+static inline uint64_t fmix(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccd;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53;
+	k ^= k >> 33;
+	return k;
+}
+
+std::string reshade::content_hash::to_string() const
+{
+	static const char hex_digits[] = "0123456789abcdef";
+
+	std::string result(32, '0');
+	for (size_t i = 0; i < 16; ++i)
+	{
+		result[15 - i] = hex_digits[(low >> (i * 4)) & 0xF];
+		result[31 - i] = hex_digits[(high >> (i * 4)) & 0xF];
+	}
+	return result;
+}
+
+reshade::content_hasher &reshade::content_hasher::update(const void *data, size_t size)
+{
+	auto bytes = static_cast<const uint8_t *>(data);
+	_length += size;
+
+	// Complete a block that was started by a previous call first
+	if (_tail_size != 0)
+	{
+		const size_t count = std::min(size, sizeof(_tail) - _tail_size);
+		std::memcpy(_tail + _tail_size, bytes, count);
+		_tail_size += count;
+		bytes += count;
+		size -= count;
+
+		if (_tail_size < sizeof(_tail))
+			return *this;
+
+		process_block(_tail);
+		_tail_size = 0;
+	}
+
+	for (; size >= sizeof(_tail); bytes += sizeof(_tail), size -= sizeof(_tail))
+		process_block(bytes);
+
+	// Keep the remaining bytes around until the block is complete (or the hash is finalized)
+	std::memcpy(_tail, bytes, size);
+	_tail_size = size;
+
+	return *this;
+}
+reshade::content_hasher &reshade::content_hasher::update(std::string_view data)
+{
+	const uint64_t length = data.size();
+	update(&length, sizeof(length));
+	return update(data.data(), data.size());
+}
+
+reshade::content_hash reshade::content_hasher::finalize() const
+{
+	uint64_t h1 = _h1;
+	uint64_t h2 = _h2;
+
+	// Mixing in a partial block that is zero-padded is the same as skipping the missing bytes, since zero stays zero through the multiplications
+	uint64_t k1 = 0, k2 = 0;
+	for (size_t i = 0; i < _tail_size && i < 8; ++i)
+		k1 |= static_cast<uint64_t>(_tail[i]) << (i * 8);
+	for (size_t i = 8; i < _tail_size; ++i)
+		k2 |= static_cast<uint64_t>(_tail[i]) << ((i - 8) * 8);
+
+	k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+	k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+
+	h1 ^= _length;
+	h2 ^= _length;
+	h1 += h2;
+	h2 += h1;
+	h1 = fmix(h1);
+	h2 = fmix(h2);
+	h1 += h2;
+	h2 += h1;
+
+	return { h1, h2 };
+}
+
+void reshade::content_hasher::process_block(const uint8_t *block)
+{
+	uint64_t k1, k2;
+	std::memcpy(&k1, block, sizeof(k1));
+	std::memcpy(&k2, block + sizeof(k1), sizeof(k2));
+
+	k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; _h1 ^= k1;
+	_h1 = rotl(_h1, 27); _h1 += _h2; _h1 = _h1 * 5 + 0x52dce729;
+
+	k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; _h2 ^= k2;
+	_h2 = rotl(_h2, 31); _h2 += _h1; _h2 = _h2 * 5 + 0x38495ab5;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <string_view>
+
+namespace reshade
+{
+	/// <summary>
+	/// A 128-bit hash of some content, used to name cache entries after what they were generated from.
+	/// </summary>
+	struct content_hash
+	{
+		uint64_t low = 0;
+		uint64_t high = 0;
+
+		bool operator==(const content_hash &other) const { return low == other.low && high == other.high; }
+		bool operator!=(const content_hash &other) const { return low != other.low || high != other.high; }
+
+		/// <summary>
+		/// Format the hash as 32 hexadecimal digits, so that it can be used in file names.
+		/// </summary>
+		std::string to_string() const;
+	};
+
+	/// <summary>
+	/// Computes the 128-bit MurmurHash3 (x64 variant) of a stream of data.
+	/// Unlike 'std::hash' the result is the same in every build, so it can be stored in files and compared later.
+	/// </summary>
+	class content_hasher
+	{
+	public:
+		/// <summary>
+		/// Add raw bytes to the hashed data.
+		/// </summary>
+		content_hasher &update(const void *data, size_t size);
+		/// <summary>
+		/// Add a string to the hashed data. The length is hashed too, so that consecutive strings cannot be confused with differently split ones.
+		/// </summary>
+		content_hasher &update(std::string_view data);
+
+		/// <summary>
+		/// Returns the hash of all data added so far.
+		/// </summary>
+		content_hash finalize() const;
+
+	private:
+		void process_block(const uint8_t *block);
+
+		uint64_t _h1 = 0;
+		uint64_t _h2 = 0;
+		uint64_t _length = 0;
+		uint8_t _tail[16] = {};
+		size_t _tail_size = 0;
+	};
+}
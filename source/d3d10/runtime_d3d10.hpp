@@ -24,6 +24,7 @@ namespace reshade::d3d10
 		bool capture_screenshot(uint8_t *buffer) const override;
 
 	private:
+		bool compile_entry_point(const effect &effect, const reshadefx::entry_point &entry_point, std::vector<char> &cso, std::string &assembly, std::string &errors) override;
 		bool init_effect(size_t index) override;
 		void unload_effect(size_t index) override;
 		void unload_effects() override;
@@ -37,7 +37,8 @@ namespace reshade::d3d11
 
 	struct d3d11_effect_data
 	{
-		com_ptr<ID3D11Buffer> cb;
+		// Constant buffers for uniform variables that are only changed by the user (b0) and for those that are updated every frame (b1)
+		com_ptr<ID3D11Buffer> cb[2];
 	};
 
 	struct d3d11_technique_data
@@ -218,6 +219,15 @@ bool reshade::d3d11::runtime_d3d11::on_init(const DXGI_SWAP_CHAIN_DESC &swap_des
 		return false;
 #endif
 
+	// Load the HLSL compiler here already, since 'compile_entry_point' is called from worker threads
+	if (_d3d_compiler == nullptr)
+		_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
+	if (_d3d_compiler == nullptr)
+		_d3d_compiler = LoadLibraryW(L"d3dcompiler_43.dll");
+
+	if (_d3d_compiler == nullptr)
+		LOG(ERROR) << "Unable to load HLSL compiler (\"d3dcompiler_47.dll\")." << " Make sure you have the DirectX end-user runtime (June 2010) installed or a newer version of the library in the application directory.";
+
 	// Clear reference to make Unreal Engine 4 happy (which checks the reference count)
 	_backbuffer->Release();
 
@@ -405,114 +415,123 @@ bool reshade::d3d11::runtime_d3d11::capture_screenshot(uint8_t *buffer) const
 	return true;
 }
 
-bool reshade::d3d11::runtime_d3d11::init_effect(size_t index)
+bool reshade::d3d11::runtime_d3d11::compile_entry_point(const effect &effect, const reshadefx::entry_point &entry_point, std::vector<char> &cso, std::string &assembly, std::string &errors)
 {
-	if (_d3d_compiler == nullptr)
-		_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
-	if (_d3d_compiler == nullptr)
-		_d3d_compiler = LoadLibraryW(L"d3dcompiler_43.dll");
-
 	if (_d3d_compiler == nullptr)
 	{
-		LOG(ERROR) << "Unable to load HLSL compiler (\"d3dcompiler_47.dll\")." << " Make sure you have the DirectX end-user runtime (June 2010) installed or a newer version of the library in the application directory.";
+		errors += "Unable to load HLSL compiler (\"d3dcompiler_47.dll\").";
 		return false;
 	}
 
-	effect &effect = _effects[index];
-
 	const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(_d3d_compiler, "D3DCompile"));
 	const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(_d3d_compiler, "D3DDisassemble"));
 
 	const std::string hlsl = effect.preamble + effect.module.hlsl;
-	std::unordered_map<std::string, com_ptr<IUnknown>> entry_points;
 
-	// Compile the generated HLSL source code to DX byte code
-	for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
+	std::string profile;
+	switch (entry_point.type)
 	{
-		HRESULT hr = E_FAIL;
-
-		std::string profile;
-		switch (entry_point.type)
+	case reshadefx::shader_type::vs:
+		profile = "vs";
+		break;
+	case reshadefx::shader_type::ps:
+		profile = "ps";
+		break;
+	case reshadefx::shader_type::cs:
+		profile = "cs";
+		// Feature level 10 and 10.1 support a limited form of DirectCompute, but it does not have support for RWTexture2D, so it is not useful here
+		// See https://docs.microsoft.com/windows/win32/direct3d11/direct3d-11-advanced-stages-compute-shader
+		if (_renderer_id < D3D_FEATURE_LEVEL_11_0)
 		{
-		case reshadefx::shader_type::vs:
-			profile = "vs";
-			break;
-		case reshadefx::shader_type::ps:
-			profile = "ps";
-			break;
-		case reshadefx::shader_type::cs:
-			profile = "cs";
-			// Feature level 10 and 10.1 support a limited form of DirectCompute, but it does not have support for RWTexture2D, so it is not useful here
-			// See https://docs.microsoft.com/windows/win32/direct3d11/direct3d-11-advanced-stages-compute-shader
-			if (_renderer_id < D3D_FEATURE_LEVEL_11_0)
-			{
-				effect.errors += "Compute shaders are not supported in ";
-				effect.errors += "D3D10";
-				effect.errors += '.';
-				return false;
-			}
-			break;
+			errors += "Compute shaders are not supported in ";
+			errors += "D3D10";
+			errors += '.';
+			return false;
 		}
+		break;
+	}
 
-		switch (_renderer_id)
-		{
-		default:
-		case D3D_FEATURE_LEVEL_11_0:
-			profile += "_5_0";
-			break;
-		case D3D_FEATURE_LEVEL_10_1:
-			profile += "_4_1";
-			break;
-		case D3D_FEATURE_LEVEL_10_0:
-			profile += "_4_0";
-			break;
-		case D3D_FEATURE_LEVEL_9_1:
-		case D3D_FEATURE_LEVEL_9_2:
-			profile += "_4_0_level_9_1";
-			break;
-		case D3D_FEATURE_LEVEL_9_3:
-			profile += "_4_0_level_9_3";
-			break;
-		}
+	switch (_renderer_id)
+	{
+	default:
+	case D3D_FEATURE_LEVEL_11_0:
+		profile += "_5_0";
+		break;
+	case D3D_FEATURE_LEVEL_10_1:
+		profile += "_4_1";
+		break;
+	case D3D_FEATURE_LEVEL_10_0:
+		profile += "_4_0";
+		break;
+	case D3D_FEATURE_LEVEL_9_1:
+	case D3D_FEATURE_LEVEL_9_2:
+		profile += "_4_0_level_9_1";
+		break;
+	case D3D_FEATURE_LEVEL_9_3:
+		profile += "_4_0_level_9_3";
+		break;
+	}
 
-		std::string attributes;
-		attributes += "func=D3DCompile;";
-		attributes += "name=(null);defines=(null);include=(null);";
-		attributes += "entrypoint=" + entry_point.name + ';';
-		attributes += "profile=" + profile + ';';
-		attributes += "compile=" + std::to_string(D3DCOMPILE_ENABLE_STRICTNESS | (_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1)) + ';';
-		attributes += "effect=0;";
-
-		const size_t hash = std::hash<std::string_view>()(attributes) ^ std::hash<std::string_view>()(hlsl);
-		std::vector<char> cso;
-		if (!load_effect_cache(effect.source_file, entry_point.name, hash, cso, effect.assembly[entry_point.name]))
-		{
-			com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
-			hr = D3DCompile(
-				hlsl.data(), hlsl.size(),
-				nullptr, nullptr, nullptr,
-				entry_point.name.c_str(),
-				profile.c_str(),
-				D3DCOMPILE_ENABLE_STRICTNESS | (_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1), 0,
-				&d3d_compiled, &d3d_errors);
+	std::string attributes;
+	attributes += "func=D3DCompile;";
+	attributes += "name=(null);defines=(null);include=(null);";
+	attributes += "entrypoint=" + entry_point.name + ';';
+	attributes += "profile=" + profile + ';';
+	attributes += "compile=" + std::to_string(D3DCOMPILE_ENABLE_STRICTNESS | (_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1)) + ';';
+	attributes += "effect=0;";
+
+	const content_hash hash = content_hasher().update(attributes).update(hlsl).finalize();
+	if (load_effect_cache(effect.source_file, entry_point.name, hash, cso, assembly))
+		return true;
+
+	// A D3DCompile call cannot be interrupted once it was started, so this is the last chance to skip the compilation if the load it belongs to was cancelled
+	if (job_system::is_current_job_cancelled())
+		return false;
+
+	// Compile the generated HLSL source code to DX byte code
+	com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
+	const HRESULT hr = D3DCompile(
+		hlsl.data(), hlsl.size(),
+		nullptr, nullptr, nullptr,
+		entry_point.name.c_str(),
+		profile.c_str(),
+		D3DCOMPILE_ENABLE_STRICTNESS | (_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1), 0,
+		&d3d_compiled, &d3d_errors);
+
+	if (d3d_errors != nullptr) // Append warnings to the output error string as well
+		errors.append(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
+
+	if (FAILED(hr))
+		return false;
 
-			if (d3d_errors != nullptr) // Append warnings to the output error string as well
-				effect.errors.append(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
+	cso.resize(d3d_compiled->GetBufferSize());
+	std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
 
-			// No need to setup resources if any of the shaders failed to compile
-			if (FAILED(hr))
-				return false;
+	// D3DDisassemble cannot be interrupted either and is only needed for the cache, so skip it too if the load was cancelled in the meantime
+	if (job_system::is_current_job_cancelled())
+		return false;
 
-			cso.resize(d3d_compiled->GetBufferSize());
-			std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
+	if (com_ptr<ID3DBlob> d3d_disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
+		assembly.assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
 
-			if (com_ptr<ID3DBlob> d3d_disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
-				effect.assembly[entry_point.name].assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
+	save_effect_cache(effect.source_file, entry_point.name, hash, cso, assembly);
 
-			save_effect_cache(effect.source_file, entry_point.name, hash, cso, effect.assembly[entry_point.name]);
-		}
+	return true;
+}
+
+bool reshade::d3d11::runtime_d3d11::init_effect(size_t index)
+{
+	effect &effect = _effects[index];
+
+	std::unordered_map<std::string, com_ptr<IUnknown>> entry_points;
+
+	// Create runtime shader objects from the DX byte code that was compiled in 'compile_entry_point'
+	for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
+	{
+		HRESULT hr = E_FAIL;
+
+		const std::vector<char> &cso = effect.compiled_entry_points.at(entry_point.name);
 
-		// Create runtime shader objects from the compiled DX byte code
 		switch (entry_point.type)
 		{
 		case reshadefx::shader_type::vs:
@@ -537,12 +556,20 @@ bool reshade::d3d11::runtime_d3d11::init_effect(size_t index)
 		_effect_data.resize(index + 1);
 	d3d11_effect_data &effect_data = _effect_data[index];
 
-	if (!effect.uniform_data_storage.empty())
+	// Uniform variables updated every frame are packed at the end of the storage, so split it into two constant buffers there
+	const UINT per_frame_offset = (effect.module.per_frame_uniform_offset + 15) & ~15;
+	const UINT cb_offsets[2] = { 0, per_frame_offset };
+	const UINT cb_sizes[2] = { per_frame_offset, static_cast<UINT>(effect.uniform_data_storage.size()) - per_frame_offset };
+
+	for (UINT i = 0; i < 2; ++i)
 	{
-		const D3D11_BUFFER_DESC desc = { static_cast<UINT>(effect.uniform_data_storage.size()), D3D11_USAGE_DYNAMIC, D3D11_BIND_CONSTANT_BUFFER, D3D11_CPU_ACCESS_WRITE };
-		const D3D11_SUBRESOURCE_DATA initial_data = { effect.uniform_data_storage.data(), desc.ByteWidth };
+		if (cb_sizes[i] == 0)
+			continue;
+
+		const D3D11_BUFFER_DESC desc = { cb_sizes[i], D3D11_USAGE_DYNAMIC, D3D11_BIND_CONSTANT_BUFFER, D3D11_CPU_ACCESS_WRITE };
+		const D3D11_SUBRESOURCE_DATA initial_data = { effect.uniform_data_storage.data() + cb_offsets[i], desc.ByteWidth };
 
-		if (HRESULT hr = _device->CreateBuffer(&desc, &initial_data, &effect_data.cb); FAILED(hr))
+		if (HRESULT hr = _device->CreateBuffer(&desc, &initial_data, &effect_data.cb[i]); FAILED(hr))
 		{
 			LOG(ERROR) << "Failed to create constant buffer for effect file '" << effect.source_file << "'! HRESULT is " << hr << '.';
 			LOG(DEBUG) << "> Details: Width = " << desc.ByteWidth;
@@ -821,7 +848,10 @@ void reshade::d3d11::runtime_d3d11::unload_effect(size_t index)
 	runtime::unload_effect(index);
 
 	if (index < _effect_data.size())
-		_effect_data[index].cb.reset();
+	{
+		_effect_data[index].cb[0].reset();
+		_effect_data[index].cb[1].reset();
+	}
 }
 void reshade::d3d11::runtime_d3d11::unload_effects()
 {
@@ -1058,33 +1088,45 @@ void reshade::d3d11::runtime_d3d11::render_technique(technique &technique)
 	_immediate_context->CSSetSamplers(0, static_cast<UINT>(impl->sampler_states.size()), reinterpret_cast<ID3D11SamplerState *const *>(impl->sampler_states.data()));
 
 	// Setup shader constants
-	if (ID3D11Buffer *const cb = effect_data.cb.get(); cb != nullptr)
+	effect &effect = _effects[technique.effect_index];
+	const UINT per_frame_offset = (effect.module.per_frame_uniform_offset + 15) & ~15;
+
+	for (UINT i = 0; i < 2; ++i)
 	{
+		ID3D11Buffer *const cb = effect_data.cb[i].get();
+		if (cb == nullptr)
+			continue;
+
+		// The constant buffer with uniform variables updated every frame is always uploaded, the other one only after a value in it changed
 		if (D3D11_MAPPED_SUBRESOURCE mapped;
-			SUCCEEDED(_immediate_context->Map(cb, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+			(i != 0 || effect.uniform_data_dirty) && SUCCEEDED(_immediate_context->Map(cb, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
 		{
-			std::memcpy(mapped.pData, _effects[technique.effect_index].uniform_data_storage.data(), mapped.RowPitch);
+			std::memcpy(mapped.pData, effect.uniform_data_storage.data() + (i != 0 ? per_frame_offset : 0), mapped.RowPitch);
 			_immediate_context->Unmap(cb, 0);
 		}
 
-		_immediate_context->VSSetConstantBuffers(0, 1, &cb);
-		_immediate_context->PSSetConstantBuffers(0, 1, &cb);
-		_immediate_context->CSSetConstantBuffers(0, 1, &cb);
+		_immediate_context->VSSetConstantBuffers(i, 1, &cb);
+		_immediate_context->PSSetConstantBuffers(i, 1, &cb);
+		_immediate_context->CSSetConstantBuffers(i, 1, &cb);
 	}
 
+	effect.uniform_data_dirty = false;
+
 	// Disable unused pipeline stages
 	_immediate_context->HSSetShader(nullptr, nullptr, 0);
 	_immediate_context->DSSetShader(nullptr, nullptr, 0);
 	_immediate_context->GSSetShader(nullptr, nullptr, 0);
 
 	bool is_effect_stencil_cleared = false;
-	bool needs_implicit_backbuffer_copy = true; // First pass always needs the back buffer updated
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
-		if (needs_implicit_backbuffer_copy)
+		if (technique.culled_passes[pass_index])
+			continue; // Nothing uses the output of this pass, so can skip it
+
+		if (_backbuffer_copy_planner.next_pass(technique.pass_accesses[pass_index]))
 		{
-			// Save back buffer of previous pass
+			// Save back buffer of previous pass, since this pass samples it
 			_immediate_context->CopyResource(_backbuffer_texture.get(), _backbuffer_resolved.get());
 		}
 
@@ -1183,8 +1225,6 @@ void reshade::d3d11::runtime_d3d11::render_technique(technique &technique)
 			ID3D11ShaderResourceView *null_srv[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = { nullptr };
 			_immediate_context->VSSetShaderResources(0, static_cast<UINT>(pass_data.srvs.size()), null_srv);
 			_immediate_context->PSSetShaderResources(0, static_cast<UINT>(pass_data.srvs.size()), null_srv);
-
-			needs_implicit_backbuffer_copy = false;
 		}
 
 		// Generate mipmaps for modified resources
@@ -1192,10 +1232,7 @@ void reshade::d3d11::runtime_d3d11::render_technique(technique &technique)
 		{
 			if (resource == _backbuffer_texture_srv[0] ||
 				resource == _backbuffer_texture_srv[1])
-			{
-				needs_implicit_backbuffer_copy = true;
-				break;
-			}
+				break; // The back buffer has no mipmaps
 
 			D3D11_SHADER_RESOURCE_VIEW_DESC resource_desc;
 			resource->GetDesc(&resource_desc);
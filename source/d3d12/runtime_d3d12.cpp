@@ -43,7 +43,8 @@ namespace reshade::d3d12
 		com_ptr<ID3D12DescriptorHeap> srv_uav_heap;
 		com_ptr<ID3D12DescriptorHeap> sampler_heap;
 
-		D3D12_GPU_VIRTUAL_ADDRESS cbv_gpu_address;
+		UINT64 cb_per_frame_offset;
+		D3D12_GPU_VIRTUAL_ADDRESS cbv_gpu_address[2];
 		D3D12_CPU_DESCRIPTOR_HANDLE srv_cpu_base;
 		D3D12_GPU_DESCRIPTOR_HANDLE srv_gpu_base;
 		D3D12_CPU_DESCRIPTOR_HANDLE rtv_cpu_base;
@@ -325,6 +326,13 @@ bool reshade::d3d12::runtime_d3d12::on_init(const DXGI_SWAP_CHAIN_DESC &swap_des
 		return false;
 #endif
 
+	// Load the HLSL compiler here already, since 'compile_entry_point' is called from worker threads
+	if (_d3d_compiler == nullptr)
+		_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
+
+	if (_d3d_compiler == nullptr)
+		LOG(ERROR) << "Unable to load HLSL compiler (\"d3dcompiler_47.dll\").";
+
 	return runtime::on_init(swap_desc.OutputWindow);
 }
 void reshade::d3d12::runtime_d3d12::on_reset()
@@ -407,6 +415,11 @@ void reshade::d3d12::runtime_d3d12::on_present()
 	transition_state(_cmd_list, _backbuffers[_swap_index], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
 	update_and_render_effects();
+
+	// Put all textures back into shader resource state, which is what everything outside of effect rendering expects them to be in
+	if (begin_command_list())
+		apply_texture_barriers(_texture_barrier_planner.finish());
+
 	runtime::on_present();
 
 	// Potentially have to restart command list here because a screenshot was taken
@@ -518,81 +531,86 @@ bool reshade::d3d12::runtime_d3d12::capture_screenshot(uint8_t *buffer) const
 	return true;
 }
 
-bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
+bool reshade::d3d12::runtime_d3d12::compile_entry_point(const effect &effect, const reshadefx::entry_point &entry_point, std::vector<char> &cso, std::string &assembly, std::string &errors)
 {
-	if (_d3d_compiler == nullptr)
-		_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
-
 	if (_d3d_compiler == nullptr)
 	{
-		LOG(ERROR) << "Unable to load HLSL compiler (\"d3dcompiler_47.dll\").";
+		errors += "Unable to load HLSL compiler (\"d3dcompiler_47.dll\").";
 		return false;
 	}
 
-	effect &effect = _effects[index];
-
 	const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(_d3d_compiler, "D3DCompile"));
 	const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(_d3d_compiler, "D3DDisassemble"));
 
 	const std::string hlsl = effect.preamble + effect.module.hlsl;
-	std::unordered_map<std::string, std::vector<char>> entry_points;
 
-	// Compile the generated HLSL source code to DX byte code
-	for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
+	std::string profile;
+	switch (entry_point.type)
 	{
-		HRESULT hr = E_FAIL;
+	case reshadefx::shader_type::vs:
+		profile = "vs_5_0";
+		break;
+	case reshadefx::shader_type::ps:
+		profile = "ps_5_0";
+		break;
+	case reshadefx::shader_type::cs:
+		profile = "cs_5_0";
+		break;
+	}
 
-		std::string profile;
-		switch (entry_point.type)
-		{
-		case reshadefx::shader_type::vs:
-			profile = "vs_5_0";
-			break;
-		case reshadefx::shader_type::ps:
-			profile = "ps_5_0";
-			break;
-		case reshadefx::shader_type::cs:
-			profile = "cs_5_0";
-			break;
-		}
+	std::string attributes;
+	attributes += "func=D3DCompile;";
+	attributes += "name=(null);defines=(null);include=(null);";
+	attributes += "entrypoint=" + entry_point.name + ';';
+	attributes += "profile=" + profile + ';';
+	attributes += "compile=" + std::to_string(D3DCOMPILE_ENABLE_STRICTNESS | (_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1)) + ';';
+	attributes += "effect=0;";
 
-		std::string attributes;
-		attributes += "func=D3DCompile;";
-		attributes += "name=(null);defines=(null);include=(null);";
-		attributes += "entrypoint=" + entry_point.name + ';';
-		attributes += "profile=" + profile + ';';
-		attributes += "compile=" + std::to_string(D3DCOMPILE_ENABLE_STRICTNESS | (_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1)) + ';';
-		attributes += "effect=0;";
-
-		const size_t hash = std::hash<std::string_view>()(attributes) ^ std::hash<std::string_view>()(hlsl);
-		std::vector<char> &cso = entry_points[entry_point.name];
-		if (!load_effect_cache(effect.source_file, entry_point.name, hash, cso, effect.assembly[entry_point.name]))
-		{
-			com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
-			hr = D3DCompile(
-				hlsl.data(), hlsl.size(),
-				nullptr, nullptr, nullptr,
-				entry_point.name.c_str(),
-				profile.c_str(),
-				D3DCOMPILE_ENABLE_STRICTNESS | (_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1), 0,
-				&d3d_compiled, &d3d_errors);
+	const content_hash hash = content_hasher().update(attributes).update(hlsl).finalize();
+	if (load_effect_cache(effect.source_file, entry_point.name, hash, cso, assembly))
+		return true;
+
+	// A D3DCompile call cannot be interrupted once it was started, so this is the last chance to skip the compilation if the load it belongs to was cancelled
+	if (job_system::is_current_job_cancelled())
+		return false;
+
+	// Compile the generated HLSL source code to DX byte code
+	com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
+	const HRESULT hr = D3DCompile(
+		hlsl.data(), hlsl.size(),
+		nullptr, nullptr, nullptr,
+		entry_point.name.c_str(),
+		profile.c_str(),
+		D3DCOMPILE_ENABLE_STRICTNESS | (_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1), 0,
+		&d3d_compiled, &d3d_errors);
+
+	if (d3d_errors != nullptr) // Append warnings to the output error string as well
+		errors.append(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
+
+	if (FAILED(hr))
+		return false;
 
-			if (d3d_errors != nullptr) // Append warnings to the output error string as well
-				effect.errors.append(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
+	cso.resize(d3d_compiled->GetBufferSize());
+	std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
 
-			// No need to setup resources if any of the shaders failed to compile
-			if (FAILED(hr))
-				return false;
+	// D3DDisassemble cannot be interrupted either and is only needed for the cache, so skip it too if the load was cancelled in the meantime
+	if (job_system::is_current_job_cancelled())
+		return false;
 
-			cso.resize(d3d_compiled->GetBufferSize());
-			std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
+	if (com_ptr<ID3DBlob> d3d_disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
+		assembly.assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
 
-			if (com_ptr<ID3DBlob> d3d_disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
-				effect.assembly[entry_point.name].assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
+	save_effect_cache(effect.source_file, entry_point.name, hash, cso, assembly);
 
-			save_effect_cache(effect.source_file, entry_point.name, hash, cso, effect.assembly[entry_point.name]);
-		}
-	}
+	return true;
+}
+
+bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
+{
+	effect &effect = _effects[index];
+
+	// The DX byte code was compiled in 'compile_entry_point' already and is only needed to create pipeline state objects below
+	const std::unordered_map<std::string, std::vector<char>> &entry_points = effect.compiled_entry_points;
 
 	if (index >= _effect_data.size())
 		_effect_data.resize(index + 1);
@@ -611,7 +629,7 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 		uav_range.NumDescriptors = effect.module.num_storage_bindings;
 		uav_range.BaseShaderRegister = 0;
 
-		D3D12_ROOT_PARAMETER params[4] = {};
+		D3D12_ROOT_PARAMETER params[5] = {};
 		params[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
 		params[0].Descriptor.ShaderRegister = 0; // b0 (global constant buffer)
 		params[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
@@ -623,13 +641,16 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 		params[2].DescriptorTable.NumDescriptorRanges = 1;
 		params[2].DescriptorTable.pDescriptorRanges = &sampler_range;
 		params[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-		params[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-		params[3].DescriptorTable.NumDescriptorRanges = 1;
-		params[3].DescriptorTable.pDescriptorRanges = &uav_range;
+		params[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+		params[3].Descriptor.ShaderRegister = 1; // b1 (per-frame constant buffer)
 		params[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		params[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		params[4].DescriptorTable.NumDescriptorRanges = 1;
+		params[4].DescriptorTable.pDescriptorRanges = &uav_range;
+		params[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
 
 		D3D12_ROOT_SIGNATURE_DESC desc = {};
-		desc.NumParameters = effect.module.num_storage_bindings == 0 ? 3 : 4;
+		desc.NumParameters = effect.module.num_storage_bindings == 0 ? 4 : 5;
 		desc.pParameters = params;
 
 		effect_data.signature = create_root_signature(desc);
@@ -642,8 +663,12 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 
 	if (!effect.uniform_data_storage.empty())
 	{
+		// Uniform variables updated every frame are packed at the end of the storage, so place them in a separate constant buffer view behind the others
+		const UINT64 per_frame_offset = (effect.module.per_frame_uniform_offset + 15) & ~15;
+		effect_data.cb_per_frame_offset = (per_frame_offset + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+
 		D3D12_RESOURCE_DESC desc = { D3D12_RESOURCE_DIMENSION_BUFFER };
-		desc.Width = effect.uniform_data_storage.size();
+		desc.Width = effect_data.cb_per_frame_offset + (effect.uniform_data_storage.size() - per_frame_offset);
 		desc.Height = 1;
 		desc.DepthOrArraySize = 1;
 		desc.MipLevels = 1;
@@ -661,7 +686,8 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 #ifndef NDEBUG
 		effect_data.cb->SetName(L"ReShade constant buffer");
 #endif
-		effect_data.cbv_gpu_address = effect_data.cb->GetGPUVirtualAddress();
+		effect_data.cbv_gpu_address[0] = effect_data.cb->GetGPUVirtualAddress();
+		effect_data.cbv_gpu_address[1] = effect_data.cbv_gpu_address[0] + effect_data.cb_per_frame_offset;
 	}
 
 	{   D3D12_DESCRIPTOR_HEAP_DESC desc = { D3D12_DESCRIPTOR_HEAP_TYPE_RTV };
@@ -1328,6 +1354,53 @@ void reshade::d3d12::runtime_d3d12::generate_mipmaps(const d3d12_tex_data *impl)
 	transition_state(_cmd_list, impl->resource, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_SHADER_RESOURCE);
 }
 
+void reshade::d3d12::runtime_d3d12::apply_texture_barriers(const std::vector<reshadefx::texture_barrier> &barriers)
+{
+	const auto usage_to_state = [](reshadefx::texture_usage usage) -> D3D12_RESOURCE_STATES {
+		switch (usage)
+		{
+		default:
+		case reshadefx::texture_usage::shader_resource:
+			return D3D12_RESOURCE_STATE_SHADER_RESOURCE;
+		case reshadefx::texture_usage::render_target:
+			return D3D12_RESOURCE_STATE_RENDER_TARGET;
+		case reshadefx::texture_usage::unordered_access:
+			return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		}
+	};
+
+	std::vector<D3D12_RESOURCE_BARRIER> transitions;
+	transitions.reserve(barriers.size());
+
+	for (const reshadefx::texture_barrier &barrier : barriers)
+	{
+		// Textures with a semantic (like the back buffer) are not managed by the barrier planner
+		const auto texture = std::find_if(_textures.begin(), _textures.end(),
+			[&barrier](const auto &item) { return item.unique_name == barrier.texture_name && item.impl != nullptr && item.semantic.empty(); });
+		if (texture == _textures.end())
+			continue;
+
+		D3D12_RESOURCE_BARRIER &transition = transitions.emplace_back();
+
+		if (barrier.old_usage == barrier.new_usage)
+		{
+			transition.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+			transition.UAV.pResource = static_cast<d3d12_tex_data *>(texture->impl)->resource.get();
+			continue;
+		}
+
+		transition.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		transition.Transition.pResource = static_cast<d3d12_tex_data *>(texture->impl)->resource.get();
+		transition.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		transition.Transition.StateBefore = usage_to_state(barrier.old_usage);
+		transition.Transition.StateAfter = usage_to_state(barrier.new_usage);
+	}
+
+	// Submit all transitions at once
+	if (!transitions.empty())
+		_cmd_list->ResourceBarrier(static_cast<UINT>(transitions.size()), transitions.data());
+}
+
 void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 {
 	const auto impl = static_cast<d3d12_technique_data *>(technique.impl);
@@ -1345,16 +1418,33 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 	// Setup shader constants
 	if (effect_data.cb != nullptr)
 	{
+		effect &effect = _effects[technique.effect_index];
+		const size_t per_frame_offset = (effect.module.per_frame_uniform_offset + 15) & ~15;
+
 		if (void *mapped;
 			SUCCEEDED(effect_data.cb->Map(0, nullptr, &mapped)))
 		{
-			std::memcpy(mapped, _effects[technique.effect_index].uniform_data_storage.data(), _effects[technique.effect_index].uniform_data_storage.size());
+			// Uniform variables updated every frame are always uploaded, the others only after a value changed
+			if (effect.uniform_data_dirty)
+				std::memcpy(mapped, effect.uniform_data_storage.data(), per_frame_offset);
+			std::memcpy(static_cast<uint8_t *>(mapped) + effect_data.cb_per_frame_offset, effect.uniform_data_storage.data() + per_frame_offset, effect.uniform_data_storage.size() - per_frame_offset);
 			effect_data.cb->Unmap(0, nullptr);
+
+			effect.uniform_data_dirty = false;
 		}
 
-		_cmd_list->SetGraphicsRootConstantBufferView(0, effect_data.cbv_gpu_address);
+		// Without any uniform variables updated every frame, the per-frame view would start at the end of the buffer, but the shaders do not declare it then either (same as the second constant buffer in D3D11)
+		const bool has_per_frame_uniforms = effect.module.total_uniform_size != effect.module.per_frame_uniform_offset;
+
+		_cmd_list->SetGraphicsRootConstantBufferView(0, effect_data.cbv_gpu_address[0]);
+		if (has_per_frame_uniforms)
+			_cmd_list->SetGraphicsRootConstantBufferView(3, effect_data.cbv_gpu_address[1]);
 		if (impl->has_compute_passes)
-			_cmd_list->SetComputeRootConstantBufferView(0, effect_data.cbv_gpu_address);
+		{
+			_cmd_list->SetComputeRootConstantBufferView(0, effect_data.cbv_gpu_address[0]);
+			if (has_per_frame_uniforms)
+				_cmd_list->SetComputeRootConstantBufferView(3, effect_data.cbv_gpu_address[1]);
+		}
 	}
 
 	// Setup samplers
@@ -1365,14 +1455,16 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 	// TODO: Technically need to transition the depth texture here as well
 
 	bool is_effect_stencil_cleared = false;
-	bool needs_implicit_backbuffer_copy = true; // First pass always needs the back buffer updated
 	D3D12_CPU_DESCRIPTOR_HANDLE effect_stencil = _depthstencil_dsvs->GetCPUDescriptorHandleForHeapStart();
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
-		if (needs_implicit_backbuffer_copy)
+		if (technique.culled_passes[pass_index])
+			continue; // Nothing uses the output of this pass, so can skip it
+
+		if (_backbuffer_copy_planner.next_pass(technique.pass_accesses[pass_index]))
 		{
-			// Save back buffer of previous pass
+			// Save back buffer of previous pass, since this pass samples it
 			transition_state(_cmd_list, _backbuffer_texture, D3D12_RESOURCE_STATE_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
 			transition_state(_cmd_list, _backbuffers[_swap_index], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
 			_cmd_list->CopyResource(_backbuffer_texture.get(), _backbuffers[_swap_index].get());
@@ -1389,15 +1481,16 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 		const d3d12_pass_data &pass_data = impl->passes[pass_index];
 		const reshadefx::pass_info &pass_info = technique.passes[pass_index];
 
+		// Transition textures this pass accesses into the required state (which only does something if the state differs from the one a previous pass, possibly in another technique, left them in)
+		_texture_barrier_planner.require(technique.pass_accesses[pass_index]);
+		apply_texture_barriers(_texture_barrier_planner.flush());
+
 		_cmd_list->SetPipelineState(pass_data.pipeline.get());
 
 		if (!pass_info.cs_entry_point.empty())
 		{
-			// Compute shaders do not write to the back buffer, so no update necessary
-			needs_implicit_backbuffer_copy = false;
-
 			_cmd_list->SetComputeRootDescriptorTable(1, pass_data.srv_handle);
-			_cmd_list->SetComputeRootDescriptorTable(3, pass_data.uav_handle);
+			_cmd_list->SetComputeRootDescriptorTable(4, pass_data.uav_handle);
 
 			_cmd_list->Dispatch(pass_info.viewport_width, pass_info.viewport_height, pass_info.viewport_dispatch_z);
 		}
@@ -1405,10 +1498,6 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 		{
 			_cmd_list->SetGraphicsRootDescriptorTable(1, pass_data.srv_handle);
 
-			// Transition resource state for render targets
-			for (const d3d12_tex_data *render_target_texture : pass_data.modified_resources)
-				transition_state(_cmd_list, render_target_texture->resource, D3D12_RESOURCE_STATE_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
-
 			_cmd_list->OMSetStencilRef(pass_info.stencil_reference_value);
 
 			// Setup render targets
@@ -1423,8 +1512,6 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 
 			if (pass_data.num_render_targets == 0)
 			{
-				needs_implicit_backbuffer_copy = true;
-
 				D3D12_CPU_DESCRIPTOR_HANDLE render_target = { _backbuffer_rtvs->GetCPUDescriptorHandleForHeapStart().ptr + (_swap_index * 2 + pass_info.srgb_write_enable) * _rtv_handle_size };
 				_cmd_list->OMSetRenderTargets(1, &render_target, false, pass_info.stencil_enable ? &effect_stencil : nullptr);
 
@@ -1433,8 +1520,6 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 			}
 			else
 			{
-				needs_implicit_backbuffer_copy = false;
-
 				_cmd_list->OMSetRenderTargets(pass_data.num_render_targets, &pass_data.render_targets, true,
 					pass_info.stencil_enable && pass_info.viewport_width == _width && pass_info.viewport_height == _height ? &effect_stencil : nullptr);
 
@@ -1474,13 +1559,14 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 
 			_vertices += pass_info.num_vertices;
 			_drawcalls += 1;
-
-			// Transition resource state back to shader access
-			for (const d3d12_tex_data *render_target_texture : pass_data.modified_resources)
-				transition_state(_cmd_list, render_target_texture->resource, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_SHADER_RESOURCE);
 		}
 
-		// Generate mipmaps for modified resources
+		// Generate mipmaps for modified resources, which requires them to be in shader resource state
+		for (const std::string &texture_name : technique.pass_accesses[pass_index].written_textures)
+			if (look_up_texture_by_name(texture_name).levels > 1)
+				_texture_barrier_planner.require(texture_name, reshadefx::texture_usage::shader_resource);
+		apply_texture_barriers(_texture_barrier_planner.flush());
+
 		for (const d3d12_tex_data *modified_texture : pass_data.modified_resources)
 			generate_mipmaps(modified_texture);
 	}
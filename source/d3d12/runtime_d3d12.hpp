@@ -30,6 +30,7 @@ namespace reshade::d3d12
 		bool capture_screenshot(uint8_t *buffer) const override;
 
 	private:
+		bool compile_entry_point(const effect &effect, const reshadefx::entry_point &entry_point, std::vector<char> &cso, std::string &assembly, std::string &errors) override;
 		bool init_effect(size_t index) override;
 		void unload_effect(size_t index) override;
 		void unload_effects() override;
@@ -38,6 +39,7 @@ namespace reshade::d3d12
 		void upload_texture(const texture &texture, const uint8_t *pixels) override;
 		void destroy_texture(texture &texture) override;
 		void generate_mipmaps(const struct d3d12_tex_data *impl);
+		void apply_texture_barriers(const std::vector<reshadefx::texture_barrier> &barriers);
 
 		void render_technique(technique &technique) override;
 
@@ -76,6 +78,7 @@ namespace reshade::d3d12
 		HMODULE _d3d_compiler = nullptr;
 		com_ptr<ID3D12Resource> _effect_stencil;
 		std::vector<struct d3d12_effect_data> _effect_data;
+		reshadefx::texture_barrier_planner _texture_barrier_planner;
 
 #if RESHADE_GUI
 		bool init_imgui_resources();
@@ -43,6 +43,8 @@ namespace reshade::d3d9
 		com_ptr<IDirect3DStateBlock9> stateblock;
 		com_ptr<IDirect3DPixelShader9> pixel_shader;
 		com_ptr<IDirect3DVertexShader9> vertex_shader;
+		UINT vs_constant_registers[2] = {}; // First register and number of registers
+		UINT ps_constant_registers[2] = {};
 		IDirect3DSurface9 *render_targets[8] = {};
 		IDirect3DTexture9 *sampler_textures[16] = {};
 	};
@@ -52,7 +54,6 @@ namespace reshade::d3d9
 		DWORD num_samplers = 0;
 		DWORD sampler_states[16][12] = {};
 		IDirect3DTexture9 *sampler_textures[16] = {};
-		DWORD constant_register_count = 0;
 		std::vector<d3d9_pass_data> passes;
 	};
 }
@@ -209,6 +210,15 @@ bool reshade::d3d9::runtime_d3d9::on_init(const D3DPRESENT_PARAMETERS &pp)
 		return false;
 #endif
 
+	// Load the HLSL compiler here already, since 'compile_entry_point' is called from worker threads
+	if (_d3d_compiler == nullptr)
+		_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
+	if (_d3d_compiler == nullptr)
+		_d3d_compiler = LoadLibraryW(L"d3dcompiler_43.dll");
+
+	if (_d3d_compiler == nullptr)
+		LOG(ERROR) << "Unable to load HLSL compiler (\"d3dcompiler_47.dll\")." << " Make sure you have the DirectX end-user runtime (June 2010) installed or a newer version of the library in the application directory.";
+
 	return runtime::on_init(pp.hDeviceWindow);
 }
 void reshade::d3d9::runtime_d3d9::on_reset()
@@ -421,98 +431,104 @@ bool reshade::d3d9::runtime_d3d9::capture_screenshot(uint8_t *buffer) const
 	return true;
 }
 
-bool reshade::d3d9::runtime_d3d9::init_effect(size_t index)
+bool reshade::d3d9::runtime_d3d9::compile_entry_point(const effect &effect, const reshadefx::entry_point &entry_point, std::vector<char> &cso, std::string &assembly, std::string &errors)
 {
-	if (_d3d_compiler == nullptr)
-		_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
-	if (_d3d_compiler == nullptr)
-		_d3d_compiler = LoadLibraryW(L"d3dcompiler_43.dll");
-
 	if (_d3d_compiler == nullptr)
 	{
-		LOG(ERROR) << "Unable to load HLSL compiler (\"d3dcompiler_47.dll\")." << " Make sure you have the DirectX end-user runtime (June 2010) installed or a newer version of the library in the application directory.";
+		errors += "Unable to load HLSL compiler (\"d3dcompiler_47.dll\").";
 		return false;
 	}
 
-	effect &effect = _effects[index];
-
 	const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(_d3d_compiler, "D3DCompile"));
 	const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(_d3d_compiler, "D3DDisassemble"));
 
 	// Add specialization constant defines to source code
-	effect.preamble +=
+	const std::string preamble = effect.preamble +
 		"#define COLOR_PIXEL_SIZE 1.0 / " + std::to_string(_width) + ", 1.0 / " + std::to_string(_height) + "\n"
 		"#define DEPTH_PIXEL_SIZE COLOR_PIXEL_SIZE\n"
 		"#define SV_DEPTH_PIXEL_SIZE DEPTH_PIXEL_SIZE\n"
 		"#define SV_TARGET_PIXEL_SIZE COLOR_PIXEL_SIZE\n";
 
-	const std::string hlsl_vs = effect.preamble + effect.module.hlsl;
-	const std::string hlsl_ps = effect.preamble + "#define POSITION VPOS\n" + effect.module.hlsl;
+	std::string hlsl;
+	std::string_view profile;
 
-	std::unordered_map<std::string, com_ptr<IUnknown>> entry_points;
+	switch (entry_point.type)
+	{
+	case reshadefx::shader_type::vs:
+		hlsl = preamble + effect.module.hlsl;
+		profile = "vs_3_0";
+		break;
+	case reshadefx::shader_type::ps:
+		hlsl = preamble + "#define POSITION VPOS\n" + effect.module.hlsl;
+		profile = "ps_3_0";
+		break;
+	case reshadefx::shader_type::cs:
+		errors += "Compute shaders are not supported in ";
+		errors += "D3D9";
+		errors += '.';
+		return false;
+	}
+
+	std::string attributes;
+	attributes += "func=D3DCompile;";
+	attributes += "name=(null);defines=(null);include=(null);";
+	attributes += "entrypoint=" + entry_point.name + ';';
+	attributes += "profile=" + std::string(profile) + ';';
+	attributes += "compile=" + std::to_string(_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1) + ';';
+	attributes += "effect=0;";
+
+	const content_hash hash = content_hasher().update(attributes).update(hlsl).finalize();
+	if (load_effect_cache(effect.source_file, entry_point.name, hash, cso, assembly))
+		return true;
+
+	// A D3DCompile call cannot be interrupted once it was started, so this is the last chance to skip the compilation if the load it belongs to was cancelled
+	if (job_system::is_current_job_cancelled())
+		return false;
 
 	// Compile the generated HLSL source code to DX byte code
-	for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
-	{
-		HRESULT hr = E_FAIL;
+	com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
+	const HRESULT hr = D3DCompile(
+		hlsl.data(), hlsl.size(),
+		nullptr, nullptr, nullptr,
+		entry_point.name.c_str(),
+		profile.data(),
+		_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1, 0,
+		&d3d_compiled, &d3d_errors);
+
+	if (d3d_errors != nullptr) // Append warnings to the output error string as well
+		errors.append(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
 
-		std::string_view profile, hlsl;
-		com_ptr<ID3DBlob> compiled, d3d_errors;
+	if (FAILED(hr))
+		return false;
 
-		switch (entry_point.type)
-		{
-		case reshadefx::shader_type::vs:
-			hlsl = hlsl_vs;
-			profile = "vs_3_0";
-			break;
-		case reshadefx::shader_type::ps:
-			hlsl = hlsl_ps;
-			profile = "ps_3_0";
-			break;
-		case reshadefx::shader_type::cs:
-			effect.errors += "Compute shaders are not supported in ";
-			effect.errors += "D3D9";
-			effect.errors += '.';
-			return false;
-		}
+	cso.resize(d3d_compiled->GetBufferSize());
+	std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
 
-		std::string attributes;
-		attributes += "func=D3DCompile;";
-		attributes += "name=(null);defines=(null);include=(null);";
-		attributes += "entrypoint=" + entry_point.name + ';';
-		attributes += "profile=" + std::string(profile) + ';';
-		attributes += "compile=" + std::to_string(_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1) + ';';
-		attributes += "effect=0;";
-
-		const size_t hash = std::hash<std::string_view>()(attributes) ^ std::hash<std::string_view>()(hlsl);
-		std::vector<char> cso;
-		if (!load_effect_cache(effect.source_file, entry_point.name, hash, cso, effect.assembly[entry_point.name]))
-		{
-			hr = D3DCompile(
-				hlsl.data(), hlsl.size(),
-				nullptr, nullptr, nullptr,
-				entry_point.name.c_str(),
-				profile.data(),
-				_performance_mode ? D3DCOMPILE_OPTIMIZATION_LEVEL3 : D3DCOMPILE_OPTIMIZATION_LEVEL1, 0,
-				&compiled, &d3d_errors);
-
-			if (d3d_errors != nullptr) // Append warnings to the output error string as well
-				effect.errors.append(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
-
-			// No need to setup resources if any of the shaders failed to compile
-			if (FAILED(hr))
-				return false;
+	// D3DDisassemble cannot be interrupted either and is only needed for the cache, so skip it too if the load was cancelled in the meantime
+	if (job_system::is_current_job_cancelled())
+		return false;
 
-			cso.resize(compiled->GetBufferSize());
-			std::memcpy(cso.data(), compiled->GetBufferPointer(), cso.size());
+	if (com_ptr<ID3DBlob> d3d_disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
+		assembly.assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
 
-			if (com_ptr<ID3DBlob> disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &disassembled)))
-				effect.assembly[entry_point.name].assign(static_cast<const char *>(disassembled->GetBufferPointer()), disassembled->GetBufferSize() - 1);
+	save_effect_cache(effect.source_file, entry_point.name, hash, cso, assembly);
 
-			save_effect_cache(effect.source_file, entry_point.name, hash, cso, effect.assembly[entry_point.name]);
-		}
+	return true;
+}
+
+bool reshade::d3d9::runtime_d3d9::init_effect(size_t index)
+{
+	effect &effect = _effects[index];
+
+	std::unordered_map<std::string, com_ptr<IUnknown>> entry_points;
+
+	// Create runtime shader objects from the DX byte code that was compiled in 'compile_entry_point'
+	for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
+	{
+		HRESULT hr = E_FAIL;
+
+		const std::vector<char> &cso = effect.compiled_entry_points.at(entry_point.name);
 
-		// Create runtime shader objects from the compiled DX byte code
 		switch (entry_point.type)
 		{
 		case reshadefx::shader_type::vs:
@@ -534,7 +550,6 @@ bool reshade::d3d9::runtime_d3d9::init_effect(size_t index)
 	assert(effect.module.num_texture_bindings == 0);
 	assert(effect.module.num_storage_bindings == 0);
 	technique_init.num_samplers = effect.module.num_sampler_bindings;
-	technique_init.constant_register_count = static_cast<DWORD>((effect.uniform_data_storage.size() + 15) / 16);
 
 	for (const reshadefx::sampler_info &info : effect.module.samplers)
 	{
@@ -587,6 +602,21 @@ bool reshade::d3d9::runtime_d3d9::init_effect(size_t index)
 			entry_points.at(pass_info.ps_entry_point)->QueryInterface(&pass_data.pixel_shader);
 			entry_points.at(pass_info.vs_entry_point)->QueryInterface(&pass_data.vertex_shader);
 
+			// Only the constant registers the shaders of this pass actually read from have to be uploaded before drawing
+			for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
+			{
+				if (entry_point.name == pass_info.vs_entry_point)
+				{
+					pass_data.vs_constant_registers[0] = entry_point.first_constant_register;
+					pass_data.vs_constant_registers[1] = entry_point.num_constant_registers;
+				}
+				if (entry_point.name == pass_info.ps_entry_point)
+				{
+					pass_data.ps_constant_registers[0] = entry_point.first_constant_register;
+					pass_data.ps_constant_registers[1] = entry_point.num_constant_registers;
+				}
+			}
+
 			pass_data.render_targets[0] = _backbuffer_resolved.get();
 
 			for (UINT k = 0; k < ARRAYSIZE(pass_data.sampler_textures); ++k)
@@ -996,22 +1026,16 @@ void reshade::d3d9::runtime_d3d9::render_technique(technique &technique)
 	_device->SetStreamSource(0, _effect_vertex_buffer.get(), 0, sizeof(float));
 	_device->SetVertexDeclaration(_effect_vertex_layout.get());
 
-	// Setup shader constants
-	if (impl->constant_register_count != 0)
-	{
-		const auto uniform_storage_data = reinterpret_cast<const float *>(_effects[technique.effect_index].uniform_data_storage.data());
-		_device->SetPixelShaderConstantF(0, uniform_storage_data, impl->constant_register_count);
-		_device->SetVertexShaderConstantF(0, uniform_storage_data, impl->constant_register_count);
-	}
-
 	bool is_effect_stencil_cleared = false;
-	bool needs_implicit_backbuffer_copy = true; // First pass always needs the back buffer updated
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
-		if (needs_implicit_backbuffer_copy)
+		if (technique.culled_passes[pass_index])
+			continue; // Nothing uses the output of this pass, so can skip it
+
+		if (_backbuffer_copy_planner.next_pass(technique.pass_accesses[pass_index]))
 		{
-			// Save back buffer of previous pass
+			// Save back buffer of previous pass, since this pass samples it
 			_device->StretchRect(_backbuffer_resolved.get(), nullptr, _backbuffer_texture_surface.get(), nullptr, D3DTEXF_NONE);
 		}
 
@@ -1021,6 +1045,13 @@ void reshade::d3d9::runtime_d3d9::render_technique(technique &technique)
 		// Setup state
 		pass_data.stateblock->Apply();
 
+		// Setup shader constants (only the smallest range of constant registers that contains all uniform variables read in this pass)
+		const auto uniform_storage_data = reinterpret_cast<const float *>(_effects[technique.effect_index].uniform_data_storage.data());
+		if (pass_data.vs_constant_registers[1] != 0)
+			_device->SetVertexShaderConstantF(pass_data.vs_constant_registers[0], uniform_storage_data + pass_data.vs_constant_registers[0] * 4, pass_data.vs_constant_registers[1]);
+		if (pass_data.ps_constant_registers[1] != 0)
+			_device->SetPixelShaderConstantF(pass_data.ps_constant_registers[0], uniform_storage_data + pass_data.ps_constant_registers[0] * 4, pass_data.ps_constant_registers[1]);
+
 		// Setup shader resources
 		for (DWORD s = 0; s < impl->num_samplers; s++)
 		{
@@ -1097,8 +1128,6 @@ void reshade::d3d9::runtime_d3d9::render_technique(technique &technique)
 		_vertices += pass_info.num_vertices;
 		_drawcalls += 1;
 
-		needs_implicit_backbuffer_copy = false;
-
 		// Generate mipmaps for modified resources
 		for (IDirect3DSurface9 *target : pass_data.render_targets)
 		{
@@ -1106,10 +1135,7 @@ void reshade::d3d9::runtime_d3d9::render_technique(technique &technique)
 				break;
 
 			if (target == _backbuffer_resolved)
-			{
-				needs_implicit_backbuffer_copy = true;
-				break;
-			}
+				break; // The back buffer has no mipmaps
 
 			if (com_ptr<IDirect3DBaseTexture9> texture;
 				SUCCEEDED(target->GetContainer(IID_PPV_ARGS(&texture))) && texture->GetLevelCount() > 1)
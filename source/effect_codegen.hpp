@@ -329,6 +329,66 @@ namespace reshadefx
 			return align_up(size, alignment) * (elements - 1) + size;
 		}
 
+		/// <summary>
+		/// Find an order for the uniform variables in which packing them one after another wastes as little space on padding as possible.
+		/// Variables that are updated by the runtime every frame (those with a "source" annotation) are moved behind all others, so that they form a contiguous range at the end that can be uploaded separately.
+		/// </summary>
+		/// <param name="uniforms">The uniform variables to sort, with their size already filled in.</param>
+		/// <param name="num_per_frame">Set to the number of variables at the end of the returned order that are updated every frame.</param>
+		/// <returns>The indices into <paramref name="uniforms"/> in the order they should be packed.</returns>
+		static std::vector<size_t> optimize_uniform_layout(const std::vector<uniform_info> &uniforms, size_t &num_per_frame)
+		{
+			std::vector<size_t> order;
+			order.reserve(uniforms.size());
+
+			for (const bool per_frame : { false, true })
+			{
+				const size_t first = order.size();
+
+				std::vector<size_t> small_uniforms;
+				for (size_t i = 0; i < uniforms.size(); ++i)
+				{
+					const uniform_info &info = uniforms[i];
+					if (per_frame != std::any_of(info.annotations.begin(), info.annotations.end(),
+						[](const auto &annotation) { return annotation.name == "source"; }))
+						continue;
+
+					// Arrays, matrices and four-component vectors always start on a new 16-byte boundary, so keep them at the front in declaration order
+					if (info.type.is_array() || info.type.is_matrix() || info.size >= 16)
+						order.push_back(i);
+					else
+						small_uniforms.push_back(i);
+				}
+
+				// Fill 16-byte rows with the remaining scalars and vectors, placing the largest first into the first row they fit (first-fit decreasing)
+				std::stable_sort(small_uniforms.begin(), small_uniforms.end(),
+					[&uniforms](size_t lhs, size_t rhs) { return uniforms[lhs].size > uniforms[rhs].size; });
+
+				std::vector<std::pair<uint32_t, std::vector<size_t>>> rows;
+				for (const size_t i : small_uniforms)
+				{
+					const auto row = std::find_if(rows.begin(), rows.end(),
+						[size = uniforms[i].size](const auto &row) { return row.first + size <= 16; });
+					if (row != rows.end())
+					{
+						row->first += uniforms[i].size;
+						row->second.push_back(i);
+					}
+					else
+					{
+						rows.push_back({ uniforms[i].size, { i } });
+					}
+				}
+
+				for (const auto &row : rows)
+					order.insert(order.end(), row.second.begin(), row.second.end());
+
+				num_per_frame = order.size() - first;
+			}
+
+			return order;
+		}
+
 		reshadefx::module _module;
 		std::vector<struct_info> _structs;
 		std::vector<std::unique_ptr<function_info>> _functions;
@@ -344,14 +404,16 @@ namespace reshadefx
 	/// <param name="uniforms_to_spec_constants">Whether to convert uniform variables to specialization constants.</param>
 	/// <param name="enable_16bit_types">Use real 16-bit types for the minimum precision types "min16int", "min16uint" and "min16float".</param>
 	/// <param name="flip_vert_y">Insert code to flip the Y component of the output position in vertex shaders.</param>
-	codegen *create_codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types = false, bool flip_vert_y = false);
+	/// <param name="minify">Remove functions not reachable from an entry point and shorten identifiers and whitespace in the generated code (keeping every line where it is without minification, so that line numbers in compiler errors still refer to the same code) (ignored when <paramref name="debug_info"/> is set).</param>
+	codegen *create_codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types = false, bool flip_vert_y = false, bool minify = false);
 	/// <summary>
 	/// Create a back-end implementation for HLSL code generation.
 	/// </summary>
 	/// <param name="shader_model">The HLSL shader model version (e.g. 30, 41, 50, 60, ...)</param>
 	/// <param name="debug_info">Whether to append debug information like line directives to the generated code.</param>
 	/// <param name="uniforms_to_spec_constants">Whether to convert uniform variables to specialization constants.</param>
-	codegen *create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants);
+	/// <param name="infer_reduced_precision">Use minimum precision types for values that were proven to not need full precision (shader model 5 and up).</param>
+	codegen *create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants, bool infer_reduced_precision = false);
 	/// <summary>
 	/// Create a back-end implementation for SPIR-V code generation.
 	/// </summary>
@@ -360,5 +422,6 @@ namespace reshadefx
 	/// <param name="uniforms_to_spec_constants">Whether to convert uniform variables to specialization constants.</param>
 	/// <param name="enable_16bit_types">Use real 16-bit types for the minimum precision types "min16int", "min16uint" and "min16float".</param>
 	/// <param name="flip_vert_y">Insert code to flip the Y component of the output position in vertex shaders.</param>
-	codegen *create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types = false, bool flip_vert_y = false);
+	/// <param name="infer_reduced_precision">Decorate values that were proven to not need full precision with "RelaxedPrecision".</param>
+	codegen *create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types = false, bool flip_vert_y = false, bool infer_reduced_precision = false);
 }
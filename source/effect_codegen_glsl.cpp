@@ -16,8 +16,8 @@ using namespace reshadefx;
 class codegen_glsl final : public codegen
 {
 public:
-	codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y)
-		: _debug_info(debug_info), _uniforms_to_spec_constants(uniforms_to_spec_constants), _enable_16bit_types(enable_16bit_types), _flip_vert_y(flip_vert_y)
+	codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y, bool minify)
+		: _debug_info(debug_info), _uniforms_to_spec_constants(uniforms_to_spec_constants), _enable_16bit_types(enable_16bit_types), _flip_vert_y(flip_vert_y), _minify(minify && !debug_info)
 	{
 		// Create default block and reserve a memory block to avoid frequent reallocations
 		std::string &block = _blocks.emplace(0, std::string()).first->second;
@@ -38,13 +38,18 @@ private:
 	};
 
 	std::string _ubo_block;
+	std::vector<std::string> _uniform_declarations;
+	std::vector<uint32_t> _uniform_alignments;
 	std::string _compute_block;
 	std::unordered_map<id, std::string> _names;
+	std::unordered_set<std::string> _used_names;
+	std::unordered_map<std::string, uint32_t> _name_suffixes;
 	std::unordered_map<id, std::string> _blocks;
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 	bool _enable_16bit_types = false;
 	bool _flip_vert_y = false;
+	bool _minify = false;
 	std::unordered_map<id, id> _remapped_sampler_variables;
 	std::unordered_map<std::string, uint32_t> _semantic_to_location;
 
@@ -54,10 +59,39 @@ private:
 	bool _uses_componentwise_and = false;
 	bool _uses_componentwise_cond = false;
 
+	// Keep track of where functions were written and which other functions they call, so that unreachable ones can be removed in 'write_result'
+	id _current_function = 0;
+	std::unordered_map<id, std::pair<size_t, size_t>> _function_code_ranges;
+	std::unordered_map<id, std::vector<id>> _function_calls;
+	std::vector<std::pair<id, std::string>> _entry_point_functions;
+
 	void write_result(module &module) override
 	{
+		if (_minify)
+			remove_unreachable_functions();
+
 		module = std::move(_module);
 
+		// Lay out uniform variables only now that all of them are known, so that they can be sorted to minimize padding
+		// There are no explicit offsets in GLSL 4.3, so the declaration order has to reproduce the layout
+		size_t num_per_frame = 0;
+		const std::vector<size_t> order = optimize_uniform_layout(module.uniforms, num_per_frame);
+
+		for (const size_t index : order)
+		{
+			uniform_info &info = module.uniforms[index];
+
+			// Adjust offset according to alignment rules from 'define_uniform'
+			info.offset = module.total_uniform_size;
+			info.offset = align_up(info.offset, _uniform_alignments[index]);
+			module.total_uniform_size = info.offset + info.size;
+
+			_ubo_block += _uniform_declarations[index];
+		}
+
+		// Uniform variables updated every frame end up at the end of the block, so that they can be uploaded separately
+		module.per_frame_uniform_offset = num_per_frame != 0 ? module.uniforms[order[order.size() - num_per_frame]].offset : module.total_uniform_size;
+
 		if (_enable_16bit_types)
 			// GL_NV_gpu_shader5, GL_AMD_gpu_shader_half_float or GL_EXT_shader_16bit_storage
 			module.hlsl += "#extension GL_NV_gpu_shader5 : require\n";
@@ -96,6 +130,134 @@ private:
 			// TODO: This technically only works with square matrices
 			module.hlsl += "layout(std140, column_major, binding = 0) uniform _Globals {\n" + _ubo_block + "};\n";
 		module.hlsl += _blocks.at(0);
+
+		if (_minify)
+			module.hlsl = compact_whitespace(module.hlsl);
+	}
+
+	void remove_unreachable_functions()
+	{
+		// Find all functions that can be reached from each entry point by walking the call graph
+		std::unordered_map<id, std::vector<const std::string *>> function_entry_points;
+		for (const auto &[entry_point_function, entry_point_name] : _entry_point_functions)
+		{
+			std::vector<id> stack = { entry_point_function };
+			std::unordered_set<id> visited;
+			while (!stack.empty())
+			{
+				const id function = stack.back();
+				stack.pop_back();
+
+				if (!visited.insert(function).second)
+					continue;
+
+				function_entry_points[function].push_back(&entry_point_name);
+
+				if (const auto it = _function_calls.find(function); it != _function_calls.end())
+					stack.insert(stack.end(), it->second.begin(), it->second.end());
+			}
+		}
+
+		std::vector<std::pair<size_t, size_t>> ranges;
+		std::vector<std::string> guards;
+		for (const auto &[function, range] : _function_code_ranges)
+		{
+			// Skip functions that were not completed (e.g. due to a compile error)
+			if (range.second <= range.first)
+				continue;
+			// Entry point functions are already enclosed in an "ENTRY_POINT" block
+			if (std::find_if(_entry_point_functions.begin(), _entry_point_functions.end(),
+				[function = function](const auto &it) { return it.first == function; }) != _entry_point_functions.end())
+				continue;
+
+			std::string guard;
+			if (const auto it = function_entry_points.find(function); it != function_entry_points.end())
+			{
+				for (const std::string *entry_point_name : it->second)
+					guard += (guard.empty() ? "#if defined(ENTRY_POINT_" : " || defined(ENTRY_POINT_") + *entry_point_name + ')';
+				guard += '\n';
+			}
+
+			ranges.push_back(range);
+			guards.push_back(std::move(guard));
+		}
+
+		// Rebuild the global block, only keeping functions that are reachable and only for the entry points that use them
+		// This keeps every line where it was (so that line numbers in compiler errors match the code without minification), by replacing removed functions with empty lines and making room for the guards in the lines of the function
+		std::vector<size_t> order(ranges.size());
+		for (size_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&ranges](size_t lhs, size_t rhs) { return ranges[lhs].first < ranges[rhs].first; });
+
+		const std::string &code = _blocks.at(0);
+		std::string pruned_code;
+		pruned_code.reserve(code.size());
+
+		size_t offset = 0;
+		for (const size_t i : order)
+		{
+			pruned_code.append(code, offset, ranges[i].first - offset);
+			offset = ranges[i].second;
+
+			std::string function_code = code.substr(ranges[i].first, ranges[i].second - ranges[i].first);
+
+			if (guards[i].empty())
+			{
+				// Function is not used by any entry point, so remove it
+				pruned_code.append(std::count(function_code.begin(), function_code.end(), '\n'), '\n');
+				continue;
+			}
+
+			// Join the opening and closing braces with the lines in front of them, which frees up one line each for the '#if' and '#endif' around the function
+			if (const size_t open_brace = function_code.find("\n{\n");
+				open_brace != std::string::npos && function_code.size() >= open_brace + 5 && function_code.compare(function_code.size() - 3, 3, "\n}\n") == 0)
+			{
+				function_code[open_brace] = ' ';
+				function_code[function_code.size() - 3] = ' ';
+			}
+
+			pruned_code += guards[i];
+			pruned_code += function_code;
+			pruned_code += "#endif\n";
+		}
+		pruned_code.append(code, offset);
+
+		_blocks.at(0) = std::move(pruned_code);
+	}
+
+	static std::string compact_whitespace(const std::string &code)
+	{
+		std::string result;
+		result.reserve(code.size());
+
+		for (size_t line_offset = 0, next_line_offset; line_offset < code.size(); line_offset = next_line_offset + 1)
+		{
+			if (next_line_offset = code.find('\n', line_offset); next_line_offset == std::string::npos)
+				next_line_offset = code.size();
+
+			size_t begin = line_offset, end = next_line_offset;
+			while (begin < end && (code[begin] == '\t' || code[begin] == ' '))
+				begin++;
+			while (end > begin && (code[end - 1] == '\t' || code[end - 1] == ' ' || code[end - 1] == '\r'))
+				end--;
+
+			std::string line = code.substr(begin, end - begin);
+
+			// There are no string literals in the generated code, so can safely remove spaces around these tokens
+			if (!line.empty() && line[0] != '#')
+			{
+				for (size_t pos = 0; (pos = line.find(" = ", pos)) != std::string::npos; ++pos)
+					line.replace(pos, 3, "=");
+				for (size_t pos = 0; (pos = line.find(", ", pos)) != std::string::npos; ++pos)
+					line.replace(pos, 2, ",");
+			}
+
+			// Keep every line (even empty ones), so that line numbers in compiler errors still match the generated code that is shown to the user
+			result += line;
+			result += '\n';
+		}
+
+		return result;
 	}
 
 	template <bool is_param = false, bool is_decl = true, bool is_interface = false>
@@ -317,8 +479,34 @@ private:
 		if constexpr (naming_type != naming::reserved)
 			name = escape_name(std::move(name));
 		if constexpr (naming_type == naming::general)
-			if (std::find_if(_names.begin(), _names.end(), [&name](const auto &it) { return it.second == name; }) != _names.end())
-				name += '_' + std::to_string(id); // Append a numbered suffix if the name already exists
+		{
+			if (_used_names.find(name) != _used_names.end())
+			{
+				// Append a numbered suffix if the name already exists (continue counting from the last suffix used for this name, so this stays constant-time)
+				uint32_t &suffix = _name_suffixes[name];
+				std::string numbered_name;
+				do
+					numbered_name = name + '_' + std::to_string(++suffix);
+				while (_used_names.find(numbered_name) != _used_names.end());
+				name = std::move(numbered_name);
+			}
+		}
+		if constexpr (naming_type != naming::expression)
+			_used_names.insert(name);
+		if constexpr (naming_type == naming::unique || naming_type == naming::general)
+		{
+			if (_minify)
+			{
+				// Replace with a short name consisting of a letter and an optional number, which cannot clash with automatic names (digits only) or other internal names
+				const size_t index = _module.minified_names.size();
+				std::string short_name = "_";
+				short_name += "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"[index % 52];
+				if (index >= 52)
+					short_name += std::to_string(index / 52);
+				_module.minified_names.emplace(short_name, std::move(name));
+				name = std::move(short_name);
+			}
+		}
 		_names[id] = std::move(name);
 	}
 
@@ -534,22 +722,22 @@ private:
 				info.size = align_up(info.size, alignment) * info.type.array_length;
 			}
 
-			// Adjust offset according to alignment rules from above
-			info.offset = _module.total_uniform_size;
-			info.offset = align_up(info.offset, alignment);
-			_module.total_uniform_size = info.offset + info.size;
+			// Offsets are assigned in 'write_result', once all uniform variables are known
+			_uniform_alignments.push_back(alignment);
 
-			write_location(_ubo_block, loc);
+			std::string &code = _uniform_declarations.emplace_back();
+
+			write_location(code, loc);
 
-			_ubo_block += '\t';
+			code += '\t';
 			// Note: All matrices are floating-point, even if the uniform type says different!!
-			write_type(_ubo_block, info.type);
-			_ubo_block += ' ' + id_to_name(res);
+			write_type(code, info.type);
+			code += ' ' + id_to_name(res);
 
 			if (info.type.is_array())
-				_ubo_block += '[' + std::to_string(info.type.array_length) + ']';
+				code += '[' + std::to_string(info.type.array_length) + ']';
 
-			_ubo_block += ";\n";
+			code += ";\n";
 
 			_module.uniforms.push_back(info);
 		}
@@ -604,8 +792,13 @@ private:
 		else
 			define_name<naming::reserved>(info.definition, "main");
 
+		_current_function = info.definition;
+
 		std::string &code = _blocks.at(_current_block);
 
+		assert(_current_block == 0);
+		_function_code_ranges[info.definition].first = code.size();
+
 		write_location(code, loc);
 
 		write_type(code, info.return_type);
@@ -653,7 +846,7 @@ private:
 			[&func](const auto &ep) { return ep.name == func.unique_name; }); it != _module.entry_points.end())
 			return;
 
-		_module.entry_points.push_back({ func.unique_name, stype });
+		_module.entry_points.push_back({ func.unique_name, stype, func.may_discard, func.is_full_screen_triangle, func.cost });
 
 		_blocks.at(0) += "#ifdef ENTRY_POINT_" + func.unique_name + '\n';
 		if (stype == shader_type::cs)
@@ -757,6 +950,9 @@ private:
 		define_function({}, entry_point, true);
 		enter_block(create_block());
 
+		_function_calls[entry_point.definition].push_back(func.definition);
+		_entry_point_functions.emplace_back(entry_point.definition, func.unique_name);
+
 		std::string &code = _blocks.at(_current_block);
 
 		// Handle input parameters
@@ -1393,6 +1589,8 @@ private:
 
 		const id res = make_id();
 
+		_function_calls[_current_function].push_back(function);
+
 		std::string &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
@@ -1833,10 +2031,13 @@ private:
 		assert(_last_block != 0);
 
 		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
+
+		_function_code_ranges[_current_function].second = _blocks.at(0).size();
+		_current_function = 0;
 	}
 };
 
-codegen *reshadefx::create_codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y)
+codegen *reshadefx::create_codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y, bool minify)
 {
-	return new codegen_glsl(debug_info, uniforms_to_spec_constants, enable_16bit_types, flip_vert_y);
+	return new codegen_glsl(debug_info, uniforms_to_spec_constants, enable_16bit_types, flip_vert_y, minify);
 }
@@ -5,20 +5,27 @@
 
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include "effect_precision.hpp"
 #include <cmath> // signbit, isinf, isnan
 #include <cstdio> // snprintf
 #include <cassert>
 #include <cstring> // stricmp
+#include <cstdlib> // std::strtoul
+#include <limits> // std::numeric_limits
 #include <algorithm> // std::find_if, std::max
+#include <unordered_set>
 
 using namespace reshadefx;
 
 class codegen_hlsl final : public codegen
 {
 public:
-	codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants)
+	codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants, bool infer_reduced_precision)
 		: _shader_model(shader_model), _debug_info(debug_info), _uniforms_to_spec_constants(uniforms_to_spec_constants)
 	{
+		// Minimum precision types are only worth it in shader model 5 and up
+		_infer_reduced_precision = infer_reduced_precision && shader_model >= 50;
+
 		// Create default block and reserve a memory block to avoid frequent reallocations
 		std::string &block = _blocks.emplace(0, std::string()).first->second;
 		block.reserve(8192);
@@ -36,23 +43,78 @@ private:
 	};
 
 	std::string _cbuffer_block;
+	std::vector<std::string> _uniform_declarations;
+	std::vector<uint32_t> _constant_register_usage;
+	std::unordered_map<id, std::pair<uint32_t, uint32_t>> _uniform_registers;
+	std::unordered_map<id, std::pair<uint32_t, uint32_t>> _function_registers;
+	std::unordered_map<id, std::vector<id>> _function_calls;
+	std::vector<std::pair<id, std::string>> _entry_point_functions;
 	std::string _current_location;
 	std::unordered_map<id, std::string> _names;
+	std::unordered_set<std::string> _used_names;
+	std::unordered_map<std::string, uint32_t> _name_suffixes;
 	std::unordered_map<id, std::string> _blocks;
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
+	bool _infer_reduced_precision = false;
 	unsigned int _shader_model = 0;
+	precision_analysis _precision;
 
 	void write_result(module &module) override
 	{
+		if (_infer_reduced_precision)
+		{
+			_precision.resolve();
+
+			// Replace the precision markers (see 'write_precision_marker') now that it is known which values can be computed at reduced precision
+			std::string &code = _blocks.at(0);
+			for (size_t offset = 0; (offset = code.find("__RELAXED__", offset)) != std::string::npos;)
+			{
+				const id value = std::strtoul(code.c_str() + offset + 11, nullptr, 10);
+				const size_t end = code.find("__", offset + 11) + 2;
+				code.replace(offset, end - offset, _precision.is_relaxed(value) ? "min16" : "");
+			}
+		}
+
 		module = std::move(_module);
 
 		if (_shader_model >= 40)
 		{
 			module.hlsl += "struct __sampler2D { Texture2D t; SamplerState s; };\n";
 
+			// Lay out uniform variables only now that all of them are known, so that they can be sorted to minimize padding
+			size_t num_per_frame = 0;
+			const std::vector<size_t> order = optimize_uniform_layout(module.uniforms, num_per_frame);
+
+			std::string per_frame_cbuffer_block;
+			for (size_t i = 0; i < order.size(); ++i)
+			{
+				uniform_info &info = module.uniforms[order[i]];
+				const bool per_frame = i >= order.size() - num_per_frame;
+
+				// Uniform variables updated every frame go into a separate constant buffer, so the other one only has to be updated when a value is changed
+				// Offsets in that buffer are relative to its start, so begin it on a 16-byte boundary to keep packing identical
+				if (per_frame && i == order.size() - num_per_frame)
+					module.total_uniform_size = align_up(module.total_uniform_size, 16);
+
+				// Data is packed into 4-byte boundaries (see https://docs.microsoft.com/windows/win32/direct3dhlsl/dx-graphics-hlsl-packing-rules)
+				// This is already guaranteed, since all types are at least 4-byte in size
+				info.offset = module.total_uniform_size;
+				// Additionally, HLSL packs data so that it does not cross a 16-byte boundary
+				const uint32_t remaining = 16 - (info.offset & 15);
+				if (remaining != 16 && info.size > remaining)
+					info.offset += remaining;
+				module.total_uniform_size = info.offset + info.size;
+
+				(per_frame ? per_frame_cbuffer_block : _cbuffer_block) += _uniform_declarations[order[i]];
+			}
+
+			module.per_frame_uniform_offset = num_per_frame != 0 ? module.uniforms[order[order.size() - num_per_frame]].offset : module.total_uniform_size;
+
 			if (!_cbuffer_block.empty())
-				module.hlsl += "cbuffer _Globals {\n" + _cbuffer_block + "};\n";
+				module.hlsl += "cbuffer _Globals : register(b0) {\n" + _cbuffer_block + "};\n";
+			if (!per_frame_cbuffer_block.empty())
+				module.hlsl += "cbuffer _PerFrame : register(b1) {\n" + per_frame_cbuffer_block + "};\n";
 		}
 		else
 		{
@@ -61,8 +123,42 @@ private:
 			if (!_cbuffer_block.empty())
 				module.hlsl += _cbuffer_block;
 
-			// Offsets were multiplied in 'define_uniform', so adjust total size here accordingly
-			module.total_uniform_size *= 4;
+			// All uniform variables are uploaded together in shader model 3, so there is no separate per-frame range
+			module.per_frame_uniform_offset = module.total_uniform_size;
+
+			// Compute the range of constant registers each entry point reads from, by walking the call graph (global scope is tracked as function zero)
+			for (const auto &[entry_point_function, entry_point_name] : _entry_point_functions)
+			{
+				uint32_t first_register = std::numeric_limits<uint32_t>::max(), last_register = 0;
+
+				std::vector<id> stack = { 0, entry_point_function };
+				std::unordered_set<id> visited;
+				while (!stack.empty())
+				{
+					const id function = stack.back();
+					stack.pop_back();
+
+					if (!visited.insert(function).second)
+						continue;
+
+					if (const auto it = _function_registers.find(function); it != _function_registers.end())
+					{
+						first_register = std::min(first_register, it->second.first);
+						last_register = std::max(last_register, it->second.second);
+					}
+
+					if (const auto it = _function_calls.find(function); it != _function_calls.end())
+						stack.insert(stack.end(), it->second.begin(), it->second.end());
+				}
+
+				if (first_register < last_register)
+				{
+					entry_point &entry_point = *std::find_if(module.entry_points.begin(), module.entry_points.end(),
+						[&entry_point_name](const auto &ep) { return ep.name == entry_point_name; });
+					entry_point.first_constant_register = first_register;
+					entry_point.num_constant_registers = last_register - first_register;
+				}
+			}
 		}
 
 		module.hlsl += _blocks.at(0);
@@ -147,6 +243,12 @@ private:
 		if (type.cols > 1)
 			s += 'x' + std::to_string(type.cols);
 	}
+	void write_precision_marker(std::string &s, id value, const type &type) const
+	{
+		// Precision of a value is not known until all its uses were seen, so add a marker in front of the type of its declaration that is replaced in 'write_result'
+		if (_infer_reduced_precision && type.base == type::t_float)
+			s += "__RELAXED__" + std::to_string(value) + "__";
+	}
 	void write_constant(std::string &s, const type &type, const constant &data) const
 	{
 		if (type.is_array())
@@ -262,8 +364,20 @@ private:
 				return; // Filter out names that may clash with automatic ones
 		name = escape_name(std::move(name));
 		if constexpr (naming_type == naming::general)
-			if (std::find_if(_names.begin(), _names.end(), [&name](const auto &it) { return it.second == name; }) != _names.end())
-				name += '_' + std::to_string(id); // Append a numbered suffix if the name already exists
+		{
+			if (_used_names.find(name) != _used_names.end())
+			{
+				// Append a numbered suffix if the name already exists (continue counting from the last suffix used for this name, so this stays constant-time)
+				uint32_t &suffix = _name_suffixes[name];
+				std::string numbered_name;
+				do
+					numbered_name = name + '_' + std::to_string(++suffix);
+				while (_used_names.find(numbered_name) != _used_names.end());
+				name = std::move(numbered_name);
+			}
+		}
+		if constexpr (naming_type != naming::expression)
+			_used_names.insert(name);
 		_names[id] = std::move(name);
 	}
 
@@ -431,6 +545,9 @@ private:
 			code += ") }; \n";
 		}
 
+		if (_infer_reduced_precision)
+			_precision.add_sampler(info.id, *texture);
+
 		_module.samplers.push_back(info);
 
 		return info.id;
@@ -492,47 +609,93 @@ private:
 			if (info.type.is_array())
 				info.size = align_up(info.size, 16, info.type.array_length);
 
-			// Data is packed into 4-byte boundaries (see https://docs.microsoft.com/windows/win32/direct3dhlsl/dx-graphics-hlsl-packing-rules)
-			// This is already guaranteed, since all types are at least 4-byte in size
-			info.offset = _module.total_uniform_size;
-			// Additionally, HLSL packs data so that it does not cross a 16-byte boundary
-			const uint32_t remaining = 16 - (info.offset & 15);
-			if (remaining != 16 && info.size > remaining)
-				info.offset += remaining;
-			_module.total_uniform_size = info.offset + info.size;
-
-			write_location<true>(_cbuffer_block, loc);
-
-			if (_shader_model >= 40)
-				_cbuffer_block += '\t';
-			if (info.type.is_matrix()) // Force row major matrices
-				_cbuffer_block += "row_major ";
-
-			type type = info.type;
 			if (_shader_model < 40)
 			{
 				// The HLSL compiler tries to evaluate boolean values with temporary registers, which breaks branches, so force it to use constant float registers
+				type type = info.type;
 				if (type.is_boolean())
 					type.base = type::t_float;
 
-				// Simply put each uniform into a separate constant register in shader model 3 for now
-				info.offset *= 4;
-			}
+				if (const uint32_t num_components = info.size / 4; !info.type.is_array() && !info.type.is_matrix() && num_components < 4)
+				{
+					// Pack scalars and vectors into the first constant register that has enough components left, so that multiple of them can share a register
+					auto reg = std::find_if(_constant_register_usage.begin(), _constant_register_usage.end(),
+						[num_components](uint32_t used_components) { return used_components + num_components <= 4; });
+					if (reg == _constant_register_usage.end())
+					{
+						reg = _constant_register_usage.insert(reg, 0);
 
-			write_type(_cbuffer_block, type);
-			_cbuffer_block += ' ' + id_to_name(res);
+						const std::string reg_index = std::to_string(_constant_register_usage.size() - 1);
+						_cbuffer_block += "float4 __c" + reg_index + " : register(c" + reg_index + ");\n";
+					}
 
-			if (info.type.is_array())
-				_cbuffer_block += '[' + std::to_string(info.type.array_length) + ']';
+					const uint32_t reg_index = static_cast<uint32_t>(reg - _constant_register_usage.begin());
+					info.offset = reg_index * 16 + *reg * 4;
 
-			if (_shader_model < 40)
-			{
-				// Every constant register is 16 bytes wide, so divide memory offset by 16 to get the constant register index
-				// Note: All uniforms are floating-point in shader model 3, even if the uniform type says different!!
-				_cbuffer_block += " : register(c" + std::to_string(info.offset / 16) + ')';
+					// Refer to the components of the shared register directly in code, instead of declaring a separate variable
+					std::string expr_code = "__c" + std::to_string(reg_index) + '.';
+					for (uint32_t i = 0; i < num_components; ++i)
+						expr_code += "xyzw"[*reg + i];
+					*reg += num_components;
+
+					// Note: All uniforms are floating-point in shader model 3, even if the uniform type says different!!
+					if (type.is_floating_point())
+					{
+						expr_code = '(' + expr_code + ')';
+					}
+					else
+					{
+						std::string type_code;
+						write_type<false, false>(type_code, type);
+						expr_code = "((" + type_code + ')' + expr_code + ')';
+					}
+
+					define_name<naming::expression>(res, std::move(expr_code));
+				}
+				else
+				{
+					// Everything else gets a range of constant registers of its own (each row of a matrix and each array element starts a new register)
+					info.offset = static_cast<uint32_t>(_constant_register_usage.size()) * 16;
+					_constant_register_usage.resize(_constant_register_usage.size() + (info.size + 15) / 16, 4);
+
+					write_location<true>(_cbuffer_block, loc);
+
+					if (info.type.is_matrix()) // Force row major matrices
+						_cbuffer_block += "row_major ";
+
+					write_type(_cbuffer_block, type);
+					_cbuffer_block += ' ' + id_to_name(res);
+
+					if (info.type.is_array())
+						_cbuffer_block += '[' + std::to_string(info.type.array_length) + ']';
+
+					// Every constant register is 16 bytes wide, so divide memory offset by 16 to get the constant register index
+					_cbuffer_block += " : register(c" + std::to_string(info.offset / 16) + ");\n";
+				}
+
+				_module.total_uniform_size = static_cast<uint32_t>(_constant_register_usage.size()) * 16;
+
+				_uniform_registers[res] = { info.offset / 16, (info.offset + info.size + 15) / 16 };
 			}
+			else
+			{
+				// Offsets are assigned in 'write_result' in shader model 4 and up, once all uniform variables are known
+				std::string &code = _uniform_declarations.emplace_back();
+
+				write_location<true>(code, loc);
+
+				code += '\t';
+				if (info.type.is_matrix()) // Force row major matrices
+					code += "row_major ";
 
-			_cbuffer_block += ";\n";
+				write_type(code, info.type);
+				code += ' ' + id_to_name(res);
+
+				if (info.type.is_array())
+					code += '[' + std::to_string(info.type.array_length) + ']';
+
+				code += ";\n";
+			}
 
 			_module.uniforms.push_back(info);
 		}
@@ -551,7 +714,10 @@ private:
 		write_location(code, loc);
 
 		if (!global)
+		{
 			code += '\t';
+			write_precision_marker(code, res, type);
+		}
 
 		write_type(code, type);
 		code += ' ' + id_to_name(res);
@@ -564,6 +730,9 @@ private:
 
 		code += ";\n";
 
+		if (_infer_reduced_precision && initializer_value != 0)
+			_precision.add_merge(res, type, initializer_value);
+
 		return res;
 	}
 	id   define_function(const location &loc, function_info &info) override
@@ -616,6 +785,19 @@ private:
 
 	void define_entry_point(function_info &func, shader_type stype, int num_threads[3]) override
 	{
+		if (_infer_reduced_precision)
+		{
+			const auto is_color_output = [stype](const std::string &semantic) {
+				return stype == shader_type::ps && (semantic.compare(0, 9, "SV_TARGET") == 0 || semantic.compare(0, 5, "COLOR") == 0); };
+
+			// Only color outputs of pixel shaders end up in render targets that do not need full precision
+			if (!func.return_type.is_void() && !is_color_output(func.return_semantic))
+				_precision.add_sensitive_use(func.definition);
+			for (const struct_member_info &param : func.parameter_list)
+				if (param.type.has(type::q_out) && !is_color_output(param.semantic))
+					_precision.add_sensitive_use(param.definition);
+		}
+
 		// Modify entry point name since a new function is created for it below
 		if (stype == shader_type::cs)
 			func.unique_name = 'E' + func.unique_name +
@@ -629,7 +811,7 @@ private:
 			[&func](const auto &ep) { return ep.name == func.unique_name; }); it != _module.entry_points.end())
 			return;
 
-		_module.entry_points.push_back({ func.unique_name, stype });
+		_module.entry_points.push_back({ func.unique_name, stype, func.may_discard, func.is_full_screen_triangle, func.cost });
 
 		// Only have to rewrite the entry point function signature in shader model 3 and for compute (to write "numthreads" attribute)
 		if (_shader_model >= 40 && stype != shader_type::cs)
@@ -700,6 +882,10 @@ private:
 		define_function({}, entry_point);
 		enter_block(create_block());
 
+		// Keep track of which function this entry point calls, to find all constant registers it uses in 'write_result'
+		_function_calls[entry_point.definition].push_back(func.definition);
+		_entry_point_functions.emplace_back(entry_point.definition, func.unique_name);
+
 		std::string &code = _blocks.at(_current_block);
 
 		// Clear all color output parameters so no component is left uninitialized
@@ -762,7 +948,19 @@ private:
 	{
 		if (exp.is_constant)
 			return emit_constant(exp.type, exp.constant);
-		else if (exp.chain.empty() && !force_new_id) // Can refer to values without access chain directly
+
+		if (const auto it = _uniform_registers.find(exp.base); it != _uniform_registers.end())
+		{
+			// Keep track of the constant registers each function reads from (with global scope being function zero)
+			const auto [range, inserted] = _function_registers.try_emplace(_current_block != 0 ? _functions.back()->definition : 0, it->second);
+			if (!inserted)
+			{
+				range->second.first = std::min(range->second.first, it->second.first);
+				range->second.second = std::max(range->second.second, it->second.second);
+			}
+		}
+
+		if (exp.chain.empty() && !force_new_id) // Can refer to values without access chain directly
 			return exp.base;
 
 		const id res = make_id();
@@ -785,6 +983,9 @@ private:
 				write_type<false, false>(type, op.to);
 				// Cast is in parentheses so that a subsequent operation operates on the casted value
 				expr_code = "((" + type + ')' + expr_code + ')';
+				// Conversion to integer truncates, so small errors can change the result completely
+				if (_infer_reduced_precision && !op.to.is_floating_point())
+					_precision.add_sensitive_use(exp.base);
 				break;
 			case expression::operation::op_member:
 				expr_code += '.';
@@ -792,6 +993,8 @@ private:
 				break;
 			case expression::operation::op_dynamic_index:
 				expr_code += '[' + id_to_name(op.index) + ']';
+				if (_infer_reduced_precision)
+					_precision.add_sensitive_use(op.index);
 				break;
 			case expression::operation::op_constant_index:
 				if (op.from.is_vector() && !op.from.is_array())
@@ -817,6 +1020,7 @@ private:
 			std::string &code = _blocks.at(_current_block);
 
 			code += '\t';
+			write_precision_marker(code, res, exp.type);
 			write_type(code, exp.type);
 			code += ' ' + id_to_name(res) + " = " + expr_code + ";\n";
 		}
@@ -826,6 +1030,9 @@ private:
 			define_name<naming::expression>(res, std::move(expr_code));
 		}
 
+		if (_infer_reduced_precision)
+			_precision.add_merge(res, exp.type, exp.base);
+
 		return res;
 	}
 	void emit_store(const expression &exp, id value) override
@@ -853,6 +1060,8 @@ private:
 				break;
 			case expression::operation::op_dynamic_index:
 				code += '[' + id_to_name(op.index) + ']';
+				if (_infer_reduced_precision)
+					_precision.add_sensitive_use(op.index);
 				break;
 			case expression::operation::op_constant_index:
 				code += '[' + std::to_string(op.index) + ']';
@@ -869,6 +1078,9 @@ private:
 		}
 
 		code += " = " + id_to_name(value) + ";\n";
+
+		if (_infer_reduced_precision)
+			_precision.add_merge(exp.base, exp.chain.empty() ? exp.type : exp.chain[0].from, value);
 	}
 
 	id   emit_constant(const type &type, const constant &data) override
@@ -894,6 +1106,9 @@ private:
 		write_constant(code, type, data);
 		define_name<naming::expression>(res, std::move(code));
 
+		if (_infer_reduced_precision)
+			_precision.add_constant(res, type, data);
+
 		return res;
 	}
 
@@ -906,6 +1121,7 @@ private:
 		write_location(code, loc);
 
 		code += '\t';
+		write_precision_marker(code, res, res_type);
 		write_type(code, res_type);
 		code += ' ' + id_to_name(res) + " = ";
 
@@ -916,6 +1132,14 @@ private:
 
 		code += id_to_name(val) + ";\n";
 
+		if (_infer_reduced_precision)
+		{
+			if (op == tokenid::minus)
+				_precision.add_operation(res, res_type, { val });
+			else
+				_precision.add_sensitive_use(val);
+		}
+
 		return res;
 	}
 	id   emit_binary_op(const location &loc, tokenid op, const type &res_type, const type &, id lhs, id rhs) override
@@ -927,6 +1151,7 @@ private:
 		write_location(code, loc);
 
 		code += '\t';
+		write_precision_marker(code, res, res_type);
 		write_type(code, res_type);
 		code += ' ' + id_to_name(res) + " = ";
 
@@ -1025,6 +1250,32 @@ private:
 
 		code += ";\n";
 
+		if (_infer_reduced_precision)
+		{
+			switch (op)
+			{
+			case tokenid::plus:
+			case tokenid::plus_plus:
+			case tokenid::plus_equal:
+			case tokenid::minus:
+			case tokenid::minus_minus:
+			case tokenid::minus_equal:
+			case tokenid::star:
+			case tokenid::star_equal:
+				_precision.add_operation(res, res_type, { lhs, rhs });
+				break;
+			case tokenid::slash:
+			case tokenid::slash_equal:
+				_precision.add_division(res, res_type, lhs, rhs);
+				break;
+			default:
+				// Comparisons and integer operations need the exact value of their operands
+				_precision.add_sensitive_use(lhs);
+				_precision.add_sensitive_use(rhs);
+				break;
+			}
+		}
+
 		return res;
 	}
 	id   emit_ternary_op(const location &loc, tokenid op, const type &res_type, id condition, id true_value, id false_value) override
@@ -1039,6 +1290,7 @@ private:
 		write_location(code, loc);
 
 		code += '\t';
+		write_precision_marker(code, res, res_type);
 		write_type(code, res_type);
 		code += ' ' + id_to_name(res);
 
@@ -1047,6 +1299,13 @@ private:
 
 		code += " = " + id_to_name(condition) + " ? " + id_to_name(true_value) + " : " + id_to_name(false_value) + ";\n";
 
+		if (_infer_reduced_precision)
+		{
+			_precision.add_sensitive_use(condition);
+			_precision.add_merge(res, res_type, true_value);
+			_precision.add_merge(res, res_type, false_value);
+		}
+
 		return res;
 	}
 	id   emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) override
@@ -1058,6 +1317,8 @@ private:
 
 		const id res = make_id();
 
+		_function_calls[_functions.back()->definition].push_back(function);
+
 		std::string &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
@@ -1066,6 +1327,7 @@ private:
 
 		if (!res_type.is_void())
 		{
+			write_precision_marker(code, res, res_type);
 			write_type(code, res_type);
 			code += ' ' + id_to_name(res);
 
@@ -1087,6 +1349,22 @@ private:
 
 		code += ");\n";
 
+		if (_infer_reduced_precision)
+		{
+			// Values flow from arguments into parameters, from output parameters back into arguments and from the return statements to the call result
+			const function_info &info = find_function(function);
+			for (size_t i = 0, num_args = args.size(); i < num_args; ++i)
+			{
+				const struct_member_info &param = info.parameter_list[i];
+				_precision.add_merge(param.definition, param.type, args[i].base);
+				if (param.type.has(type::q_out))
+					_precision.add_merge(args[i].base, args[i].type, param.definition);
+			}
+
+			if (!res_type.is_void())
+				_precision.add_merge(res, res_type, function);
+		}
+
 		return res;
 	}
 	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::vector<expression> &args) override
@@ -1123,6 +1401,7 @@ private:
 		}
 		else if (!res_type.is_void())
 		{
+			write_precision_marker(code, res, res_type);
 			write_type(code, res_type);
 			code += ' ' + id_to_name(res) + " = ";
 		}
@@ -1137,6 +1416,51 @@ private:
 
 		code += ";\n";
 
+		if (_infer_reduced_precision)
+		{
+			switch (intrinsic)
+			{
+			case tex2D0:
+			case tex2D1:
+			case tex2Dlod0:
+			case tex2Dlod1:
+			case tex2Dfetch0:
+			case tex2Dfetch1:
+			case tex2DgatherR0:
+			case tex2DgatherR1:
+			case tex2DgatherG0:
+			case tex2DgatherG1:
+			case tex2DgatherB0:
+			case tex2DgatherB1:
+			case tex2DgatherA0:
+			case tex2DgatherA1:
+				// Texture coordinates always need full precision, only the fetched value may not
+				_precision.add_fetch(res, res_type, args[0].base);
+				for (size_t i = 1; i < args.size(); ++i)
+					_precision.add_sensitive_use(args[i].base);
+				break;
+			case abs1:
+			case saturate0:
+			case min1:
+			case max1:
+			case clamp2:
+			case lerp0:
+			case mad0:
+			case dot0:
+			{
+				std::vector<id> operands;
+				for (const expression &arg : args)
+					operands.push_back(arg.base);
+				_precision.add_operation(res, res_type, operands);
+				break;
+			}
+			default:
+				for (const expression &arg : args)
+					_precision.add_sensitive_use(arg.base);
+				break;
+			}
+		}
+
 		return res;
 	}
 	id   emit_construct(const location &loc, const type &type, const std::vector<expression> &args) override
@@ -1153,6 +1477,7 @@ private:
 		write_location(code, loc);
 
 		code += '\t';
+		write_precision_marker(code, res, type);
 		write_type(code, type);
 		code += ' ' + id_to_name(res);
 
@@ -1181,6 +1506,10 @@ private:
 
 		code += ";\n";
 
+		if (_infer_reduced_precision)
+			for (const expression &arg : args)
+				_precision.add_merge(res, type, arg.base);
+
 		return res;
 	}
 
@@ -1238,6 +1567,7 @@ private:
 		code += _blocks.at(condition_block);
 
 		code += '\t';
+		write_precision_marker(code, res, type);
 		write_type(code, type);
 		code += ' ' + id_to_name(res) + ";\n";
 
@@ -1256,6 +1586,12 @@ private:
 		_blocks.erase(true_statement_block);
 		_blocks.erase(false_statement_block);
 
+		if (_infer_reduced_precision)
+		{
+			_precision.add_merge(res, type, true_value);
+			_precision.add_merge(res, type, false_value);
+		}
+
 		return res;
 	}
 	void emit_loop(const location &loc, id condition_value, id prev_block, id header_block, id condition_block, id loop_block, id continue_block, unsigned int flags) override
@@ -1556,6 +1892,9 @@ private:
 
 		code += ";\n";
 
+		if (_infer_reduced_precision && value != 0)
+			_precision.add_merge(_functions.back()->definition, _functions.back()->return_type, value);
+
 		return set_block(0);
 	}
 	id   leave_block_and_switch(id, id) override
@@ -1599,7 +1938,7 @@ private:
 	}
 };
 
-codegen *reshadefx::create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants)
+codegen *reshadefx::create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants, bool infer_reduced_precision)
 {
-	return new codegen_hlsl(shader_model, debug_info, uniforms_to_spec_constants);
+	return new codegen_hlsl(shader_model, debug_info, uniforms_to_spec_constants, infer_reduced_precision);
 }
@@ -5,6 +5,7 @@
 
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include "effect_precision.hpp"
 #include <cassert>
 #include <cstring> // memcmp
 #include <algorithm> // std::find_if, std::max
@@ -116,8 +117,8 @@ struct spirv_basic_block
 class codegen_spirv final : public codegen
 {
 public:
-	codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y)
-		: _debug_info(debug_info), _vulkan_semantics(vulkan_semantics), _uniforms_to_spec_constants(uniforms_to_spec_constants), _enable_16bit_types(enable_16bit_types), _flip_vert_y(flip_vert_y)
+	codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y, bool infer_reduced_precision)
+		: _debug_info(debug_info), _vulkan_semantics(vulkan_semantics), _uniforms_to_spec_constants(uniforms_to_spec_constants), _enable_16bit_types(enable_16bit_types), _flip_vert_y(flip_vert_y), _infer_reduced_precision(infer_reduced_precision)
 	{
 		_glsl_ext = make_id();
 	}
@@ -180,12 +181,17 @@ private:
 	bool _uniforms_to_spec_constants = false;
 	bool _enable_16bit_types = false;
 	bool _flip_vert_y = false;
+	bool _infer_reduced_precision = false;
 	id _glsl_ext = 0;
 	id _global_ubo_type = 0;
 	id _global_ubo_variable = 0;
 	std::vector<spv::Id> _global_ubo_types;
+	std::vector<uint32_t> _global_ubo_alignments;
 	function_blocks *_current_function = nullptr;
 
+	precision_analysis _precision;
+	std::vector<spv::Id> _relaxed_precision_candidates;
+
 	inline void add_location(const location &loc, spirv_basic_block &block)
 	{
 		if (loc.source.empty() || !_debug_info)
@@ -244,6 +250,26 @@ private:
 		// First initialize the UBO type now that all member types are known
 		if (_global_ubo_type != 0)
 		{
+			// Lay out uniform variables so that they waste as little space on padding as possible
+			// Members can be placed at arbitrary offsets in SPIR-V, so this does not affect the order of the member types
+			size_t num_per_frame = 0;
+			const std::vector<size_t> order = optimize_uniform_layout(_module.uniforms, num_per_frame);
+
+			for (const size_t index : order)
+			{
+				uniform_info &info = _module.uniforms[index];
+
+				info.offset = _module.total_uniform_size;
+				info.offset = align_up(info.offset, _global_ubo_alignments[index]);
+				_module.total_uniform_size = info.offset + info.size;
+
+				add_member_decoration(_global_ubo_type, static_cast<uint32_t>(index), spv::DecorationOffset, { info.offset });
+			}
+
+			// Uniform variables updated every frame end up at the end of the buffer, so that they can be uploaded separately
+			_module.per_frame_uniform_offset = num_per_frame != 0 ? _module.uniforms[order[order.size() - num_per_frame]].offset : _module.total_uniform_size;
+
+
 			spirv_instruction &type_inst = add_instruction_without_result(spv::OpTypeStruct, _types_and_constants);
 			type_inst.add(_global_ubo_types.begin(), _global_ubo_types.end());
 			type_inst.result = _global_ubo_type;
@@ -256,6 +282,15 @@ private:
 			add_name(variable_inst.result, "$Globals");
 		}
 
+		if (_infer_reduced_precision)
+		{
+			_precision.resolve();
+
+			for (const spv::Id value : _relaxed_precision_candidates)
+				if (_precision.is_relaxed(value))
+					add_decoration(value, spv::DecorationRelaxedPrecision);
+		}
+
 		module = std::move(_module);
 
 		// Write SPIRV header info
@@ -632,6 +667,12 @@ private:
 			.add(decoration)
 			.add(values.begin(), values.end());
 	}
+	inline void add_relaxed_precision_candidate(spv::Id value, const type &type)
+	{
+		// Only values with a floating-point type can be decorated (see 'write_result')
+		if (_infer_reduced_precision && type.base == type::t_float)
+			_relaxed_precision_candidates.push_back(value);
+	}
 	inline void add_capability(spv::Capability capability)
 	{
 		_capabilities.insert(capability);
@@ -686,6 +727,15 @@ private:
 		add_decoration(info.id, spv::DecorationBinding, { info.binding });
 		add_decoration(info.id, spv::DecorationDescriptorSet, { 1 });
 
+		if (_infer_reduced_precision)
+		{
+			const auto texture = std::find_if(_module.textures.begin(), _module.textures.end(),
+				[&info](const auto &it) { return it.unique_name == info.texture_name; });
+			assert(texture != _module.textures.end());
+
+			_precision.add_sampler(info.id, *texture);
+		}
+
 		_module.samplers.push_back(info);
 
 		return info.id;
@@ -814,9 +864,8 @@ private:
 				info.size = array_stride * info.type.array_length;
 			}
 
-			info.offset = _module.total_uniform_size;
-			info.offset = align_up(info.offset, alignment);
-			_module.total_uniform_size = info.offset + info.size;
+			// Offsets are assigned in 'write_result', once all uniform variables are known
+			_global_ubo_alignments.push_back(alignment);
 
 			type ubo_type = info.type;
 			// Convert boolean uniform variables to integer type so that they have a defined size
@@ -831,8 +880,6 @@ private:
 
 			add_member_name(_global_ubo_type, member_index, info.name.c_str());
 
-			add_member_decoration(_global_ubo_type, member_index, spv::DecorationOffset, { info.offset });
-
 			if (info.type.is_matrix())
 			{
 				// Read matrices in column major layout, even though they are actually row major, to avoid transposing them on every access (since SPIR-V uses column matrices)
@@ -891,6 +938,8 @@ private:
 
 		if (!_enable_16bit_types && type.is_numeric() && type.precision() < 32)
 			add_decoration(res, spv::DecorationRelaxedPrecision);
+		else if (storage == spv::StorageClassFunction)
+			add_relaxed_precision_candidate(res, type);
 
 		_storage_lookup[res] = storage;
 
@@ -934,6 +983,19 @@ private:
 
 	void define_entry_point(function_info &func, shader_type stype, int num_threads[3]) override
 	{
+		if (_infer_reduced_precision)
+		{
+			const auto is_color_output = [stype](const std::string &semantic) {
+				return stype == shader_type::ps && (semantic.compare(0, 9, "SV_TARGET") == 0 || semantic.compare(0, 5, "COLOR") == 0); };
+
+			// Only color outputs of pixel shaders end up in render targets that do not need full precision
+			if (!func.return_type.is_void() && !is_color_output(func.return_semantic))
+				_precision.add_sensitive_use(func.definition);
+			for (const struct_member_info &param : func.parameter_list)
+				if (param.type.has(type::q_out) && !is_color_output(param.semantic))
+					_precision.add_sensitive_use(param.definition);
+		}
+
 		// Modify entry point name so each thread configuration is made separate
 		if (stype == shader_type::cs)
 			func.unique_name = 'E' + func.unique_name +
@@ -945,7 +1007,7 @@ private:
 			[&func](const auto &ep) { return ep.name == func.unique_name; }); it != _module.entry_points.end())
 			return;
 
-		_module.entry_points.push_back({ func.unique_name, stype });
+		_module.entry_points.push_back({ func.unique_name, stype, func.may_discard, func.is_full_screen_triangle, func.cost });
 
 		spv::Id position_variable = 0, point_size_variable = 0;
 		std::vector<spv::Id> inputs_and_outputs;
@@ -1506,6 +1568,21 @@ private:
 			}
 		}
 
+		if (_infer_reduced_precision && result != exp.base)
+		{
+			for (const auto &op : exp.chain)
+			{
+				if (op.op == expression::operation::op_dynamic_index)
+					_precision.add_sensitive_use(op.index);
+				// Conversion to integer truncates, so small errors can change the result completely
+				else if (op.op == expression::operation::op_cast && !op.to.is_floating_point())
+					_precision.add_sensitive_use(exp.base);
+			}
+
+			_precision.add_merge(result, exp.type, exp.base);
+			add_relaxed_precision_candidate(result, exp.type);
+		}
+
 		return result;
 	}
 	void emit_store(const expression &exp, id value) override
@@ -1514,6 +1591,15 @@ private:
 
 		add_location(exp.location, *_current_block_data);
 
+		if (_infer_reduced_precision)
+		{
+			for (const auto &op : exp.chain)
+				if (op.op == expression::operation::op_dynamic_index)
+					_precision.add_sensitive_use(op.index);
+
+			_precision.add_merge(exp.base, exp.chain.empty() ? exp.type : exp.chain[0].from, value);
+		}
+
 		size_t i = 0;
 		// Any indexing expressions can be resolved with an 'OpAccessChain' already
 		spv::Id target = emit_access_chain(exp, i);
@@ -1648,7 +1734,12 @@ private:
 	}
 	id   emit_constant(const type &type, const constant &data) override
 	{
-		return emit_constant(type, data, false);
+		const id res = emit_constant(type, data, false);
+
+		if (_infer_reduced_precision)
+			_precision.add_constant(res, type, data);
+
+		return res;
 	}
 	id   emit_constant(const type &type, const constant &data, bool spec_constant)
 	{
@@ -1772,6 +1863,16 @@ private:
 		spirv_instruction &inst = add_instruction(spv_op, convert_type(type));
 		inst.add(val); // Operand
 
+		if (_infer_reduced_precision)
+		{
+			if (op == tokenid::minus)
+				_precision.add_operation(inst.result, type, { val });
+			else
+				_precision.add_sensitive_use(val);
+
+			add_relaxed_precision_candidate(inst.result, type);
+		}
+
 		return inst.result;
 	}
 	id   emit_binary_op(const location &loc, tokenid op, const type &res_type, const type &type, id lhs, id rhs) override
@@ -1867,6 +1968,34 @@ private:
 		if (!_enable_16bit_types && res_type.precision() < 32)
 			add_decoration(inst.result, spv::DecorationRelaxedPrecision);
 
+		if (_infer_reduced_precision)
+		{
+			switch (op)
+			{
+			case tokenid::plus:
+			case tokenid::plus_plus:
+			case tokenid::plus_equal:
+			case tokenid::minus:
+			case tokenid::minus_minus:
+			case tokenid::minus_equal:
+			case tokenid::star:
+			case tokenid::star_equal:
+				_precision.add_operation(inst.result, res_type, { lhs, rhs });
+				break;
+			case tokenid::slash:
+			case tokenid::slash_equal:
+				_precision.add_division(inst.result, res_type, lhs, rhs);
+				break;
+			default:
+				// Comparisons and integer operations need the exact value of their operands
+				_precision.add_sensitive_use(lhs);
+				_precision.add_sensitive_use(rhs);
+				break;
+			}
+
+			add_relaxed_precision_candidate(inst.result, res_type);
+		}
+
 		return inst.result;
 	}
 	id   emit_ternary_op(const location &loc, tokenid op, const type &type, id condition, id true_value, id false_value) override
@@ -1881,6 +2010,14 @@ private:
 		inst.add(true_value); // Object 1
 		inst.add(false_value); // Object 2
 
+		if (_infer_reduced_precision)
+		{
+			_precision.add_sensitive_use(condition);
+			_precision.add_merge(inst.result, type, true_value);
+			_precision.add_merge(inst.result, type, false_value);
+			add_relaxed_precision_candidate(inst.result, type);
+		}
+
 		return inst.result;
 	}
 	id   emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) override
@@ -1897,6 +2034,25 @@ private:
 		for (const expression &arg : args)
 			inst.add(arg.base); // Arguments
 
+		if (_infer_reduced_precision)
+		{
+			// Values flow from arguments into parameters, from output parameters back into arguments and from the return statements to the call result
+			const function_info &info = find_function(function);
+			for (size_t i = 0; i < args.size(); ++i)
+			{
+				const struct_member_info &param = info.parameter_list[i];
+				_precision.add_merge(param.definition, param.type, args[i].base);
+				if (param.type.has(type::q_out))
+					_precision.add_merge(args[i].base, args[i].type, param.definition);
+			}
+
+			if (!res_type.is_void())
+			{
+				_precision.add_merge(inst.result, res_type, function);
+				add_relaxed_precision_candidate(inst.result, res_type);
+			}
+		}
+
 		return inst.result;
 	}
 	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::vector<expression> &args) override
@@ -1907,6 +2063,65 @@ private:
 #endif
 		add_location(loc, *_current_block_data);
 
+		const spv::Id res = emit_intrinsic_code(intrinsic, res_type, args);
+
+		if (_infer_reduced_precision)
+		{
+			enum
+			{
+#define IMPLEMENT_INTRINSIC_SPIRV(name, i, code) name##i,
+#include "effect_symbol_table_intrinsics.inl"
+			};
+
+			switch (intrinsic)
+			{
+			case tex2D0:
+			case tex2D1:
+			case tex2Dlod0:
+			case tex2Dlod1:
+			case tex2Dfetch0:
+			case tex2Dfetch1:
+			case tex2DgatherR0:
+			case tex2DgatherR1:
+			case tex2DgatherG0:
+			case tex2DgatherG1:
+			case tex2DgatherB0:
+			case tex2DgatherB1:
+			case tex2DgatherA0:
+			case tex2DgatherA1:
+				// Texture coordinates always need full precision, only the fetched value may not
+				_precision.add_fetch(res, res_type, args[0].base);
+				for (size_t i = 1; i < args.size(); ++i)
+					_precision.add_sensitive_use(args[i].base);
+				break;
+			case abs1:
+			case saturate0:
+			case min1:
+			case max1:
+			case clamp2:
+			case lerp0:
+			case mad0:
+			case dot0:
+			{
+				std::vector<spv::Id> operands;
+				for (const expression &arg : args)
+					operands.push_back(arg.base);
+				_precision.add_operation(res, res_type, operands);
+				break;
+			}
+			default:
+				for (const expression &arg : args)
+					_precision.add_sensitive_use(arg.base);
+				break;
+			}
+
+			add_relaxed_precision_candidate(res, res_type);
+		}
+
+		return res;
+	}
+	id   emit_intrinsic_code(id intrinsic, const type &res_type, const std::vector<expression> &args)
+	{
 		enum
 		{
 #define IMPLEMENT_INTRINSIC_SPIRV(name, i, code) name##i,
@@ -1964,6 +2179,14 @@ private:
 		spirv_instruction &inst = add_instruction(spv::OpCompositeConstruct, convert_type(type));
 		inst.add(ids.begin(), ids.end());
 
+		if (_infer_reduced_precision)
+		{
+			for (const expression &arg : args)
+				_precision.add_merge(inst.result, type, arg.base);
+
+			add_relaxed_precision_candidate(inst.result, type);
+		}
+
 		return inst.result;
 	}
 
@@ -2018,6 +2241,13 @@ private:
 			.add(false_value) // Variable 1
 			.add(false_statement_block); // Parent 1
 
+		if (_infer_reduced_precision)
+		{
+			_precision.add_merge(inst.result, type, true_value);
+			_precision.add_merge(inst.result, type, false_value);
+			add_relaxed_precision_candidate(inst.result, type);
+		}
+
 		return inst.result;
 	}
 	void emit_loop(const location &loc, id, id prev_block, id header_block, id condition_block, id loop_block, id continue_block, unsigned int loop_control) override
@@ -2133,6 +2363,9 @@ private:
 		if (!is_in_block()) // Might already have left the last block in which case this has to be ignored
 			return 0;
 
+		if (_infer_reduced_precision && value != 0)
+			_precision.add_merge(_functions.back()->definition, _current_function->return_type, value);
+
 		if (_current_function->return_type.is_void())
 		{
 			add_instruction_without_result(spv::OpReturn);
@@ -2203,7 +2436,7 @@ private:
 	}
 };
 
-codegen *reshadefx::create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y)
+codegen *reshadefx::create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y, bool infer_reduced_precision)
 {
-	return new codegen_spirv(vulkan_semantics, debug_info, uniforms_to_spec_constants, enable_16bit_types, flip_vert_y);
+	return new codegen_spirv(vulkan_semantics, debug_info, uniforms_to_spec_constants, enable_16bit_types, flip_vert_y, infer_reduced_precision);
 }
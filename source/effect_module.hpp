@@ -6,6 +6,7 @@
 #pragma once
 
 #include "effect_expression.hpp"
+#include <unordered_map>
 
 namespace reshadefx
 {
@@ -234,6 +235,18 @@ namespace reshadefx
 		cs,
 	};
 
+	/// <summary>
+	/// A static estimate of the work a shader does per invocation (or per thread group for compute shaders).
+	/// </summary>
+	struct shader_cost
+	{
+		uint32_t texture_fetches = 0;
+		// Number of arithmetic operations, with every component of a vector operation counted separately
+		uint32_t alu_operations = 0;
+		// Set if there is a loop whose number of iterations is not known at compile time, in which case its body was only counted once
+		bool has_unbounded_loops = false;
+	};
+
 	/// <summary>
 	/// A shader entry point function.
 	/// </summary>
@@ -241,6 +254,14 @@ namespace reshadefx
 	{
 		std::string name;
 		shader_type type;
+		// Set if the entry point may discard pixels, in which case it does not necessarily write to all pixels it covers
+		bool may_discard = false;
+		// Set if the entry point is a vertex shader that is proven to generate a triangle covering the entire render target (see 'function_info::is_full_screen_triangle')
+		bool is_full_screen_triangle = false;
+		shader_cost cost;
+		// Range of constant registers that hold uniform variables this entry point reads from (only filled in for HLSL shader model 3)
+		uint32_t first_constant_register = 0;
+		uint32_t num_constant_registers = 0;
 	};
 
 	/// <summary>
@@ -256,6 +277,12 @@ namespace reshadefx
 		std::vector<struct_member_info> parameter_list;
 		std::vector<uint32_t> referenced_samplers;
 		std::vector<uint32_t> referenced_storages;
+		// Samplers that are sampled anywhere but at the unmodified texture coordinate the function receives, so that a pixel may depend on other texels than its own
+		std::vector<uint32_t> non_local_samplers;
+		bool may_discard = false;
+		// Set if the function is the vertex shader commonly used for post-processing passes (the 'PostProcessVS' function from 'ReShade.fxh'), which generates a triangle covering the entire render target from the vertex index
+		bool is_full_screen_triangle = false;
+		shader_cost cost;
 	};
 
 	/// <summary>
@@ -293,6 +320,8 @@ namespace reshadefx
 		uint32_t viewport_dispatch_z = 1;
 		std::vector<sampler_info> samplers;
 		std::vector<storage_info> storages;
+		// Unique names of the samplers that are only ever sampled by the pixel shader at the unmodified texture coordinate it receives, so that each pixel only reads the same texel of the texture
+		std::vector<std::string> texel_local_samplers;
 	};
 
 	/// <summary>
@@ -312,6 +341,7 @@ namespace reshadefx
 	{
 		std::string hlsl;
 		std::vector<uint32_t> spirv;
+		std::unordered_map<std::string, std::string> minified_names;
 
 		std::vector<entry_point> entry_points;
 		std::vector<texture_info> textures;
@@ -321,6 +351,8 @@ namespace reshadefx
 		std::vector<technique_info> techniques;
 
 		uint32_t total_uniform_size = 0;
+		// Uniform variables updated every frame by the runtime are packed behind all others, starting at this offset (equal to the total size if there are none)
+		uint32_t per_frame_uniform_offset = 0;
 		uint32_t num_texture_bindings = 0;
 		uint32_t num_sampler_bindings = 0;
 		uint32_t num_storage_bindings = 0;
@@ -7,6 +7,7 @@
 
 #include "effect_symbol_table.hpp"
 #include <memory> // std::unique_ptr
+#include <functional>
 
 namespace reshadefx
 {
@@ -28,6 +29,12 @@ namespace reshadefx
 		/// <returns>A boolean value indicating whether parsing was successful or not.</returns>
 		bool parse(std::string source, class codegen *backend);
 
+		/// <summary>
+		/// Set a function that is called before every top-level declaration, which aborts parsing (with failure) when it returns <c>true</c>.
+		/// </summary>
+		/// <param name="callback">The function to call, or an empty function to never abort.</param>
+		void set_abort_callback(std::function<bool()> callback) { _abort_callback = std::move(callback); }
+
 		/// <summary>
 		/// Get the list of error messages.
 		/// </summary>
@@ -75,6 +82,9 @@ namespace reshadefx
 		bool parse_statement(bool scoped);
 		bool parse_statement_block(bool scoped);
 
+		bool peek_loop_trip_count(uint32_t &trip_count);
+		void count_alu_operations(const type &type);
+
 		codegen *_codegen = nullptr;
 		std::string _errors;
 		token _token, _token_next, _token_backup;
@@ -83,5 +93,11 @@ namespace reshadefx
 		std::vector<uint32_t> _loop_break_target_stack;
 		std::vector<uint32_t> _loop_continue_target_stack;
 		reshadefx::function_info *_current_function = nullptr;
+		// Samplers the current function samples at one of its texture coordinate parameters, which only counts as sampling the same texel if that parameter is never modified
+		std::vector<std::pair<uint32_t, uint32_t>> _texcoord_samples;
+		std::vector<uint32_t> _modified_variables;
+		// Number of times the code that is currently parsed runs per call of the current function, based on the iteration counts of the loops it is in
+		uint32_t _cost_multiplier = 1;
+		std::function<bool()> _abort_callback;
 	};
 }
@@ -7,6 +7,8 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include <cassert>
+#include <iterator> // std::next
+#include <algorithm> // std::find, std::find_if
 
 reshadefx::parser::parser()
 {
@@ -43,6 +45,12 @@ void reshadefx::parser::restore()
 	_token_next = _token_backup; // Copy instead of move here, since restore may be called twice (from 'accept_type_class' and then again from 'parse_expression_unary')
 }
 
+void reshadefx::parser::count_alu_operations(const type &type)
+{
+	if (_current_function != nullptr)
+		_current_function->cost.alu_operations += _cost_multiplier * std::max(type.components(), 1u);
+}
+
 void reshadefx::parser::consume()
 {
 	_token = std::move(_token_next);
@@ -491,9 +499,11 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 			const auto value = _codegen->emit_load(exp);
 			const auto result = _codegen->emit_binary_op(location, op, exp.type, value,
 				_codegen->emit_constant(exp.type, one));
+			count_alu_operations(exp.type);
 
 			// The "++" and "--" operands modify the source variable, so store result back into it
 			_codegen->emit_store(exp, result);
+			_modified_variables.push_back(exp.base);
 		}
 		else if (op != tokenid::plus) // Ignore "+" operator since it does not actually do anything
 		{
@@ -509,6 +519,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 			{
 				const auto value = _codegen->emit_load(exp);
 				const auto result = _codegen->emit_unary_op(location, op, exp.type, value);
+				count_alu_operations(exp.type);
 
 				exp.reset_to_rvalue(location, result, exp.type);
 			}
@@ -887,14 +898,51 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 					expression arg = parameters[i];
 					arg.add_cast_operation(arguments[i].type);
 					_codegen->emit_store(arguments[i], _codegen->emit_load(arg));
+					_modified_variables.push_back(arguments[i].base);
 				}
 			}
 
 			if (_current_function != nullptr)
 			{
-				// Calling a function makes the caller inherit all sampler and storage object references from the callee
+				// Calling a function makes the caller inherit all sampler and storage object references (and whether it may discard pixels) from the callee
 				_current_function->referenced_samplers.insert(_current_function->referenced_samplers.end(), symbol.function->referenced_samplers.begin(), symbol.function->referenced_samplers.end());
 				_current_function->referenced_storages.insert(_current_function->referenced_storages.end(), symbol.function->referenced_storages.begin(), symbol.function->referenced_storages.end());
+				_current_function->may_discard |= symbol.function->may_discard;
+
+				if (symbol.op == symbol_type::function)
+				{
+					// Nothing is known about the coordinates the callee samples at
+					_current_function->non_local_samplers.insert(_current_function->non_local_samplers.end(), symbol.function->referenced_samplers.begin(), symbol.function->referenced_samplers.end());
+
+					_current_function->cost.texture_fetches += _cost_multiplier * symbol.function->cost.texture_fetches;
+					_current_function->cost.alu_operations += _cost_multiplier * symbol.function->cost.alu_operations;
+					_current_function->cost.has_unbounded_loops |= symbol.function->cost.has_unbounded_loops;
+				}
+				// Texture intrinsics that do not fetch anything are ordinary operations
+				else if (identifier.compare(0, 5, "tex2D") != 0 || identifier == "tex2Dsize" || identifier == "tex2Dstore")
+				{
+					count_alu_operations(symbol.type);
+				}
+				else
+				{
+					_current_function->cost.texture_fetches += _cost_multiplier;
+
+					if (identifier == "tex2D" && arguments.size() == 2 && arguments[0].chain.empty() && arguments[1].is_lvalue && (arguments[1].chain.empty() || (
+						arguments[1].chain.size() == 1 && arguments[1].chain[0].op == expression::operation::op_swizzle && arguments[1].chain[0].swizzle[0] == 0 && arguments[1].chain[0].swizzle[1] == 1)))
+					{
+						// Sampling at the texture coordinate the function receives only reads the texel the pixel is at, as long as that coordinate is not modified anywhere in the function (which is checked once the function was parsed completely)
+						const auto parameter = std::find_if(_current_function->parameter_list.begin(), _current_function->parameter_list.end(),
+							[&arguments](const struct_member_info &param) { return param.definition == arguments[1].base && param.semantic == "TEXCOORD0"; });
+						// Referencing the sampler as the first argument marked it as sampled anywhere, so revert that
+						const auto sampler = std::find(_current_function->non_local_samplers.rbegin(), _current_function->non_local_samplers.rend(), arguments[0].base);
+
+						if (parameter != _current_function->parameter_list.end() && sampler != _current_function->non_local_samplers.rend())
+						{
+							_current_function->non_local_samplers.erase(std::next(sampler).base());
+							_texcoord_samples.emplace_back(arguments[0].base, parameter->definition);
+						}
+					}
+				}
 			}
 		}
 		else if (symbol.op == symbol_type::invalid)
@@ -912,7 +960,10 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 			{
 				// Keep track of any global sampler or storage objects referenced in the current function
 				if (symbol.type.is_sampler())
+				{
 					_current_function->referenced_samplers.push_back(symbol.id);
+					_current_function->non_local_samplers.push_back(symbol.id);
+				}
 				if (symbol.type.is_storage())
 					_current_function->referenced_storages.push_back(symbol.id);
 			}
@@ -951,9 +1002,11 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 
 			const auto value = _codegen->emit_load(exp, true);
 			const auto result = _codegen->emit_binary_op(location, _token.id, exp.type, value, _codegen->emit_constant(exp.type, one));
+			count_alu_operations(exp.type);
 
 			// The "++" and "--" operands modify the source variable, so store result back into it
 			_codegen->emit_store(exp, result);
+			_modified_variables.push_back(exp.base);
 
 			// All postfix operators return a r-value rather than a l-value to the variable
 			exp.reset_to_rvalue(location, value, exp.type);
@@ -1296,6 +1349,7 @@ bool reshadefx::parser::parse_expression_multary(expression &lhs, unsigned int l
 				type = { type::t_bool, type.rows, type.cols };
 
 			const auto result_value = _codegen->emit_binary_op(lhs.location, op, type, lhs.type, lhs_value, rhs_value);
+			count_alu_operations(type);
 
 			lhs.reset_to_rvalue(lhs.location, result_value, type);
 			#pragma endregion
@@ -1384,6 +1438,7 @@ bool reshadefx::parser::parse_expression_multary(expression &lhs, unsigned int l
 			const auto false_value = _codegen->emit_load(false_exp);
 
 			const auto result_value = _codegen->emit_ternary_op(lhs.location, op, type, condition_value, true_value, false_value);
+			count_alu_operations(type);
 #endif
 			lhs.reset_to_rvalue(lhs.location, result_value, type);
 			#pragma endregion
@@ -1437,10 +1492,12 @@ bool reshadefx::parser::parse_expression_assignment(expression &lhs)
 
 			// Handle arithmetic assignment operation
 			result = _codegen->emit_binary_op(lhs.location, op, lhs.type, value, result);
+			count_alu_operations(lhs.type);
 		}
 
 		// Write result back to variable
 		_codegen->emit_store(lhs, result);
+		_modified_variables.push_back(lhs.base);
 
 		// Return the result value since you can write assignments within expressions
 		lhs.reset_to_rvalue(lhs.location, result, lhs.type);
@@ -6,6 +6,8 @@
 #include "effect_lexer.hpp"
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include <cmath> // std::ceil, std::floor
+#include <limits>
 #include <cassert>
 #include <functional>
 
@@ -17,6 +19,74 @@ struct on_scope_exit
 	std::function<void()> leave;
 };
 
+// Check whether a function matches the vertex shader commonly used for post-processing passes (the 'PostProcessVS' function from 'ReShade.fxh'), which generates a triangle covering the entire render target from the vertex index
+// Only the exact signature and body (except for parameter names, whitespace and comments) are accepted, since anything else could leave pixels of a render target untouched
+static bool is_full_screen_triangle_function(const reshadefx::function_info &info, std::string body)
+{
+	using namespace reshadefx;
+
+	if (!info.return_type.is_void() || info.parameter_list.size() != 3)
+		return false;
+
+	const struct_member_info &id = info.parameter_list[0];
+	const struct_member_info &position = info.parameter_list[1];
+	const struct_member_info &texcoord = info.parameter_list[2];
+	if (!id.type.is_scalar() || !id.type.is_integral() || id.type.has(type::q_out) || id.semantic != "SV_VERTEXID" ||
+		!position.type.is_floating_point() || position.type.rows != 4 || position.type.cols != 1 || position.type.is_array() || !position.type.has(type::q_out) || position.type.has(type::q_in) || position.semantic != "SV_POSITION" ||
+		!texcoord.type.is_floating_point() || texcoord.type.rows != 2 || texcoord.type.cols != 1 || texcoord.type.is_array() || !texcoord.type.has(type::q_out) || texcoord.type.has(type::q_in))
+		return false;
+
+	// Parameters are renamed to the names used here before comparison, so that their names do not matter
+	static const char *const reference_parameter_names[3] = { "id", "position", "texcoord" };
+	static const char *const reference_body =
+		"{\n"
+		"	texcoord.x = (id == 2) ? 2.0 : 0.0;\n"
+		"	texcoord.y = (id == 1) ? 2.0 : 0.0;\n"
+		"	position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);\n"
+		"}\n";
+
+	lexer reference_lexer(reference_body);
+	lexer function_lexer(std::move(body));
+
+	while (true)
+	{
+		const token reference_token = reference_lexer.lex();
+		token function_token = function_lexer.lex();
+
+		if (reference_token.id != function_token.id)
+			return false;
+
+		switch (reference_token.id)
+		{
+		case tokenid::end_of_file:
+			return true;
+		case tokenid::identifier:
+			if (const auto it = std::find_if(info.parameter_list.begin(), info.parameter_list.end(),
+				[&function_token](const struct_member_info &param) { return param.name == function_token.literal_as_string; });
+				it != info.parameter_list.end())
+				function_token.literal_as_string = reference_parameter_names[it - info.parameter_list.begin()];
+			// Any other identifier with the name of a reference parameter refers to something else (e.g. a global variable)
+			else if (std::find(std::begin(reference_parameter_names), std::end(reference_parameter_names), function_token.literal_as_string) != std::end(reference_parameter_names))
+				return false;
+
+			if (function_token.literal_as_string != reference_token.literal_as_string)
+				return false;
+			break;
+		case tokenid::int_literal:
+		case tokenid::uint_literal:
+			if (function_token.literal_as_uint != reference_token.literal_as_uint)
+				return false;
+			break;
+		case tokenid::float_literal:
+			if (function_token.literal_as_float != reference_token.literal_as_float)
+				return false;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
 bool reshadefx::parser::parse(std::string input, codegen *backend)
 {
 	_lexer.reset(new lexer(std::move(input)));
@@ -30,8 +100,13 @@ bool reshadefx::parser::parse(std::string input, codegen *backend)
 	bool current_success = true;
 
 	while (!peek(tokenid::end_of_file))
+	{
+		if (_abort_callback && _abort_callback())
+			return false;
+
 		if (parse_top(current_success); !current_success)
 			parse_success = false;
+	}
 
 	return parse_success;
 }
@@ -140,6 +215,114 @@ void reshadefx::parser::parse_top(bool &parse_success)
 	}
 }
 
+bool reshadefx::parser::peek_loop_trip_count(uint32_t &trip_count)
+{
+	backup();
+	const token current_token = _token;
+
+	const auto accept_number = [this](double &value) {
+		const bool negate = accept('-');
+		if (accept(tokenid::int_literal))
+			value = _token.literal_as_int;
+		else if (accept(tokenid::uint_literal))
+			value = _token.literal_as_uint;
+		else if (accept(tokenid::float_literal))
+			value = _token.literal_as_float;
+		else
+			return false;
+		if (negate)
+			value = -value;
+		return true;
+	};
+
+	std::string name;
+	tokenid comparison = tokenid::unknown;
+	double start = 0.0, end = 0.0, step = 0.0;
+
+	// Only the common form "for (int i = a; i < b; i++)" with literal bounds is recognized (which is still only an estimate, since the loop body may modify the counter too)
+	const auto parse_header = [&]() {
+		// Skip the type of the loop counter declaration
+		if (!peek(tokenid::identifier))
+			consume();
+
+		if (!accept(tokenid::identifier))
+			return false;
+		name = _token.literal_as_string;
+
+		if (!accept('=') || !accept_number(start) || !accept(';'))
+			return false;
+
+		if (!accept(tokenid::identifier) || _token.literal_as_string != name)
+			return false;
+		if (!accept('<') && !accept(tokenid::less_equal) && !accept('>') && !accept(tokenid::greater_equal) && !accept(tokenid::exclaim_equal))
+			return false;
+		comparison = _token.id;
+
+		if (!accept_number(end) || !accept(';'))
+			return false;
+
+		if (accept(tokenid::plus_plus) || accept(tokenid::minus_minus))
+		{
+			step = _token.id == tokenid::plus_plus ? 1.0 : -1.0;
+			if (!accept(tokenid::identifier) || _token.literal_as_string != name)
+				return false;
+		}
+		else if (accept(tokenid::identifier) && _token.literal_as_string == name)
+		{
+			if (accept(tokenid::plus_plus))
+				step = 1.0;
+			else if (accept(tokenid::minus_minus))
+				step = -1.0;
+			else if (accept(tokenid::plus_equal) && accept_number(step))
+				step = +step;
+			else if (accept(tokenid::minus_equal) && accept_number(step))
+				step = -step;
+			else
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+
+		return accept(')');
+	};
+
+	const bool matches = parse_header();
+
+	restore();
+	_token = current_token;
+
+	if (!matches || step == 0.0)
+		return false;
+
+	double count = (end - start) / step;
+	switch (comparison)
+	{
+	case tokenid::less:
+	case tokenid::greater:
+		// Counting away from the bound never terminates
+		if ((comparison == tokenid::less) != (step > 0.0))
+			return false;
+		count = std::ceil(count);
+		break;
+	case tokenid::less_equal:
+	case tokenid::greater_equal:
+		if ((comparison == tokenid::less_equal) != (step > 0.0))
+			return false;
+		count = std::floor(count) + 1.0;
+		break;
+	case tokenid::exclaim_equal:
+		// Stepping over the bound never terminates either
+		if (count < 0.0 || count != std::floor(count))
+			return false;
+		break;
+	}
+
+	trip_count = static_cast<uint32_t>(std::min(std::max(count, 0.0), static_cast<double>(std::numeric_limits<uint32_t>::max())));
+	return true;
+}
+
 bool reshadefx::parser::parse_statement(bool scoped)
 {
 	if (!_codegen->is_in_block())
@@ -372,6 +555,14 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			enter_scope();
 			on_scope_exit _([this]() { leave_scope(); });
 
+			// Everything but the initializer runs once per iteration, which is accounted for in the cost of the function
+			uint32_t trip_count = 1;
+			if (!peek_loop_trip_count(trip_count))
+				_current_function->cost.has_unbounded_loops = true;
+
+			const uint32_t prev_cost_multiplier = _cost_multiplier;
+			on_scope_exit restore_cost_multiplier([this, prev_cost_multiplier]() { _cost_multiplier = prev_cost_multiplier; });
+
 			// Parse initializer first
 			if (type type; parse_type(type))
 			{
@@ -392,6 +583,8 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			if (!expect(';'))
 				return false;
 
+			_cost_multiplier *= trip_count;
+
 			const codegen::id merge_block = _codegen->create_block(); // Block that is executed after the loop
 			const codegen::id header_label = _codegen->create_block(); // Pointer to the loop merge instruction
 			const codegen::id continue_label = _codegen->create_block(); // Pointer to the continue block
@@ -478,6 +671,9 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			enter_scope();
 			on_scope_exit _([this]() { leave_scope(); });
 
+			// The number of iterations of a while loop is not known, so its cost is only counted once
+			_current_function->cost.has_unbounded_loops = true;
+
 			const codegen::id merge_block = _codegen->create_block();
 			const codegen::id header_label = _codegen->create_block();
 			const codegen::id continue_label = _codegen->create_block();
@@ -547,6 +743,9 @@ bool reshadefx::parser::parse_statement(bool scoped)
 		#pragma region DoWhile
 		if (accept(tokenid::do_))
 		{
+			// The number of iterations of a do-while loop is not known, so its cost is only counted once
+			_current_function->cost.has_unbounded_loops = true;
+
 			const codegen::id merge_block = _codegen->create_block();
 			const codegen::id header_label = _codegen->create_block();
 			const codegen::id continue_label = _codegen->create_block();
@@ -684,6 +883,9 @@ bool reshadefx::parser::parse_statement(bool scoped)
 		#pragma region Discard
 		if (accept(tokenid::discard_))
 		{
+			if (_current_function != nullptr)
+				_current_function->may_discard = true;
+
 			// Leave the current function block
 			_codegen->leave_block_and_kill();
 
@@ -979,6 +1181,9 @@ bool reshadefx::parser::parse_function(type type, std::string name)
 
 	info.return_type = type;
 	_current_function = &info;
+	_texcoord_samples.clear();
+	_modified_variables.clear();
+	_cost_multiplier = 1;
 
 	bool parse_success = true;
 	bool expect_parenthesis = true;
@@ -1128,13 +1333,23 @@ bool reshadefx::parser::parse_function(type type, std::string name)
 	// A function has to start with a new block
 	_codegen->enter_block(_codegen->create_block());
 
+	const size_t body_offset = _token_next.offset;
+
 	if (!parse_statement_block(false))
 		parse_success = false;
+	else
+		_current_function->is_full_screen_triangle = is_full_screen_triangle_function(*_current_function,
+			_lexer->input_string().substr(body_offset, _token.offset + _token.length - body_offset));
 
 	// Add implicit return statement to the end of functions
 	if (_codegen->is_in_block())
 		_codegen->leave_block_and_return();
 
+	// Samples at a texture coordinate that is modified somewhere in the function may not be at the texel the pixel is at
+	for (const auto &[sampler, parameter] : _texcoord_samples)
+		if (std::find(_modified_variables.begin(), _modified_variables.end(), parameter) != _modified_variables.end())
+			_current_function->non_local_samplers.push_back(sampler);
+
 	return parse_success;
 }
 
@@ -1608,6 +1823,9 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 							break;
 						case 'C':
 							cs_info = function_info;
+							// Dispatches are counted in thread groups, so track the cost of compute shaders per thread group as well
+							cs_info.cost.texture_fetches *= num_threads[0] * num_threads[1] * num_threads[2];
+							cs_info.cost.alu_operations *= num_threads[0] * num_threads[1] * num_threads[2];
 							_codegen->define_entry_point(cs_info, shader_type::cs, num_threads);
 							info.cs_entry_point = cs_info.unique_name;
 							break;
@@ -1878,6 +2096,13 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 				info.samplers.push_back(_codegen->find_sampler(id));
 			for (codegen::id id : ps_info.referenced_samplers)
 				info.samplers.push_back(_codegen->find_sampler(id));
+
+			// Samplers the vertex shader references are not necessarily sampled at the texel a pixel is at either
+			for (codegen::id id : ps_info.referenced_samplers)
+				if (std::find(ps_info.non_local_samplers.begin(), ps_info.non_local_samplers.end(), id) == ps_info.non_local_samplers.end() &&
+					std::find(vs_info.referenced_samplers.begin(), vs_info.referenced_samplers.end(), id) == vs_info.referenced_samplers.end() &&
+					std::find(info.texel_local_samplers.begin(), info.texel_local_samplers.end(), _codegen->find_sampler(id).unique_name) == info.texel_local_samplers.end())
+					info.texel_local_samplers.push_back(_codegen->find_sampler(id).unique_name);
 			if (!vs_info.referenced_storages.empty() || !ps_info.referenced_storages.empty())
 			{
 				parse_success = false;
@@ -0,0 +1,513 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_pass_analysis.hpp"
+#include <iterator> // std::size
+#include <algorithm> // std::any_of, std::find, std::find_if, std::max, std::none_of, std::stable_partition
+#include <utility> // std::make_pair
+#include <unordered_map>
+#include <unordered_set>
+
+static void add_unique(std::vector<std::string> &names, const std::string &name)
+{
+	if (std::find(names.begin(), names.end(), name) == names.end())
+		names.push_back(name);
+}
+
+// Check whether a pixel pass writes every pixel of its render targets (the viewport always matches the render target dimensions), which is only known for the full-screen triangle generated by the 'PostProcessVS' vertex shader pattern, drawn without anything that could leave pixels untouched
+static bool covers_entire_render_target(const reshadefx::module &module, const reshadefx::pass_info &pass)
+{
+	const auto vs_entry_point = std::find_if(module.entry_points.begin(), module.entry_points.end(),
+		[&pass](const auto &info) { return info.name == pass.vs_entry_point; });
+	const auto ps_entry_point = std::find_if(module.entry_points.begin(), module.entry_points.end(),
+		[&pass](const auto &info) { return info.name == pass.ps_entry_point; });
+
+	return pass.cs_entry_point.empty() && pass.topology == reshadefx::primitive_topology::triangle_list && pass.num_vertices == 3 &&
+		!pass.blend_enable && !pass.stencil_enable && pass.color_write_mask == 0xF &&
+		vs_entry_point != module.entry_points.end() && vs_entry_point->is_full_screen_triangle &&
+		ps_entry_point != module.entry_points.end() && !ps_entry_point->may_discard;
+}
+
+reshadefx::pass_access reshadefx::analyze_pass_access(const module &module, const pass_info &pass)
+{
+	pass_access access;
+
+	for (const sampler_info &sampler : pass.samplers)
+	{
+		const auto texture = std::find_if(module.textures.begin(), module.textures.end(),
+			[&sampler](const auto &info) { return info.unique_name == sampler.texture_name; });
+
+		if (texture != module.textures.end() && texture->semantic == "COLOR")
+			access.reads_back_buffer = true;
+		else
+			add_unique(access.read_textures, sampler.texture_name);
+	}
+
+	for (const storage_info &storage : pass.storages)
+	{
+		add_unique(access.written_textures, storage.texture_name);
+		add_unique(access.storage_textures, storage.texture_name);
+	}
+
+	access.is_compute = !pass.cs_entry_point.empty();
+
+	if (!access.is_compute)
+	{
+		// Passes without any render targets render to the back buffer
+		if (pass.render_target_names[0].empty())
+			access.writes_back_buffer = true;
+		else
+			for (int i = 0; i < 8 && !pass.render_target_names[i].empty(); ++i)
+				add_unique(access.written_textures, pass.render_target_names[i]);
+
+		// Render targets are overwritten entirely if they are cleared, or if the pass is proven to write every pixel
+		// Any other vertex shader could leave pixels untouched, so the previous contents have to be preserved in that case
+		if (pass.clear_render_targets || covers_entire_render_target(module, pass))
+			access.overwritten_textures = access.written_textures;
+	}
+
+	return access;
+}
+
+static unsigned int pixel_size(reshadefx::texture_format format)
+{
+	static const unsigned int pixel_sizes[] = {
+		0,
+		1 /*R8*/, 2 /*R16F*/, 4 /*R32F*/, 2 /*RG8*/, 4 /*RG16*/, 4 /*RG16F*/, 8 /*RG32F*/, 4 /*RGBA8*/, 8 /*RGBA16*/, 8 /*RGBA16F*/, 16 /*RGBA32F*/, 4 /*RGB10A2*/
+	};
+
+	static_assert(std::size(pixel_sizes) - 1 == static_cast<size_t>(reshadefx::texture_format::rgb10a2));
+
+	return pixel_sizes[static_cast<unsigned int>(format)];
+}
+
+size_t reshadefx::texture_memory_size(const texture_info &texture)
+{
+	size_t memory_size = 0;
+	for (uint32_t level = 0, width = texture.width, height = texture.height; level < texture.levels; ++level, width = std::max(width / 2, 1u), height = std::max(height / 2, 1u))
+		memory_size += static_cast<size_t>(width) * height * pixel_size(texture.format);
+
+	return memory_size;
+}
+
+void reshadefx::memory_footprint_calculator::add_effect(const module &module)
+{
+	const size_t effect_index = _num_techniques.size();
+	_num_techniques.push_back(module.techniques.size());
+	_uniform_memory_sizes.push_back(module.total_uniform_size);
+
+	// Textures with a semantic reference the same buffer copy in every effect, other textures are pooled between effects by name
+	const auto resource_name = [&module](const std::string &texture_name) {
+		const auto texture = std::find_if(module.textures.begin(), module.textures.end(),
+			[&texture_name](const auto &info) { return info.unique_name == texture_name; });
+		return texture == module.textures.end() ? std::string() : texture->semantic.empty() ? texture->unique_name : texture->semantic;
+	};
+
+	for (const texture_info &texture : module.textures)
+	{
+		if (!texture.semantic.empty() && texture.semantic != "COLOR" && texture.semantic != "DEPTH")
+			continue;
+
+		resource &resource = _resources[resource_name(texture.unique_name)];
+		if (texture.semantic.empty())
+		{
+			resource.size = texture_memory_size(texture);
+		}
+		else
+		{
+			resource.size = texture.semantic == "COLOR" ? _back_buffer_copy_size : _depth_buffer_copy_size;
+			resource.buffer_copy = true;
+		}
+
+		if (std::find(resource.effects.begin(), resource.effects.end(), effect_index) == resource.effects.end())
+			resource.effects.push_back(effect_index);
+	}
+
+	for (size_t technique_index = 0; technique_index < module.techniques.size(); ++technique_index)
+	{
+		const auto add_reference = [this, effect_index, technique_index, &resource_name](const std::string &texture_name) {
+			if (const auto it = _resources.find(resource_name(texture_name)); it != _resources.end() &&
+				std::find(it->second.techniques.begin(), it->second.techniques.end(), std::make_pair(effect_index, technique_index)) == it->second.techniques.end())
+				it->second.techniques.emplace_back(effect_index, technique_index);
+		};
+
+		for (const pass_info &pass : module.techniques[technique_index].passes)
+		{
+			for (const sampler_info &sampler : pass.samplers)
+				add_reference(sampler.texture_name);
+			for (const storage_info &storage : pass.storages)
+				add_reference(storage.texture_name);
+			for (int i = 0; i < 8 && !pass.render_target_names[i].empty(); ++i)
+				add_reference(pass.render_target_names[i]);
+		}
+	}
+}
+
+void reshadefx::memory_footprint_calculator::resolve(std::vector<memory_footprint> &effects, std::vector<std::vector<memory_footprint>> &techniques) const
+{
+	effects.assign(_num_techniques.size(), memory_footprint {});
+	techniques.resize(_num_techniques.size());
+	for (size_t effect_index = 0; effect_index < _num_techniques.size(); ++effect_index)
+		techniques[effect_index].assign(_num_techniques[effect_index], memory_footprint {});
+
+	for (const auto &[name, resource] : _resources)
+	{
+		for (const size_t effect_index : resource.effects)
+			(resource.buffer_copy ? effects[effect_index].buffer_copy_memory_size : effects[effect_index].texture_memory_size) += resource.size / resource.effects.size();
+		for (const auto &[effect_index, technique_index] : resource.techniques)
+			(resource.buffer_copy ? techniques[effect_index][technique_index].buffer_copy_memory_size : techniques[effect_index][technique_index].texture_memory_size) += resource.size / resource.techniques.size();
+	}
+
+	// All techniques of an effect share its uniform buffer
+	for (size_t effect_index = 0; effect_index < _num_techniques.size(); ++effect_index)
+	{
+		effects[effect_index].uniform_memory_size = _uniform_memory_sizes[effect_index];
+		for (memory_footprint &footprint : techniques[effect_index])
+			footprint.uniform_memory_size = _uniform_memory_sizes[effect_index] / _num_techniques[effect_index];
+	}
+}
+
+reshadefx::pass_cost reshadefx::estimate_pass_cost(const module &module, const pass_info &pass, uint32_t buffer_width, uint32_t buffer_height)
+{
+	const auto find_entry_point = [&module](const std::string &name) {
+		const auto entry_point = std::find_if(module.entry_points.begin(), module.entry_points.end(),
+			[&name](const auto &info) { return info.name == name; });
+		return entry_point != module.entry_points.end() ? entry_point->cost : shader_cost {};
+	};
+
+	pass_cost cost;
+
+	if (!pass.cs_entry_point.empty())
+	{
+		cost.invocations = static_cast<uint64_t>(pass.viewport_width) * pass.viewport_height * pass.viewport_dispatch_z;
+		cost.invocation_cost = find_entry_point(pass.cs_entry_point);
+	}
+	else
+	{
+		// The back buffer format is not known here, but it usually has 32 bits per pixel
+		uint32_t width = buffer_width, height = buffer_height, bytes_per_pixel = 4;
+
+		if (!pass.render_target_names[0].empty())
+		{
+			bytes_per_pixel = 0;
+
+			for (int i = 0; i < 8 && !pass.render_target_names[i].empty(); ++i)
+			{
+				const auto texture = std::find_if(module.textures.begin(), module.textures.end(),
+					[&pass, i](const auto &info) { return info.unique_name == pass.render_target_names[i]; });
+				if (texture == module.textures.end())
+					continue;
+
+				width = texture->width;
+				height = texture->height;
+				bytes_per_pixel += pixel_size(texture->format);
+			}
+		}
+
+		cost.invocations = static_cast<uint64_t>(width) * height;
+		cost.invocation_cost = find_entry_point(pass.ps_entry_point);
+		cost.render_target_bandwidth = cost.invocations * bytes_per_pixel * (pass.blend_enable ? 2 : 1);
+
+		const shader_cost vs_cost = find_entry_point(pass.vs_entry_point);
+		cost.texture_fetches += static_cast<uint64_t>(pass.num_vertices) * vs_cost.texture_fetches;
+		cost.alu_operations += static_cast<uint64_t>(pass.num_vertices) * vs_cost.alu_operations;
+		cost.invocation_cost.has_unbounded_loops |= vs_cost.has_unbounded_loops;
+	}
+
+	cost.texture_fetches += cost.invocations * cost.invocation_cost.texture_fetches;
+	cost.alu_operations += cost.invocations * cost.invocation_cost.alu_operations;
+
+	return cost;
+}
+
+std::vector<reshadefx::pass_fusion_candidate> reshadefx::find_pass_fusion_candidates(const module &module, uint32_t buffer_width, uint32_t buffer_height)
+{
+	const auto find_texture = [&module](const std::string &name) {
+		return std::find_if(module.textures.begin(), module.textures.end(),
+			[&name](const auto &info) { return info.unique_name == name; });
+	};
+
+	const auto render_target_size = [&module, &find_texture, buffer_width, buffer_height](const pass_info &pass) {
+		if (pass.render_target_names[0].empty())
+			return std::make_pair(buffer_width, buffer_height);
+		const auto texture = find_texture(pass.render_target_names[0]);
+		return texture != module.textures.end() ? std::make_pair(texture->width, texture->height) : std::make_pair(0u, 0u);
+	};
+
+	// Only passes that overwrite every pixel of their render targets with a value computed by the pixel shader alone can be fused, since the fused pass cannot reproduce anything the output merger does with the previous contents
+	const auto is_full_screen_pass = [&module](const pass_info &pass) {
+		return !pass.srgb_write_enable && covers_entire_render_target(module, pass);
+	};
+
+	std::vector<pass_fusion_candidate> candidates;
+
+	for (size_t technique_index = 0; technique_index < module.techniques.size(); ++technique_index)
+	{
+		const std::vector<pass_info> &passes = module.techniques[technique_index].passes;
+
+		for (size_t pass_index = 0; pass_index + 1 < passes.size(); ++pass_index)
+		{
+			const pass_info &first = passes[pass_index];
+			const pass_info &second = passes[pass_index + 1];
+
+			// The fused pass can only produce a single output of the first pass, which has to be at the same location as the pixel of the second pass
+			if (!is_full_screen_pass(first) || !is_full_screen_pass(second) || first.vs_entry_point != second.vs_entry_point ||
+				!first.render_target_names[1].empty() || render_target_size(first) != render_target_size(second))
+				continue;
+
+			const std::string &texture_name = first.render_target_names[0];
+
+			bool reads_output = false;
+			bool reads_output_elsewhere = false;
+			for (const sampler_info &sampler : second.samplers)
+			{
+				const auto texture = find_texture(sampler.texture_name);
+				if (texture_name.empty() ? texture == module.textures.end() || texture->semantic != "COLOR" : sampler.texture_name != texture_name)
+					continue;
+
+				reads_output = true;
+				// Sampling at any other location would need the output for other pixels too (and sRGB conversion would be skipped by the fused pass)
+				if (sampler.srgb || std::find(second.texel_local_samplers.begin(), second.texel_local_samplers.end(), sampler.unique_name) == second.texel_local_samplers.end())
+					reads_output_elsewhere = true;
+			}
+
+			if (!reads_output || reads_output_elsewhere)
+				continue;
+
+			// The fused pass cannot render to a texture the first pass samples
+			if (std::any_of(std::begin(second.render_target_names), std::end(second.render_target_names),
+				[&first](const std::string &name) {
+					return !name.empty() && std::any_of(first.samplers.begin(), first.samplers.end(), [&name](const sampler_info &sampler) { return sampler.texture_name == name; });
+				}))
+				continue;
+
+			if (texture_name.empty())
+			{
+				// The back buffer keeps the output of the first pass unless the second pass overwrites it again
+				if (!second.render_target_names[0].empty())
+					continue;
+			}
+			else
+			{
+				// Nothing else may sample the output of the first pass, or else it still has to be written
+				if (std::any_of(module.techniques.begin(), module.techniques.end(), [&second, &texture_name](const technique_info &technique) {
+						return std::any_of(technique.passes.begin(), technique.passes.end(), [&second, &texture_name](const pass_info &pass) {
+							return &pass != &second && std::any_of(pass.samplers.begin(), pass.samplers.end(), [&texture_name](const sampler_info &sampler) { return sampler.texture_name == texture_name; });
+						});
+					}))
+					continue;
+			}
+
+			candidates.push_back({ technique_index, pass_index, texture_name });
+		}
+	}
+
+	return candidates;
+}
+
+bool reshadefx::back_buffer_copy_planner::next_pass(const pass_access &access)
+{
+	// Only update the copy if it is outdated and actually going to be sampled, instead of before every technique
+	const bool needs_copy = _copy_outdated && access.reads_back_buffer;
+	if (needs_copy)
+		_copy_outdated = false;
+
+	if (access.writes_back_buffer)
+		_copy_outdated = true;
+
+	return needs_copy;
+}
+
+void reshadefx::texture_barrier_planner::require(const std::string &texture_name, texture_usage usage)
+{
+	// Only the last request before a flush matters, which merges multiple transitions of the same texture into one
+	if (const auto it = std::find_if(_pending_usage.begin(), _pending_usage.end(),
+		[&texture_name](const auto &pending) { return pending.first == texture_name; });
+		it != _pending_usage.end())
+		it->second = usage;
+	else
+		_pending_usage.emplace_back(texture_name, usage);
+}
+void reshadefx::texture_barrier_planner::require(const pass_access &access)
+{
+	for (const std::string &texture_name : access.read_textures)
+		require(texture_name, texture_usage::shader_resource);
+	for (const std::string &texture_name : access.written_textures)
+		require(texture_name, access.is_compute ? texture_usage::unordered_access : texture_usage::render_target);
+}
+
+std::vector<reshadefx::texture_barrier> reshadefx::texture_barrier_planner::flush()
+{
+	std::vector<texture_barrier> barriers;
+
+	for (const auto &[texture_name, usage] : _pending_usage)
+	{
+		const auto it = _current_usage.find(texture_name);
+		const texture_usage old_usage = it != _current_usage.end() ? it->second : texture_usage::shader_resource;
+		// Successive unordered accesses still need a barrier in between, so that writes of the previous one are visible to the next
+		if (old_usage == usage && usage != texture_usage::unordered_access)
+			continue;
+
+		barriers.push_back({ texture_name, old_usage, usage });
+
+		if (usage == texture_usage::shader_resource)
+			_current_usage.erase(it);
+		else
+			_current_usage[texture_name] = usage;
+	}
+
+	_pending_usage.clear();
+
+	return barriers;
+}
+std::vector<reshadefx::texture_barrier> reshadefx::texture_barrier_planner::finish()
+{
+	for (const auto &[texture_name, usage] : _current_usage)
+		require(texture_name, texture_usage::shader_resource);
+
+	return flush();
+}
+
+std::vector<std::vector<bool>> reshadefx::dead_pass_analysis::resolve() const
+{
+	std::vector<std::vector<bool>> culled_passes(_techniques.size());
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+		culled_passes[technique_index].resize(_techniques[technique_index].size());
+
+	// Culling a pass may leave the passes that produce its inputs without any other consumers, so repeat until nothing changes anymore
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+
+		std::unordered_set<std::string> sampled_textures;
+		// Storage objects can be read from as well, so count how many passes access each texture through one
+		std::unordered_map<std::string, size_t> storage_access_counts;
+		for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+		{
+			for (size_t pass_index = 0; pass_index < _techniques[technique_index].size(); ++pass_index)
+			{
+				if (culled_passes[technique_index][pass_index])
+					continue;
+
+				const pass_access &access = _techniques[technique_index][pass_index];
+				sampled_textures.insert(access.read_textures.begin(), access.read_textures.end());
+				for (const std::string &name : access.storage_textures)
+					storage_access_counts[name]++;
+			}
+		}
+
+		for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+		{
+			for (size_t pass_index = 0; pass_index < _techniques[technique_index].size(); ++pass_index)
+			{
+				const pass_access &access = _techniques[technique_index][pass_index];
+
+				// A pass accessing a texture through a storage object does not keep itself alive, only other passes doing so count as consumers
+				if (culled_passes[technique_index][pass_index] || access.writes_back_buffer ||
+					std::any_of(access.written_textures.begin(), access.written_textures.end(),
+						[&sampled_textures, &storage_access_counts, &access](const std::string &name) {
+							if (sampled_textures.find(name) != sampled_textures.end())
+								return true;
+							const auto it = storage_access_counts.find(name);
+							const size_t own_access = std::find(access.storage_textures.begin(), access.storage_textures.end(), name) != access.storage_textures.end() ? 1 : 0;
+							return it != storage_access_counts.end() && it->second > own_access;
+						}))
+					continue;
+
+				culled_passes[technique_index][pass_index] = true;
+				changed = true;
+			}
+		}
+	}
+
+	return culled_passes;
+}
+
+void reshadefx::transient_texture_allocator::add_texture(const texture_info &texture, bool existing)
+{
+	candidate &entry = _candidates.emplace_back();
+	entry.info = texture;
+	entry.existing = existing;
+}
+
+void reshadefx::transient_texture_allocator::add_technique(const std::vector<pass_access> &passes)
+{
+	const size_t technique_index = _num_techniques++;
+
+	for (candidate &texture : _candidates)
+	{
+		for (size_t pass_index = 0; pass_index < passes.size() && texture.transient; ++pass_index)
+		{
+			const pass_access &access = passes[pass_index];
+
+			const bool read = std::find(access.read_textures.begin(), access.read_textures.end(), texture.info.unique_name) != access.read_textures.end();
+			const bool written = std::find(access.written_textures.begin(), access.written_textures.end(), texture.info.unique_name) != access.written_textures.end();
+			if (!read && !written)
+				continue;
+
+			if (texture.technique_index != technique_index)
+			{
+				// Contents have to be preserved if the texture is used by multiple techniques or if the first pass using it does not overwrite it completely
+				if (texture.technique_index != std::numeric_limits<size_t>::max() || read ||
+					std::find(access.overwritten_textures.begin(), access.overwritten_textures.end(), texture.info.unique_name) == access.overwritten_textures.end())
+				{
+					texture.transient = false;
+					break;
+				}
+
+				texture.technique_index = technique_index;
+				texture.first_pass = pass_index;
+			}
+
+			texture.last_pass = pass_index;
+		}
+	}
+}
+
+std::vector<std::pair<std::string, std::string>> reshadefx::transient_texture_allocator::allocate()
+{
+	_saved_memory_size = 0;
+
+	// Textures that already exist have to keep their own storage, so make sure they are assigned first
+	std::stable_partition(_candidates.begin(), _candidates.end(),
+		[](const candidate &texture) { return texture.existing; });
+
+	const auto overlaps = [](const candidate &a, const candidate &b) {
+		return a.technique_index == b.technique_index && a.first_pass <= b.last_pass && b.first_pass <= a.last_pass;
+	};
+
+	// Each storage is a list of candidates that share it, with the first one providing it
+	std::vector<std::vector<const candidate *>> storages;
+	std::vector<std::pair<std::string, std::string>> aliases;
+
+	for (const candidate &texture : _candidates)
+	{
+		// Textures that are never used do not have a lifetime to compare against
+		if (!texture.transient || texture.technique_index == std::numeric_limits<size_t>::max())
+			continue;
+
+		const auto storage = texture.existing ? storages.end() : std::find_if(storages.begin(), storages.end(),
+			[&texture, &overlaps](const std::vector<const candidate *> &users) {
+				const texture_info &info = users.front()->info;
+				return info.width == texture.info.width && info.height == texture.info.height && info.levels == texture.info.levels && info.format == texture.info.format &&
+					// Storage that already exists cannot be given storage access after the fact
+					(!users.front()->existing || info.storage_access || !texture.info.storage_access) &&
+					std::none_of(users.begin(), users.end(), [&texture, &overlaps](const candidate *user) { return overlaps(*user, texture); });
+			});
+
+		if (storage == storages.end())
+		{
+			storages.push_back({ &texture });
+			continue;
+		}
+
+		storage->push_back(&texture);
+		aliases.emplace_back(texture.info.unique_name, storage->front()->info.unique_name);
+
+		_saved_memory_size += texture_memory_size(texture.info);
+	}
+
+	return aliases;
+}
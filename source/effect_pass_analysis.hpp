@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <limits>
+#include <unordered_map>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// The resources a pass reads from and writes to.
+	/// </summary>
+	struct pass_access
+	{
+		// Unique names of all textures that are sampled in the pass (except for the back buffer, which is tracked separately)
+		std::vector<std::string> read_textures;
+		// Unique names of all textures that are rendered to or written through a storage object in the pass
+		std::vector<std::string> written_textures;
+		// Subset of the written textures that are accessed through a storage object, which the pass may read from too
+		std::vector<std::string> storage_textures;
+		// Subset of the written textures whose previous contents are replaced entirely by the pass (so they do not have to be preserved before it)
+		std::vector<std::string> overwritten_textures;
+		bool reads_back_buffer = false;
+		bool writes_back_buffer = false;
+		// Set for compute passes, which write to textures through storage objects instead of rendering to them
+		bool is_compute = false;
+	};
+
+	/// <summary>
+	/// Determine the resources a pass reads from and writes to, based on its render targets, storage objects and the samplers its entry points reference.
+	/// </summary>
+	/// <param name="module">The effect module the pass is part of.</param>
+	/// <param name="pass">The pass to analyze.</param>
+	pass_access analyze_pass_access(const module &module, const pass_info &pass);
+
+	/// <summary>
+	/// Calculate the amount of memory a texture occupies, including all its mipmap levels.
+	/// </summary>
+	/// <param name="texture">The texture description.</param>
+	size_t texture_memory_size(const texture_info &texture);
+
+	/// <summary>
+	/// The video memory an effect or technique occupies, split up by the kind of resource.
+	/// </summary>
+	struct memory_footprint
+	{
+		size_t texture_memory_size = 0;
+		// Copies of the back buffer and depth buffer that are sampled through textures with the "COLOR" and "DEPTH" semantics
+		size_t buffer_copy_memory_size = 0;
+		size_t uniform_memory_size = 0;
+
+		size_t total() const { return texture_memory_size + buffer_copy_memory_size + uniform_memory_size; }
+	};
+
+	/// <summary>
+	/// Adds up the video memory effects occupy, to be able to tell which effects are responsible for most of it.
+	/// Resources that are used by multiple effects or techniques (pooled textures, the back buffer and depth buffer copies) are split between them in equal parts, so that the footprints add up to the total amount.
+	/// </summary>
+	class memory_footprint_calculator
+	{
+	public:
+		/// <param name="back_buffer_copy_size">Size of the copy of the back buffer that effects can sample in bytes.</param>
+		/// <param name="depth_buffer_copy_size">Size of the copy of the depth buffer that effects can sample in bytes.</param>
+		memory_footprint_calculator(size_t back_buffer_copy_size, size_t depth_buffer_copy_size) :
+			_back_buffer_copy_size(back_buffer_copy_size), _depth_buffer_copy_size(depth_buffer_copy_size) {}
+
+		/// <summary>
+		/// Add the next effect.
+		/// </summary>
+		/// <param name="module">The effect module with all its textures and techniques.</param>
+		void add_effect(const module &module);
+
+		/// <summary>
+		/// Calculate the footprints of all effects that were added so far.
+		/// </summary>
+		/// <param name="effects">Receives the footprint of every effect in the order they were added.</param>
+		/// <param name="techniques">Receives a list for every effect in the order they were added, which in turn has the footprint of every technique in the order of the module.</param>
+		void resolve(std::vector<memory_footprint> &effects, std::vector<std::vector<memory_footprint>> &techniques) const;
+
+	private:
+		struct resource
+		{
+			size_t size = 0;
+			bool buffer_copy = false;
+			std::vector<size_t> effects;
+			std::vector<std::pair<size_t, size_t>> techniques;
+		};
+
+		size_t _back_buffer_copy_size;
+		size_t _depth_buffer_copy_size;
+		std::unordered_map<std::string, resource> _resources;
+		std::vector<size_t> _num_techniques;
+		std::vector<size_t> _uniform_memory_sizes;
+	};
+
+	/// <summary>
+	/// A static estimate of the work a pass does.
+	/// </summary>
+	struct pass_cost
+	{
+		// Number of pixels the pixel shader runs for (assuming it covers the entire render target) or thread groups the compute shader runs for
+		uint64_t invocations = 0;
+		// Cost of a single pixel shader invocation or compute shader thread group
+		shader_cost invocation_cost;
+		// Totals across all vertex, pixel and compute shader invocations of the pass
+		uint64_t texture_fetches = 0;
+		uint64_t alu_operations = 0;
+		// Number of bytes written to render targets (and read from them too if blending is enabled)
+		uint64_t render_target_bandwidth = 0;
+	};
+
+	/// <summary>
+	/// Estimate the work a pass does from the static cost of its entry points and the size and format of its render targets.
+	/// </summary>
+	/// <param name="module">The effect module the pass is part of.</param>
+	/// <param name="pass">The pass to estimate.</param>
+	/// <param name="buffer_width">Width of the back buffer.</param>
+	/// <param name="buffer_height">Height of the back buffer.</param>
+	pass_cost estimate_pass_cost(const module &module, const pass_info &pass, uint32_t buffer_width, uint32_t buffer_height);
+
+	/// <summary>
+	/// Two consecutive passes of a technique that could be fused into one, because the second one only reads the output of the first at the texel each pixel is at.
+	/// </summary>
+	struct pass_fusion_candidate
+	{
+		size_t technique_index;
+		// Index of the first pass, which can be fused with the pass following it
+		size_t pass_index;
+		// Unique name of the texture the first pass renders to and the second pass samples, which would no longer have to be written or sampled (empty if this is the back buffer)
+		std::string texture_name;
+	};
+
+	/// <summary>
+	/// Find pairs of consecutive full-screen pixel passes where the second pass samples the output of the first pass only at the unmodified texture coordinate, on a render target of the same size (so that both point and linear filtering return exactly the texel the pixel is at).
+	/// Both passes have to share the vertex shader, since that is what produces the texture coordinate, and the output of the first pass must not be used anywhere else.
+	/// This only reports the candidates, so that they can be validated (see the "--fusion-candidates" option of fxc). Code generation does not produce a fused entry point for them, so the runtime still executes both passes.
+	/// </summary>
+	/// <param name="module">The effect module to analyze.</param>
+	/// <param name="buffer_width">Width of the back buffer.</param>
+	/// <param name="buffer_height">Height of the back buffer.</param>
+	std::vector<pass_fusion_candidate> find_pass_fusion_candidates(const module &module, uint32_t buffer_width, uint32_t buffer_height);
+
+	/// <summary>
+	/// Keeps track of whether the texture copy of the back buffer that passes sample from is up to date, so that it only has to be updated right before a pass that actually samples it.
+	/// </summary>
+	class back_buffer_copy_planner
+	{
+	public:
+		/// <summary>
+		/// Reset the state at the beginning of a frame, since the application has rendered to the back buffer since the last copy.
+		/// </summary>
+		void begin_frame() { _copy_outdated = true; }
+
+		/// <summary>
+		/// Advance to the next pass that is executed and return whether the back buffer has to be copied before executing it.
+		/// This has to be called for every pass that is executed during the frame, in order.
+		/// </summary>
+		/// <param name="access">The resources the pass reads from and writes to.</param>
+		/// <returns><c>true</c> if the back buffer copy has to be updated before executing the pass, <c>false</c> otherwise.</returns>
+		bool next_pass(const pass_access &access);
+
+	private:
+		bool _copy_outdated = true;
+	};
+
+	/// <summary>
+	/// The ways passes can access a texture, each of which requires the texture to be in a different state.
+	/// </summary>
+	enum class texture_usage
+	{
+		shader_resource,
+		render_target,
+		unordered_access,
+	};
+
+	/// <summary>
+	/// A state transition of a texture from one usage to another (or a barrier between two unordered accesses if both are the same).
+	/// </summary>
+	struct texture_barrier
+	{
+		std::string texture_name;
+		texture_usage old_usage;
+		texture_usage new_usage;
+	};
+
+	/// <summary>
+	/// Keeps track of the usage state of all textures across all passes of all techniques in a frame, so that a texture is only transitioned when an operation actually needs it in a different state, instead of back and forth around every pass.
+	/// All textures are in the shader resource state at the beginning and at the end of a frame.
+	/// </summary>
+	class texture_barrier_planner
+	{
+	public:
+		/// <summary>
+		/// Request a texture to be in the specified usage state for the next operation.
+		/// </summary>
+		/// <param name="texture_name">The unique name of the texture.</param>
+		/// <param name="usage">The usage state the texture is needed in.</param>
+		void require(const std::string &texture_name, texture_usage usage);
+		/// <summary>
+		/// Request all textures a pass accesses to be in the matching usage state for executing it.
+		/// </summary>
+		/// <param name="access">The resources the pass reads from and writes to.</param>
+		void require(const pass_access &access);
+
+		/// <summary>
+		/// Returns the transitions necessary to fulfill all requests since the last call, with at most one transition per texture.
+		/// </summary>
+		std::vector<texture_barrier> flush();
+		/// <summary>
+		/// Returns the transitions necessary to put all textures back into the shader resource state at the end of a frame.
+		/// </summary>
+		std::vector<texture_barrier> finish();
+
+	private:
+		// Textures that are not in the shader resource state
+		std::unordered_map<std::string, texture_usage> _current_usage;
+		std::vector<std::pair<std::string, texture_usage>> _pending_usage;
+	};
+
+	/// <summary>
+	/// Finds passes whose output is never used, because they do not render to the back buffer and none of the textures they write to are sampled by any pass that is not culled itself (neither later in the same frame nor in the next frame).
+	/// </summary>
+	class dead_pass_analysis
+	{
+	public:
+		/// <summary>
+		/// Add the next technique.
+		/// </summary>
+		/// <param name="passes">The resources each pass of the technique reads from and writes to.</param>
+		void add_technique(const std::vector<pass_access> &passes) { _techniques.push_back(passes); }
+
+		/// <summary>
+		/// Run the analysis on all techniques that were added so far.
+		/// </summary>
+		/// <returns>A list with an entry for every technique in the order they were added, which in turn has a flag for every pass that is set if the pass can be skipped.</returns>
+		std::vector<std::vector<bool>> resolve() const;
+
+	private:
+		std::vector<std::vector<pass_access>> _techniques;
+	};
+
+	/// <summary>
+	/// Finds transient textures (whose contents are only used within a single technique and completely overwritten before they are read) and assigns those with matching descriptions and non-overlapping lifetimes to shared storage.
+	/// The lifetime of a transient texture is a range of passes in its technique, so techniques never overlap and the assignment stays valid independent of which techniques are enabled and in what order they are rendered.
+	/// </summary>
+	class transient_texture_allocator
+	{
+	public:
+		/// <summary>
+		/// Add a texture that may share storage with other textures.
+		/// </summary>
+		/// <param name="texture">The texture description.</param>
+		/// <param name="existing">Set to <c>true</c> if storage for the texture already exists, in which case other textures may share it, but it is not assigned to other storage itself.</param>
+		void add_texture(const texture_info &texture, bool existing = false);
+		/// <summary>
+		/// Add the next technique and update the lifetimes of all textures its passes access.
+		/// </summary>
+		/// <param name="passes">The resources each pass of the technique reads from and writes to.</param>
+		void add_technique(const std::vector<pass_access> &passes);
+
+		/// <summary>
+		/// Assign storage to all textures added so far.
+		/// </summary>
+		/// <returns>A list of pairs of the unique name of a texture and the unique name of the texture whose storage it should share.</returns>
+		std::vector<std::pair<std::string, std::string>> allocate();
+
+		/// <summary>
+		/// Returns the amount of memory in bytes that sharing storage saves. Only valid after <see cref="allocate"/> was called.
+		/// </summary>
+		size_t saved_memory_size() const { return _saved_memory_size; }
+
+	private:
+		struct candidate
+		{
+			texture_info info;
+			bool existing = false;
+			bool transient = true;
+			size_t technique_index = std::numeric_limits<size_t>::max();
+			size_t first_pass = 0;
+			size_t last_pass = 0;
+		};
+
+		size_t _num_techniques = 0;
+		size_t _saved_memory_size = 0;
+		std::vector<candidate> _candidates;
+	};
+}
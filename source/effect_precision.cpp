@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_precision.hpp"
+#include <cmath> // std::abs
+#include <algorithm> // std::max
+
+// Maximum number of operations between a texture fetch and a value computed at reduced precision, to limit how much rounding errors can accumulate
+static const uint32_t max_operation_depth = 8;
+
+static bool is_relaxable_type(const reshadefx::type &type)
+{
+	// Matrices and arrays are left alone, as are values whose declaration has to stay as is (global state, uniforms, precise values)
+	return type.base == reshadefx::type::t_float && !type.is_matrix() && !type.is_array() &&
+		(type.qualifiers & (reshadefx::type::q_static | reshadefx::type::q_uniform | reshadefx::type::q_precise | reshadefx::type::q_groupshared)) == 0;
+}
+
+void reshadefx::precision_analysis::add_sampler(id sampler, const texture_info &texture)
+{
+	bool qualifies = false;
+
+	if (texture.semantic.empty())
+	{
+		switch (texture.format)
+		{
+		case texture_format::r8:
+		case texture_format::rg8:
+		case texture_format::rgba8:
+		case texture_format::rgb10a2:
+		case texture_format::r16f:
+		case texture_format::rg16f:
+		case texture_format::rgba16f:
+			qualifies = true;
+			break;
+		default:
+			break;
+		}
+	}
+	else
+	{
+		// The back buffer has at most 16-bit floating-point precision, but the depth buffer is usually of higher precision
+		qualifies = texture.semantic == "COLOR";
+	}
+
+	add_node(sampler, node_type::sampler, qualifies);
+}
+
+void reshadefx::precision_analysis::add_constant(id value, const type &type, const constant &data)
+{
+	bool qualifies = type.is_numeric() && !type.is_array() && type.components() <= 16;
+
+	for (unsigned int i = 0; qualifies && i < type.components(); ++i)
+	{
+		const float element = std::abs(type.is_floating_point() ? data.as_float[i] : static_cast<float>(data.as_int[i]));
+
+		// Only allow constants that neither amplify rounding errors nor lose most of their precision when converted
+		qualifies = element == 0.0f || (element >= 1.0f / 256.0f && element <= 256.0f);
+	}
+
+	add_node(value, node_type::constant, qualifies);
+}
+
+void reshadefx::precision_analysis::add_fetch(id value, const type &type, id sampler)
+{
+	add_node(value, node_type::fetch, is_relaxable_type(type)).operands.push_back(sampler);
+}
+
+void reshadefx::precision_analysis::add_operation(id value, const type &type, const std::vector<id> &operands)
+{
+	node &node = add_node(value, node_type::operation, is_relaxable_type(type));
+	node.operands.insert(node.operands.end(), operands.begin(), operands.end());
+}
+
+void reshadefx::precision_analysis::add_division(id value, const type &type, id dividend, id divisor)
+{
+	node &node = add_node(value, node_type::division, is_relaxable_type(type));
+	node.operands.push_back(dividend);
+	node.operands.push_back(divisor);
+}
+
+void reshadefx::precision_analysis::add_merge(id value, const type &type, id source)
+{
+	add_node(value, node_type::merge, is_relaxable_type(type) || type.is_sampler()).operands.push_back(source);
+}
+
+void reshadefx::precision_analysis::resolve()
+{
+	_relaxed_values.clear();
+
+	// Start out with all values that may qualify and then iteratively remove those that depend on values which do not (or that are too many operations away from a texture fetch)
+	std::unordered_set<id> candidates;
+	for (const auto &[value, node] : _nodes)
+		if (node.qualifies)
+			candidates.insert(value);
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+
+		for (auto it = candidates.begin(); it != candidates.end();)
+		{
+			const node &node = _nodes.at(*it);
+
+			bool qualifies = true;
+
+			if (node.type == node_type::division)
+				// Dividing by anything but a constant can amplify rounding errors arbitrarily
+				qualifies = candidates.find(node.operands[1]) != candidates.end() && _nodes.at(node.operands[1]).type == node_type::constant;
+
+			if (node.type != node_type::sampler && node.type != node_type::constant)
+				for (const id operand : node.operands)
+					if (candidates.find(operand) == candidates.end())
+						qualifies = false;
+
+			if (!qualifies)
+			{
+				it = candidates.erase(it);
+				changed = true;
+				continue;
+			}
+
+			++it;
+		}
+
+		if (changed)
+			continue;
+
+		for (const auto &[value, depth] : operation_depths(candidates))
+		{
+			if (depth > max_operation_depth)
+			{
+				candidates.erase(value);
+				changed = true;
+			}
+		}
+	}
+
+	// Any value that a precision sensitive use depends on must be computed at full precision
+	std::unordered_set<id> sensitive_values;
+	for (std::vector<id> stack = _sensitive_values; !stack.empty();)
+	{
+		const id value = stack.back();
+		stack.pop_back();
+
+		if (!sensitive_values.insert(value).second)
+			continue;
+
+		if (const auto it = _nodes.find(value); it != _nodes.end())
+			stack.insert(stack.end(), it->second.operands.begin(), it->second.operands.end());
+	}
+
+	for (const id value : candidates)
+	{
+		const node_type type = _nodes.at(value).type;
+		if (type != node_type::sampler && type != node_type::constant && sensitive_values.find(value) == sensitive_values.end())
+			_relaxed_values.insert(value);
+	}
+}
+
+std::unordered_map<reshadefx::precision_analysis::id, uint32_t> reshadefx::precision_analysis::operation_depths(const std::unordered_set<id> &values) const
+{
+	// Variables that are assigned to more than once form cycles (e.g. 'color = saturate(color * 2.0)' merges the variable with a value computed from itself)
+	// So find the strongly connected components first (using Tarjan's algorithm) and count the operations in each of them only once, instead of going around the cycle until the limit is exceeded
+	struct vertex
+	{
+		uint32_t index;
+		uint32_t low_link;
+		bool on_stack;
+	};
+
+	std::unordered_map<id, vertex> vertices;
+	std::unordered_map<id, uint32_t> depths;
+	std::vector<id> component_stack;
+	// Values whose operands are being visited, together with the index of the next operand (to avoid recursion, since the graph can get deep in large shaders)
+	std::vector<std::pair<id, size_t>> visit_stack;
+
+	const auto visit = [&](id value) {
+		const uint32_t index = static_cast<uint32_t>(vertices.size());
+		vertices.emplace(value, vertex { index, index, true });
+		component_stack.push_back(value);
+		visit_stack.emplace_back(value, 0);
+	};
+
+	for (const id root : values)
+	{
+		if (vertices.find(root) != vertices.end())
+			continue;
+
+		visit(root);
+
+		while (!visit_stack.empty())
+		{
+			const id value = visit_stack.back().first;
+			const std::vector<id> &operands = _nodes.at(value).operands;
+
+			if (visit_stack.back().second < operands.size())
+			{
+				const id operand = operands[visit_stack.back().second++];
+				if (values.find(operand) == values.end())
+					continue;
+
+				if (const auto it = vertices.find(operand); it == vertices.end())
+					visit(operand);
+				else if (it->second.on_stack)
+					vertices.at(value).low_link = std::min(vertices.at(value).low_link, it->second.index);
+				continue;
+			}
+
+			visit_stack.pop_back();
+
+			const vertex &state = vertices.at(value);
+			if (!visit_stack.empty())
+			{
+				uint32_t &parent_low_link = vertices.at(visit_stack.back().first).low_link;
+				parent_low_link = std::min(parent_low_link, state.low_link);
+			}
+
+			if (state.low_link != state.index)
+				continue;
+
+			// This value is the root of a component, whose members are on top of the stack
+			// Components are completed after all components they depend on, so the depth of any operand outside of it is known already
+			const auto component_begin = std::find(component_stack.rbegin(), component_stack.rend(), value).base() - 1;
+
+			uint32_t input_depth = 0, num_operations = 0;
+			for (auto it = component_begin; it != component_stack.end(); ++it)
+			{
+				const node &node = _nodes.at(*it);
+				if (node.type == node_type::sampler || node.type == node_type::constant)
+					continue;
+
+				if (node.type == node_type::operation || node.type == node_type::division)
+					num_operations += 1;
+
+				for (const id operand : node.operands)
+					if (const auto depth_it = depths.find(operand); depth_it != depths.end())
+						input_depth = std::max(input_depth, depth_it->second);
+			}
+
+			for (auto it = component_begin; it != component_stack.end(); ++it)
+			{
+				vertices.at(*it).on_stack = false;
+				depths.emplace(*it, input_depth + num_operations);
+			}
+
+			component_stack.erase(component_begin, component_stack.end());
+		}
+	}
+
+	return depths;
+}
+
+reshadefx::precision_analysis::node &reshadefx::precision_analysis::add_node(id value, node_type type, bool qualifies)
+{
+	// Values may be added multiple times (e.g. variables that are assigned to more than once), in which case the first description is kept and only the operands are accumulated
+	return _nodes.try_emplace(value, node { type, qualifies, {} }).first->second;
+}
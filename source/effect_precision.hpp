@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// A data flow analysis that finds values which can be computed at reduced (16-bit floating-point) precision without a visible difference in the output.
+	/// Only values derived from texture fetches of formats that fit into 16-bit floating-point through a few operations that do not amplify rounding errors qualify, as long as they are never used where precision matters (texture coordinates, comparisons, conversion to integers, ...).
+	/// </summary>
+	class precision_analysis
+	{
+	public:
+		using id = uint32_t;
+
+		/// <summary>
+		/// Add a sampler, which is a source of reduced precision values if the texture it references has a format that is exactly representable in 16-bit floating-point.
+		/// </summary>
+		/// <param name="sampler">The SSA ID of the sampler.</param>
+		/// <param name="texture">The description of the texture the sampler references.</param>
+		void add_sampler(id sampler, const texture_info &texture);
+		/// <summary>
+		/// Add a constant value. Only constants of moderate magnitude are safe operands for reduced precision operations.
+		/// </summary>
+		/// <param name="value">The SSA ID of the constant.</param>
+		/// <param name="type">The data type of the constant.</param>
+		/// <param name="data">The actual constant data.</param>
+		void add_constant(id value, const type &type, const constant &data);
+		/// <summary>
+		/// Add the result of a texture fetch.
+		/// </summary>
+		/// <param name="value">The SSA ID of the fetch result.</param>
+		/// <param name="type">The data type of the fetch result.</param>
+		/// <param name="sampler">The SSA ID of the sampler that is fetched from.</param>
+		void add_fetch(id value, const type &type, id sampler);
+		/// <summary>
+		/// Add the result of an operation that does not amplify rounding errors of its operands (addition, multiplication, saturate, lerp, ...).
+		/// </summary>
+		/// <param name="value">The SSA ID of the operation result.</param>
+		/// <param name="type">The data type of the operation result.</param>
+		/// <param name="operands">The SSA IDs of the operation operands.</param>
+		void add_operation(id value, const type &type, const std::vector<id> &operands);
+		/// <summary>
+		/// Add the result of a division, which is only safe if the divisor is a constant.
+		/// </summary>
+		/// <param name="value">The SSA ID of the division result.</param>
+		/// <param name="type">The data type of the division result.</param>
+		/// <param name="dividend">The SSA ID of the dividend.</param>
+		/// <param name="divisor">The SSA ID of the divisor.</param>
+		void add_division(id value, const type &type, id dividend, id divisor);
+		/// <summary>
+		/// Add a value that is assigned from another value without any computation (variable store, function parameter, phi, ...).
+		/// This can be called multiple times for the same value, in which case all sources have to qualify for the value to qualify.
+		/// </summary>
+		/// <param name="value">The SSA ID of the value that is assigned to.</param>
+		/// <param name="type">The data type of the value.</param>
+		/// <param name="source">The SSA ID of the value that is assigned.</param>
+		void add_merge(id value, const type &type, id source);
+		/// <summary>
+		/// Mark a value as being used in a way that requires full precision. This disqualifies all values it was derived from as well.
+		/// </summary>
+		/// <param name="value">The SSA ID of the value.</param>
+		void add_sensitive_use(id value) { _sensitive_values.push_back(value); }
+
+		/// <summary>
+		/// Run the analysis on all values that were added so far.
+		/// </summary>
+		void resolve();
+		/// <summary>
+		/// Returns <c>true</c> if the specified value can be computed at reduced precision. Only valid after <see cref="resolve"/> was called.
+		/// </summary>
+		/// <param name="value">The SSA ID of the value.</param>
+		bool is_relaxed(id value) const { return _relaxed_values.find(value) != _relaxed_values.end(); }
+
+	private:
+		enum class node_type
+		{
+			sampler,
+			constant,
+			fetch,
+			operation,
+			division,
+			merge,
+		};
+
+		struct node
+		{
+			node_type type;
+			bool qualifies;
+			std::vector<id> operands;
+		};
+
+		node &add_node(id value, node_type type, bool qualifies);
+		// Number of operations between a texture fetch and each of the specified values (which have to include all their operands)
+		std::unordered_map<id, uint32_t> operation_depths(const std::unordered_set<id> &values) const;
+
+		std::unordered_map<id, node> _nodes;
+		std::vector<id> _sensitive_values;
+		std::unordered_set<id> _relaxed_values;
+	};
+}
@@ -6,7 +6,7 @@
 #include "effect_lexer.hpp"
 #include "effect_preprocessor.hpp"
 #include <cassert>
-#include <algorithm> // std::find_if
+#include <algorithm> // std::find_if, std::sort
 
 #ifndef _WIN32
 	// On Linux systems the native path encoding is UTF-8 already, so no conversion necessary
@@ -171,6 +171,12 @@ std::vector<std::pair<std::string, std::string>> reshadefx::preprocessor::used_m
 			defines.push_back({ name, it->second.replacement_list });
 	return defines;
 }
+std::vector<std::string> reshadefx::preprocessor::referenced_macros() const
+{
+	std::vector<std::string> names(_referenced_macros.begin(), _referenced_macros.end());
+	std::sort(names.begin(), names.end());
+	return names;
+}
 
 void reshadefx::preprocessor::error(const location &location, const std::string &message)
 {
@@ -182,6 +188,15 @@ void reshadefx::preprocessor::warning(const location &location, const std::strin
 	_errors += location.source + '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": preprocessor warning: " + message + '\n';
 }
 
+bool reshadefx::preprocessor::file_exists(const std::filesystem::path &path) const
+{
+	if (_file_exists_callback)
+		return _file_exists_callback(path);
+
+	std::error_code ec;
+	return std::filesystem::exists(path, ec);
+}
+
 void reshadefx::preprocessor::push(std::string input, const std::string &name)
 {
 	location start_location = !name.empty() ?
@@ -322,6 +337,13 @@ void reshadefx::preprocessor::parse()
 	{
 		_recursion_count = 0;
 
+		// Checking once per line is often enough to abort quickly, without slowing down parsing noticeably
+		if (_token == tokenid::end_of_line && _abort_callback && _abort_callback())
+		{
+			_success = false;
+			return;
+		}
+
 		const bool skip = !_if_stack.empty() && _if_stack.back().skipping;
 
 		switch (_token)
@@ -438,6 +460,9 @@ void reshadefx::preprocessor::parse_def()
 	const auto macro_name = std::move(_token.literal_as_string);
 	const auto macro_name_end_offset = _token.offset + _token.length;
 
+	// Whether this is a redefinition depends on the macros defined from outside too
+	_referenced_macros.insert(macro_name);
+
 	// Check input string here directly to ensure the parenthesis follows the macro name without any whitespace between
 	if (_input_stack[_current_input_index].lexer->input_string()[macro_name_end_offset] == '(')
 	{
@@ -479,6 +504,7 @@ void reshadefx::preprocessor::parse_undef()
 	else if (_token.literal_as_string == "defined")
 		return warning(_token.location, "macro name 'defined' is reserved");
 
+	_referenced_macros.insert(_token.literal_as_string);
 	_macros.erase(_token.literal_as_string);
 }
 
@@ -488,10 +514,21 @@ void reshadefx::preprocessor::parse_if()
 	level.pp_token = _token;
 	level.input_index = _current_input_index;
 
+	const bool parent_skipping = !_if_stack.empty() && _if_stack.back().skipping;
+
 	// Evaluate expression after updating 'pp_token', so that it points at the beginning # token
-	level.value = evaluate_expression();
+	// Only do so if this #if is active, since the macros in it cannot affect the output otherwise and should not be added to the referenced ones
+	if (parent_skipping)
+	{
+		level.value = false;
+		while (!peek(tokenid::end_of_line) && !peek(tokenid::end_of_file))
+			consume();
+	}
+	else
+	{
+		level.value = evaluate_expression();
+	}
 
-	const bool parent_skipping = !_if_stack.empty() && _if_stack.back().skipping;
 	level.skipping = parent_skipping || !level.value;
 
 	_if_stack.push_back(std::move(level));
@@ -517,7 +554,10 @@ void reshadefx::preprocessor::parse_ifdef()
 
 	_if_stack.push_back(std::move(level));
 	if (!parent_skipping) // Only add if this #ifdef is active
+	{
 		_used_macros.emplace(_token.literal_as_string);
+		_referenced_macros.insert(_token.literal_as_string);
+	}
 }
 void reshadefx::preprocessor::parse_ifndef()
 {
@@ -539,7 +579,10 @@ void reshadefx::preprocessor::parse_ifndef()
 
 	_if_stack.push_back(std::move(level));
 	if (!parent_skipping) // Only add if this #ifndef is active
+	{
 		_used_macros.emplace(_token.literal_as_string);
+		_referenced_macros.insert(_token.literal_as_string);
+	}
 }
 void reshadefx::preprocessor::parse_elif()
 {
@@ -555,7 +598,19 @@ void reshadefx::preprocessor::parse_elif()
 	level.input_index = _current_input_index;
 
 	const bool parent_skipping = _if_stack.size() > 1 && _if_stack[_if_stack.size() - 2].skipping;
-	const bool condition_result = evaluate_expression();
+
+	// Same as in 'parse_if', and the expression does not matter either when a previous branch was taken already
+	bool condition_result = false;
+	if (parent_skipping || level.value)
+	{
+		while (!peek(tokenid::end_of_line) && !peek(tokenid::end_of_file))
+			consume();
+	}
+	else
+	{
+		condition_result = evaluate_expression();
+	}
+
 	level.skipping = parent_skipping || level.value || !condition_result;
 
 	if (!level.value) level.value = condition_result;
@@ -652,9 +707,9 @@ void reshadefx::preprocessor::parse_include()
 	std::filesystem::path file_path = std::filesystem::u8path(_output_location.source);
 	file_path.replace_filename(file_name);
 
-	if (std::error_code ec; !std::filesystem::exists(file_path, ec))
+	if (!file_exists(file_path))
 		for (const std::filesystem::path &include_path : _include_paths)
-			if (std::filesystem::exists(file_path = include_path / file_name, ec))
+			if (file_exists(file_path = include_path / file_name))
 				break;
 
 	const std::string file_path_string = file_path.u8string();
@@ -836,6 +891,21 @@ bool reshadefx::preprocessor::evaluate_expression()
 			}
 			break;
 		case tokenid::identifier:
+			// This is checked first, since 'defined' cannot be a macro and should not be added to the referenced ones like other identifiers
+			if (_token.literal_as_string == "defined")
+			{
+				const bool has_parentheses = accept(tokenid::parenthesis_open);
+				if (!expect(tokenid::identifier))
+					return false;
+				const std::string macro_name = std::move(_token.literal_as_string);
+				if (has_parentheses && !expect(tokenid::parenthesis_close))
+					return false;
+
+				_referenced_macros.insert(macro_name);
+				rpn[rpn_index++] = { _macros.find(macro_name) != _macros.end() ? 1 : 0, false };
+				continue;
+			}
+
 			if (evaluate_identifier_as_macro())
 				continue;
 
@@ -858,25 +928,12 @@ bool reshadefx::preprocessor::evaluate_expression()
 				std::filesystem::path file_path = std::filesystem::u8path(_output_location.source);
 				file_path.replace_filename(file_name);
 
-				std::error_code ec;
-				if (!std::filesystem::exists(file_path, ec))
+				if (!file_exists(file_path))
 					for (const std::filesystem::path &include_path : _include_paths)
-						if (std::filesystem::exists(file_path = include_path / file_name, ec))
+						if (file_exists(file_path = include_path / file_name))
 							break;
 
-				rpn[rpn_index++] = { std::filesystem::exists(file_path, ec) ? 1 : 0, false };
-				continue;
-			}
-			if (_token.literal_as_string == "defined")
-			{
-				const bool has_parentheses = accept(tokenid::parenthesis_open);
-				if (!expect(tokenid::identifier))
-					return false;
-				const std::string macro_name = std::move(_token.literal_as_string);
-				if (has_parentheses && !expect(tokenid::parenthesis_close))
-					return false;
-
-				rpn[rpn_index++] = { _macros.find(macro_name) != _macros.end() ? 1 : 0, false };
+				rpn[rpn_index++] = { file_exists(file_path) ? 1 : 0, false };
 				continue;
 			}
 
@@ -1055,6 +1112,9 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 		return true;
 	}
 
+	// Identifiers that are not a macro are referenced too, since defining one with that name changes the output
+	_referenced_macros.insert(_token.literal_as_string);
+
 	const auto it = _macros.find(_token.literal_as_string);
 	if (it == _macros.end())
 		return false;
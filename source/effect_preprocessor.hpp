@@ -8,6 +8,7 @@
 #include "effect_token.hpp"
 #include <memory> // std::unique_ptr
 #include <filesystem>
+#include <functional>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -68,6 +69,17 @@ namespace reshadefx
 		/// <returns>A boolean value indicating whether parsing was successful or not.</returns>
 		bool append_string(const std::string &source_code);
 
+		/// <summary>
+		/// Set a function that is called periodically while parsing, which aborts parsing (with failure) when it returns <c>true</c>.
+		/// </summary>
+		/// <param name="callback">The function to call, or an empty function to never abort.</param>
+		void set_abort_callback(std::function<bool()> callback) { _abort_callback = std::move(callback); }
+		/// <summary>
+		/// Set a function that is used to check whether a file exists while resolving #include directives and __has_include expressions, instead of asking the file system.
+		/// </summary>
+		/// <param name="callback">The function to call, or an empty function to ask the file system.</param>
+		void set_file_exists_callback(std::function<bool(const std::filesystem::path &)> callback) { _file_exists_callback = std::move(callback); }
+
 		/// <summary>
 		/// Get the list of error messages.
 		/// </summary>
@@ -89,6 +101,10 @@ namespace reshadefx
 		/// </summary>
 		/// <returns></returns>
 		std::vector<std::pair<std::string, std::string>> used_macro_definitions() const;
+		/// <summary>
+		/// Get a sorted list of the names of all macros that were looked up (whether they were defined at that point or not), which are all macros that can affect the output.
+		/// </summary>
+		std::vector<std::string> referenced_macros() const;
 
 	private:
 		struct if_level
@@ -109,6 +125,8 @@ namespace reshadefx
 		void error(const location &location, const std::string &message);
 		void warning(const location &location, const std::string &message);
 
+		bool file_exists(const std::filesystem::path &path) const;
+
 		void push(std::string input, const std::string &name = std::string());
 
 		bool peek(tokenid token) const;
@@ -148,8 +166,11 @@ namespace reshadefx
 		unsigned short _recursion_count = 0;
 		location _output_location;
 		std::unordered_set<std::string> _used_macros;
+		std::unordered_set<std::string> _referenced_macros;
 		std::unordered_map<std::string, macro> _macros;
 		std::vector<std::filesystem::path> _include_paths;
 		std::unordered_map<std::string, std::string> _file_cache;
+		std::function<bool()> _abort_callback;
+		std::function<bool(const std::filesystem::path &)> _file_exists_callback;
 	};
 }
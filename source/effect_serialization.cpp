@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_serialization.hpp"
+#include <cstring> // std::memcpy
+#include <type_traits>
+
+using namespace reshadefx;
+
+// Identifies a serialized module, in front of the version number
+static const uint32_t module_magic = 0x4D584652; // 'RFXM'
+
+// All structures are written member by member (instead of copying their memory), so that padding does not end up in the data
+
+static void write(std::string &data, const type &value);
+static void write(std::string &data, const constant &value);
+static void write(std::string &data, const annotation &value);
+static void write(std::string &data, const texture_info &value);
+static void write(std::string &data, const sampler_info &value);
+static void write(std::string &data, const storage_info &value);
+static void write(std::string &data, const uniform_info &value);
+static void write(std::string &data, const shader_cost &value);
+static void write(std::string &data, const entry_point &value);
+static void write(std::string &data, const pass_info &value);
+static void write(std::string &data, const technique_info &value);
+
+template <typename T>
+static std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>> write(std::string &data, T value)
+{
+	data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+static void write(std::string &data, const std::string &value)
+{
+	write(data, static_cast<uint32_t>(value.size()));
+	data.append(value);
+}
+template <typename T>
+static void write(std::string &data, const std::vector<T> &values)
+{
+	write(data, static_cast<uint32_t>(values.size()));
+	for (const T &value : values)
+		write(data, value);
+}
+
+static void write(std::string &data, const type &value)
+{
+	write(data, value.base);
+	write(data, value.rows);
+	write(data, value.cols);
+	write(data, value.qualifiers);
+	write(data, value.array_length);
+	write(data, value.definition);
+}
+static void write(std::string &data, const constant &value)
+{
+	for (const uint32_t component : value.as_uint)
+		write(data, component);
+	write(data, value.string_data);
+	write(data, value.array_data);
+}
+static void write(std::string &data, const annotation &value)
+{
+	write(data, value.type);
+	write(data, value.name);
+	write(data, value.value);
+}
+static void write(std::string &data, const texture_info &value)
+{
+	write(data, value.id);
+	write(data, value.binding);
+	write(data, value.semantic);
+	write(data, value.unique_name);
+	write(data, value.annotations);
+	write(data, value.width);
+	write(data, value.height);
+	write(data, value.levels);
+	write(data, value.format);
+	write(data, value.render_target);
+	write(data, value.storage_access);
+}
+static void write(std::string &data, const sampler_info &value)
+{
+	write(data, value.id);
+	write(data, value.binding);
+	write(data, value.texture_binding);
+	write(data, value.unique_name);
+	write(data, value.texture_name);
+	write(data, value.annotations);
+	write(data, value.filter);
+	write(data, value.address_u);
+	write(data, value.address_v);
+	write(data, value.address_w);
+	write(data, value.min_lod);
+	write(data, value.max_lod);
+	write(data, value.lod_bias);
+	write(data, value.srgb);
+}
+static void write(std::string &data, const storage_info &value)
+{
+	write(data, value.id);
+	write(data, value.binding);
+	write(data, value.unique_name);
+	write(data, value.texture_name);
+}
+static void write(std::string &data, const uniform_info &value)
+{
+	write(data, value.name);
+	write(data, value.type);
+	write(data, value.size);
+	write(data, value.offset);
+	write(data, value.annotations);
+	write(data, value.has_initializer_value);
+	write(data, value.initializer_value);
+}
+static void write(std::string &data, const shader_cost &value)
+{
+	write(data, value.texture_fetches);
+	write(data, value.alu_operations);
+	write(data, value.has_unbounded_loops);
+}
+static void write(std::string &data, const entry_point &value)
+{
+	write(data, value.name);
+	write(data, value.type);
+	write(data, value.may_discard);
+	write(data, value.is_full_screen_triangle);
+	write(data, value.cost);
+	write(data, value.first_constant_register);
+	write(data, value.num_constant_registers);
+}
+static void write(std::string &data, const pass_info &value)
+{
+	write(data, value.name);
+	for (const std::string &render_target_name : value.render_target_names)
+		write(data, render_target_name);
+	write(data, value.vs_entry_point);
+	write(data, value.ps_entry_point);
+	write(data, value.cs_entry_point);
+	write(data, value.clear_render_targets);
+	write(data, value.srgb_write_enable);
+	write(data, value.blend_enable);
+	write(data, value.stencil_enable);
+	write(data, value.color_write_mask);
+	write(data, value.stencil_read_mask);
+	write(data, value.stencil_write_mask);
+	write(data, value.blend_op);
+	write(data, value.blend_op_alpha);
+	write(data, value.src_blend);
+	write(data, value.dest_blend);
+	write(data, value.src_blend_alpha);
+	write(data, value.dest_blend_alpha);
+	write(data, value.stencil_comparison_func);
+	write(data, value.stencil_reference_value);
+	write(data, value.stencil_op_pass);
+	write(data, value.stencil_op_fail);
+	write(data, value.stencil_op_depth_fail);
+	write(data, value.num_vertices);
+	write(data, value.topology);
+	write(data, value.viewport_width);
+	write(data, value.viewport_height);
+	write(data, value.viewport_dispatch_z);
+	write(data, value.samplers);
+	write(data, value.storages);
+	write(data, value.texel_local_samplers);
+}
+static void write(std::string &data, const technique_info &value)
+{
+	write(data, value.name);
+	write(data, value.passes);
+	write(data, value.annotations);
+}
+
+static bool read(std::string_view &data, type &value);
+static bool read(std::string_view &data, constant &value);
+static bool read(std::string_view &data, annotation &value);
+static bool read(std::string_view &data, texture_info &value);
+static bool read(std::string_view &data, sampler_info &value);
+static bool read(std::string_view &data, storage_info &value);
+static bool read(std::string_view &data, uniform_info &value);
+static bool read(std::string_view &data, shader_cost &value);
+static bool read(std::string_view &data, entry_point &value);
+static bool read(std::string_view &data, pass_info &value);
+static bool read(std::string_view &data, technique_info &value);
+
+template <typename T>
+static std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, bool> read(std::string_view &data, T &value)
+{
+	if (data.size() < sizeof(value))
+		return false;
+	std::memcpy(&value, data.data(), sizeof(value));
+	data.remove_prefix(sizeof(value));
+	return true;
+}
+static bool read(std::string_view &data, std::string &value)
+{
+	uint32_t size = 0;
+	if (!read(data, size) || data.size() < size)
+		return false;
+	value.assign(data.data(), size);
+	data.remove_prefix(size);
+	return true;
+}
+template <typename T>
+static bool read(std::string_view &data, std::vector<T> &values)
+{
+	uint32_t size = 0;
+	// Every element takes up at least one byte, so this rejects a corrupted size before allocating memory for it
+	if (!read(data, size) || data.size() < size)
+		return false;
+	values.resize(size);
+	for (T &value : values)
+		if (!read(data, value))
+			return false;
+	return true;
+}
+
+static bool read(std::string_view &data, type &value)
+{
+	return
+		read(data, value.base) &&
+		read(data, value.rows) &&
+		read(data, value.cols) &&
+		read(data, value.qualifiers) &&
+		read(data, value.array_length) &&
+		read(data, value.definition);
+}
+static bool read(std::string_view &data, constant &value)
+{
+	for (uint32_t &component : value.as_uint)
+		if (!read(data, component))
+			return false;
+	return
+		read(data, value.string_data) &&
+		read(data, value.array_data);
+}
+static bool read(std::string_view &data, annotation &value)
+{
+	return
+		read(data, value.type) &&
+		read(data, value.name) &&
+		read(data, value.value);
+}
+static bool read(std::string_view &data, texture_info &value)
+{
+	return
+		read(data, value.id) &&
+		read(data, value.binding) &&
+		read(data, value.semantic) &&
+		read(data, value.unique_name) &&
+		read(data, value.annotations) &&
+		read(data, value.width) &&
+		read(data, value.height) &&
+		read(data, value.levels) &&
+		read(data, value.format) &&
+		read(data, value.render_target) &&
+		read(data, value.storage_access);
+}
+static bool read(std::string_view &data, sampler_info &value)
+{
+	return
+		read(data, value.id) &&
+		read(data, value.binding) &&
+		read(data, value.texture_binding) &&
+		read(data, value.unique_name) &&
+		read(data, value.texture_name) &&
+		read(data, value.annotations) &&
+		read(data, value.filter) &&
+		read(data, value.address_u) &&
+		read(data, value.address_v) &&
+		read(data, value.address_w) &&
+		read(data, value.min_lod) &&
+		read(data, value.max_lod) &&
+		read(data, value.lod_bias) &&
+		read(data, value.srgb);
+}
+static bool read(std::string_view &data, storage_info &value)
+{
+	return
+		read(data, value.id) &&
+		read(data, value.binding) &&
+		read(data, value.unique_name) &&
+		read(data, value.texture_name);
+}
+static bool read(std::string_view &data, uniform_info &value)
+{
+	return
+		read(data, value.name) &&
+		read(data, value.type) &&
+		read(data, value.size) &&
+		read(data, value.offset) &&
+		read(data, value.annotations) &&
+		read(data, value.has_initializer_value) &&
+		read(data, value.initializer_value);
+}
+static bool read(std::string_view &data, shader_cost &value)
+{
+	return
+		read(data, value.texture_fetches) &&
+		read(data, value.alu_operations) &&
+		read(data, value.has_unbounded_loops);
+}
+static bool read(std::string_view &data, entry_point &value)
+{
+	return
+		read(data, value.name) &&
+		read(data, value.type) &&
+		read(data, value.may_discard) &&
+		read(data, value.is_full_screen_triangle) &&
+		read(data, value.cost) &&
+		read(data, value.first_constant_register) &&
+		read(data, value.num_constant_registers);
+}
+static bool read(std::string_view &data, pass_info &value)
+{
+	if (!read(data, value.name))
+		return false;
+	for (std::string &render_target_name : value.render_target_names)
+		if (!read(data, render_target_name))
+			return false;
+	return
+		read(data, value.vs_entry_point) &&
+		read(data, value.ps_entry_point) &&
+		read(data, value.cs_entry_point) &&
+		read(data, value.clear_render_targets) &&
+		read(data, value.srgb_write_enable) &&
+		read(data, value.blend_enable) &&
+		read(data, value.stencil_enable) &&
+		read(data, value.color_write_mask) &&
+		read(data, value.stencil_read_mask) &&
+		read(data, value.stencil_write_mask) &&
+		read(data, value.blend_op) &&
+		read(data, value.blend_op_alpha) &&
+		read(data, value.src_blend) &&
+		read(data, value.dest_blend) &&
+		read(data, value.src_blend_alpha) &&
+		read(data, value.dest_blend_alpha) &&
+		read(data, value.stencil_comparison_func) &&
+		read(data, value.stencil_reference_value) &&
+		read(data, value.stencil_op_pass) &&
+		read(data, value.stencil_op_fail) &&
+		read(data, value.stencil_op_depth_fail) &&
+		read(data, value.num_vertices) &&
+		read(data, value.topology) &&
+		read(data, value.viewport_width) &&
+		read(data, value.viewport_height) &&
+		read(data, value.viewport_dispatch_z) &&
+		read(data, value.samplers) &&
+		read(data, value.storages) &&
+		read(data, value.texel_local_samplers);
+}
+static bool read(std::string_view &data, technique_info &value)
+{
+	return
+		read(data, value.name) &&
+		read(data, value.passes) &&
+		read(data, value.annotations);
+}
+
+void reshadefx::serialize_module(const module &module, std::string &data)
+{
+	write(data, module_magic);
+	write(data, module_serialization_version);
+
+	write(data, module.hlsl);
+	write(data, module.spirv);
+
+	write(data, static_cast<uint32_t>(module.minified_names.size()));
+	for (const auto &[name, minified_name] : module.minified_names)
+	{
+		write(data, name);
+		write(data, minified_name);
+	}
+
+	write(data, module.entry_points);
+	write(data, module.textures);
+	write(data, module.samplers);
+	write(data, module.storages);
+	write(data, module.uniforms);
+	write(data, module.spec_constants);
+	write(data, module.techniques);
+
+	write(data, module.total_uniform_size);
+	write(data, module.per_frame_uniform_offset);
+	write(data, module.num_texture_bindings);
+	write(data, module.num_sampler_bindings);
+	write(data, module.num_storage_bindings);
+}
+
+bool reshadefx::deserialize_module(std::string_view data, module &module)
+{
+	uint32_t magic = 0, version = 0;
+	if (!read(data, magic) || magic != module_magic ||
+		!read(data, version) || version != module_serialization_version)
+		return false;
+
+	if (!read(data, module.hlsl) ||
+		!read(data, module.spirv))
+		return false;
+
+	uint32_t num_minified_names = 0;
+	if (!read(data, num_minified_names) || data.size() < num_minified_names)
+		return false;
+	module.minified_names.reserve(num_minified_names);
+	for (uint32_t i = 0; i < num_minified_names; ++i)
+	{
+		std::string name, minified_name;
+		if (!read(data, name) || !read(data, minified_name))
+			return false;
+		module.minified_names.emplace(std::move(name), std::move(minified_name));
+	}
+
+	return
+		read(data, module.entry_points) &&
+		read(data, module.textures) &&
+		read(data, module.samplers) &&
+		read(data, module.storages) &&
+		read(data, module.uniforms) &&
+		read(data, module.spec_constants) &&
+		read(data, module.techniques) &&
+		read(data, module.total_uniform_size) &&
+		read(data, module.per_frame_uniform_offset) &&
+		read(data, module.num_texture_bindings) &&
+		read(data, module.num_sampler_bindings) &&
+		read(data, module.num_storage_bindings) &&
+		data.empty(); // Anything left over means the data does not match the format
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <string_view>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// Version of the binary format written by 'serialize_module'. This has to be incremented whenever the module structures change, so that stale data is rejected.
+	/// </summary>
+	constexpr uint32_t module_serialization_version = 2;
+
+	/// <summary>
+	/// Write a module to a binary blob, so that it can be cached and restored later without parsing the effect and generating code again.
+	/// </summary>
+	/// <param name="module">The module to write.</param>
+	/// <param name="data">The blob to append the module to.</param>
+	void serialize_module(const module &module, std::string &data);
+	/// <summary>
+	/// Read a module back from a binary blob written by 'serialize_module'.
+	/// </summary>
+	/// <param name="data">The blob to read.</param>
+	/// <param name="module">Receives the module.</param>
+	/// <returns><c>true</c> if the blob was complete and written with the current version of the format, <c>false</c> otherwise.</returns>
+	bool deserialize_module(std::string_view data, module &module);
+}
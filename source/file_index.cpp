@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "file_index.hpp"
+#include <cwctype> // std::towlower
+#include <fstream>
+#include <algorithm> // std::transform
+
+static std::filesystem::path::string_type normalize(const std::filesystem::path &path)
+{
+	// File names are not case-sensitive on Windows, so neither are the lookups
+	std::filesystem::path::string_type key = path.lexically_normal().native();
+	std::transform(key.begin(), key.end(), key.begin(),
+		[](std::filesystem::path::value_type c) { return static_cast<std::filesystem::path::value_type>(std::towlower(c)); });
+	// Remove trailing separators, so that the same directory always results in the same key
+	while (key.size() > 1 && (key.back() == '\\' || key.back() == '/'))
+		key.pop_back();
+	return key;
+}
+
+static bool hash_file(const std::filesystem::path &path, reshade::content_hasher &hasher)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+		return false;
+
+	char buffer[16 * 1024];
+	while (stream.read(buffer, sizeof(buffer)) || stream.gcount() != 0)
+		hasher.update(buffer, static_cast<size_t>(stream.gcount()));
+	return true;
+}
+
+void reshade::file_index::add_directory(const std::filesystem::path &path)
+{
+	const auto [dir_it, inserted] = _directories.try_emplace(normalize(path));
+	if (!inserted)
+		return; // Directory was added already
+
+	directory &dir = dir_it->second;
+
+	std::error_code ec;
+	for (const std::filesystem::directory_entry &dir_entry : std::filesystem::directory_iterator(path, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		if (dir_entry.is_directory(ec))
+			continue;
+
+		// Directory entries cache the metadata the directory listing returned already, so this does not query the file system again
+		entry &file = dir.files.emplace_back();
+		file.path = dir_entry.path();
+		file.file_size = dir_entry.file_size(ec);
+		file.last_write_time = dir_entry.last_write_time(ec);
+
+		dir.names.emplace(normalize(file.path.filename()), dir.files.size() - 1);
+	}
+}
+
+bool reshade::file_index::is_indexed(const std::filesystem::path &path) const
+{
+	return _directories.find(normalize(path)) != _directories.end();
+}
+const std::vector<reshade::file_index::entry> &reshade::file_index::files(const std::filesystem::path &path) const
+{
+	static const std::vector<entry> empty;
+
+	const auto it = _directories.find(normalize(path));
+	return it != _directories.end() ? it->second.files : empty;
+}
+
+const reshade::file_index::entry *reshade::file_index::find(const std::filesystem::path &path) const
+{
+	const std::filesystem::path normal_path = path.lexically_normal();
+
+	const auto dir_it = _directories.find(normalize(normal_path.parent_path()));
+	if (dir_it == _directories.end())
+		return nullptr;
+
+	const auto name_it = dir_it->second.names.find(normalize(normal_path.filename()));
+	if (name_it == dir_it->second.names.end())
+		return nullptr;
+
+	return &dir_it->second.files[name_it->second];
+}
+bool reshade::file_index::exists(const std::filesystem::path &path) const
+{
+	if (is_indexed(path.lexically_normal().parent_path()))
+		return find(path) != nullptr;
+
+	std::error_code ec;
+	return std::filesystem::exists(path, ec);
+}
+bool reshade::file_index::find_file(const std::vector<std::filesystem::path> &search_paths, std::filesystem::path &path) const
+{
+	// Do not have to perform a search if the path is already absolute
+	if (path.is_absolute())
+		return exists(path);
+
+	for (const std::filesystem::path &search_path : search_paths)
+	{
+		if (std::filesystem::path file_path = (search_path / path).lexically_normal(); exists(file_path))
+		{
+			// Use the spelling of the file system for files in the index, same as canonicalizing the path would
+			if (const entry *const file = find(file_path))
+				file_path = file->path;
+
+			path = std::move(file_path);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+reshade::content_hash reshade::file_index::hash_contents(const entry &file) const
+{
+	std::unique_lock<std::mutex> lock(_content_hashes_mutex);
+	if (const auto it = _content_hashes.find(&file); it != _content_hashes.end())
+		return it->second;
+	lock.unlock();
+
+	// Read the file without holding the lock, so that other files can be hashed at the same time (worst case the same file is hashed twice, with the same result)
+	content_hasher hasher;
+	hash_file(file.path, hasher);
+
+	const content_hash hash = hasher.finalize();
+
+	lock.lock();
+	_content_hashes.emplace(&file, hash);
+	return hash;
+}
+bool reshade::file_index::hash_contents(const std::filesystem::path &path, content_hash &hash) const
+{
+	if (is_indexed(path.lexically_normal().parent_path()))
+	{
+		const entry *const file = find(path);
+		if (file == nullptr)
+			return false;
+
+		hash = hash_contents(*file);
+		return true;
+	}
+
+	// Files outside the index (e.g. in a subdirectory of an include path) are read every time
+	content_hasher hasher;
+	if (!hash_file(path, hasher))
+		return false;
+
+	hash = hasher.finalize();
+	return true;
+}
+
+bool reshade::format_file_hashes(const file_index &files, const std::vector<std::filesystem::path> &paths, std::string &manifest)
+{
+	manifest.clear();
+
+	for (const std::filesystem::path &path : paths)
+	{
+		content_hash hash;
+		if (!files.hash_contents(path, hash))
+			return false;
+
+		manifest += hash.to_string() + ' ' + path.u8string() + '\n';
+	}
+
+	return true;
+}
+bool reshade::check_file_hashes(const file_index &files, std::string_view manifest, std::vector<std::filesystem::path> &paths)
+{
+	paths.clear();
+
+	for (size_t line_end; !manifest.empty(); manifest.remove_prefix(line_end + 1))
+	{
+		// Each line consists of the hash (as 32 hexadecimal digits), followed by a space and the path
+		line_end = manifest.find('\n');
+		if (line_end == std::string_view::npos || line_end <= 33 || manifest[32] != ' ')
+			return false;
+
+		std::filesystem::path path = std::filesystem::u8path(manifest.substr(33, line_end - 33));
+
+		content_hash hash;
+		if (!files.hash_contents(path, hash) || manifest.substr(0, 32) != hash.to_string())
+			return false;
+
+		paths.push_back(std::move(path));
+	}
+
+	return true;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "content_hash.hpp"
+#include <mutex>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+
+namespace reshade
+{
+	/// <summary>
+	/// A snapshot of the files in a set of directories, so that looking up files and their metadata does not have to go to the file system every time.
+	/// The index is not modified after it was built (apart from the internally synchronized content hashes), so it can be queried from multiple threads at once.
+	/// </summary>
+	class file_index
+	{
+	public:
+		struct entry
+		{
+			std::filesystem::path path;
+			uintmax_t file_size = 0;
+			std::filesystem::file_time_type last_write_time;
+		};
+
+		/// <summary>
+		/// Add all files in the specified directory (not including subdirectories) to the index.
+		/// </summary>
+		/// <param name="directory">The absolute path to the directory.</param>
+		void add_directory(const std::filesystem::path &directory);
+
+		/// <summary>
+		/// Returns <c>true</c> if the specified directory was added to the index.
+		/// </summary>
+		bool is_indexed(const std::filesystem::path &directory) const;
+		/// <summary>
+		/// Returns all files in the specified directory, in the order the file system listed them, or an empty list if the directory was not added to the index.
+		/// </summary>
+		const std::vector<entry> &files(const std::filesystem::path &directory) const;
+
+		/// <summary>
+		/// Look up a file in the index.
+		/// </summary>
+		/// <param name="path">The absolute path to the file.</param>
+		/// <returns>The entry of the file, or <c>nullptr</c> if it does not exist or the directory it is in was not added to the index.</returns>
+		const entry *find(const std::filesystem::path &path) const;
+		/// <summary>
+		/// Check whether a file exists, using the index if the directory it is in was added to it and the file system otherwise.
+		/// </summary>
+		/// <param name="path">The absolute path to the file.</param>
+		bool exists(const std::filesystem::path &path) const;
+		/// <summary>
+		/// Search for a file in a list of directories (unless the path is absolute already).
+		/// </summary>
+		/// <param name="search_paths">The absolute paths to the directories to search in order.</param>
+		/// <param name="path">The path to the file to search, which is replaced with the absolute path to it if it was found.</param>
+		/// <returns><c>true</c> if the file was found, <c>false</c> otherwise.</returns>
+		bool find_file(const std::vector<std::filesystem::path> &search_paths, std::filesystem::path &path) const;
+
+		/// <summary>
+		/// Compute the hash of the contents of a file in the index. The file is only read the first time, later calls return the same hash.
+		/// </summary>
+		/// <param name="file">The entry of the file, as returned by <see cref="files"/> or <see cref="find"/>.</param>
+		content_hash hash_contents(const entry &file) const;
+		/// <summary>
+		/// Compute the hash of the contents of a file, using the index if the directory it is in was added to it and reading the file otherwise.
+		/// </summary>
+		/// <param name="path">The absolute path to the file.</param>
+		/// <param name="hash">Receives the hash of the contents of the file.</param>
+		/// <returns><c>true</c> if the file exists, <c>false</c> otherwise.</returns>
+		bool hash_contents(const std::filesystem::path &path, content_hash &hash) const;
+
+	private:
+		struct directory
+		{
+			std::vector<entry> files;
+			// Index into the file list by normalized file name
+			std::unordered_map<std::filesystem::path::string_type, size_t> names;
+		};
+
+		std::unordered_map<std::filesystem::path::string_type, directory> _directories;
+		mutable std::mutex _content_hashes_mutex;
+		mutable std::unordered_map<const entry *, content_hash> _content_hashes;
+	};
+
+	/// <summary>
+	/// Format a list of files together with the hashes of their current contents (one file per line), so that it can be checked later whether any of them were modified.
+	/// </summary>
+	/// <param name="files">The index to look up the files in.</param>
+	/// <param name="paths">The absolute paths to the files.</param>
+	/// <param name="manifest">Receives the formatted list.</param>
+	/// <returns><c>true</c> if all files exist, <c>false</c> otherwise.</returns>
+	bool format_file_hashes(const file_index &files, const std::vector<std::filesystem::path> &paths, std::string &manifest);
+	/// <summary>
+	/// Check whether all files in a list formatted by <see cref="format_file_hashes"/> still exist and have the same contents.
+	/// </summary>
+	/// <param name="files">The index to look up the files in.</param>
+	/// <param name="manifest">The formatted list.</param>
+	/// <param name="paths">Receives the absolute paths to the files in the list.</param>
+	/// <returns><c>true</c> if none of the files were modified, <c>false</c> otherwise (or if the list is malformed).</returns>
+	bool check_file_hashes(const file_index &files, std::string_view manifest, std::vector<std::filesystem::path> &paths);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "file_watcher.hpp"
+#include <cwchar> // _wcsicmp
+#include <algorithm> // std::any_of, std::sort, std::unique
+
+reshade::file_watcher::file_watcher(const std::vector<std::filesystem::path> &directories) :
+	_backend(create_file_watcher_backend(directories))
+{
+}
+reshade::file_watcher::~file_watcher()
+{
+}
+
+bool reshade::file_watcher::check(std::vector<std::filesystem::path> &modifications)
+{
+	modifications.clear();
+
+	_backend->read_changes(modifications);
+
+	// Saving a file usually results in multiple notifications for the same file
+	std::sort(modifications.begin(), modifications.end());
+	modifications.erase(std::unique(modifications.begin(), modifications.end()), modifications.end());
+
+	return !modifications.empty();
+}
+
+static bool is_same_file(const std::filesystem::path &lhs, const std::filesystem::path &rhs)
+{
+#ifdef _WIN32
+	// File names are not case-sensitive on Windows
+	return _wcsicmp(lhs.lexically_normal().c_str(), rhs.lexically_normal().c_str()) == 0;
+#else
+	return lhs.lexically_normal() == rhs.lexically_normal();
+#endif
+}
+
+bool reshade::is_affected_by_modifications(const std::filesystem::path &source_file, const std::vector<std::filesystem::path> &included_files, const std::vector<std::filesystem::path> &modifications)
+{
+	return std::any_of(modifications.begin(), modifications.end(),
+		[&](const std::filesystem::path &path) {
+			if (is_same_file(path, source_file))
+				return true;
+			// Effects that failed to preprocess do not know which files they include, so assume they include every header
+			if (included_files.empty())
+				return path.extension() == ".fxh";
+			return std::any_of(included_files.begin(), included_files.end(),
+				[&](const std::filesystem::path &included_file) { return is_same_file(path, included_file); });
+		});
+}
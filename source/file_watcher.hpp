@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Watches a set of directories for files that are created, modified or renamed, without blocking the thread that checks for these changes.
+	/// </summary>
+	class file_watcher
+	{
+	public:
+		/// <summary>
+		/// A platform specific implementation that collects the change notifications of the operating system.
+		/// </summary>
+		class backend
+		{
+		public:
+			virtual ~backend() {}
+
+			/// <summary>
+			/// Append the files that were modified since the last call, without waiting for any further changes.
+			/// </summary>
+			/// <param name="modifications">Receives the absolute paths to all modified files (possibly multiple times).</param>
+			virtual void read_changes(std::vector<std::filesystem::path> &modifications) = 0;
+		};
+
+		/// <param name="directories">The absolute paths to the directories to watch (not including subdirectories).</param>
+		explicit file_watcher(const std::vector<std::filesystem::path> &directories);
+		~file_watcher();
+
+		file_watcher(const file_watcher &) = delete;
+		file_watcher &operator=(const file_watcher &) = delete;
+
+		/// <summary>
+		/// Collect the files that were modified since the last call.
+		/// </summary>
+		/// <param name="modifications">Receives the absolute paths to all modified files (each only once).</param>
+		/// <returns><c>true</c> if any files were modified, <c>false</c> otherwise.</returns>
+		bool check(std::vector<std::filesystem::path> &modifications);
+
+	private:
+		std::unique_ptr<backend> _backend;
+	};
+
+	/// <summary>
+	/// Create the backend for the current platform (see file_watcher_win32.cpp and file_watcher_inotify.cpp).
+	/// </summary>
+	/// <param name="directories">The absolute paths to the directories to watch (not including subdirectories).</param>
+	std::unique_ptr<file_watcher::backend> create_file_watcher_backend(const std::vector<std::filesystem::path> &directories);
+
+	/// <summary>
+	/// Check whether a source file or any of the files it includes is among a list of modified files.
+	/// </summary>
+	/// <param name="source_file">The absolute path to the source file.</param>
+	/// <param name="included_files">The absolute paths to all files the source file includes, or an empty list if those are not known, in which case it is assumed to include every header (".fxh" file).</param>
+	/// <param name="modifications">The absolute paths to the modified files, as returned by <see cref="file_watcher::check"/>.</param>
+	bool is_affected_by_modifications(const std::filesystem::path &source_file, const std::vector<std::filesystem::path> &included_files, const std::vector<std::filesystem::path> &modifications);
+}
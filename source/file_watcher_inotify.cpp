@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "file_watcher.hpp"
+#include <unordered_map>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+// Large enough to hold all notifications for the burst of changes saving a file in an editor causes
+static const size_t buffer_size = 64 * 1024;
+
+namespace
+{
+	class file_watcher_inotify : public reshade::file_watcher::backend
+	{
+	public:
+		explicit file_watcher_inotify(const std::vector<std::filesystem::path> &directories)
+		{
+			// Non-blocking, so that reading returns right away when there are no changes
+			_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (_fd < 0)
+				return;
+
+			// Files that are written are only reported once they are closed, so that an effect is not reloaded while the file is still being written
+			// Directories that cannot be watched are skipped, same as on Windows
+			for (const std::filesystem::path &path : directories)
+				if (const int wd = inotify_add_watch(_fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO); wd >= 0)
+					_watches[wd] = path;
+		}
+		~file_watcher_inotify() override
+		{
+			// Closing the file descriptor removes all watches
+			if (_fd >= 0)
+				close(_fd);
+		}
+
+		void read_changes(std::vector<std::filesystem::path> &modifications) override
+		{
+			if (_fd < 0)
+				return;
+
+			alignas(inotify_event) char buffer[buffer_size];
+
+			// Each read returns as many complete events as fit into the buffer, so continue until there are none left
+			for (ssize_t size; (size = read(_fd, buffer, sizeof(buffer))) > 0;)
+			{
+				for (const char *it = buffer; it < buffer + size;)
+				{
+					const auto event = reinterpret_cast<const inotify_event *>(it);
+					it += sizeof(inotify_event) + event->len;
+
+					// Events without a name are about the watched directory itself (or signal that the queue overflowed and changes were lost, in which case there is nothing to do but to wait for the next ones)
+					if (event->len == 0 || (event->mask & IN_ISDIR) != 0)
+						continue;
+
+					// Editors often save to a temporary file and rename it afterwards, so the new name of a renamed file counts as a modification too
+					if (const auto watch = _watches.find(event->wd); watch != _watches.end())
+						modifications.push_back(watch->second / event->name);
+				}
+			}
+		}
+
+	private:
+		int _fd = -1;
+		std::unordered_map<int, std::filesystem::path> _watches;
+	};
+}
+
+std::unique_ptr<reshade::file_watcher::backend> reshade::create_file_watcher_backend(const std::vector<std::filesystem::path> &directories)
+{
+	return std::make_unique<file_watcher_inotify>(directories);
+}
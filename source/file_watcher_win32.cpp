@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "dll_log.hpp"
+#include "file_watcher.hpp"
+#include <Windows.h>
+
+// Large enough to hold all notifications for the burst of changes saving a file in an editor causes
+static const DWORD buffer_size = 64 * 1024;
+
+namespace
+{
+	class file_watcher_win32 : public reshade::file_watcher::backend
+	{
+	public:
+		explicit file_watcher_win32(const std::vector<std::filesystem::path> &directories)
+		{
+			for (const std::filesystem::path &path : directories)
+			{
+				const HANDLE handle = CreateFileW(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+				if (handle == INVALID_HANDLE_VALUE)
+				{
+					LOG(WARN) << "Failed to watch " << path << " for changes with error code " << GetLastError() << '.';
+					continue;
+				}
+
+				auto watch = std::make_unique<file_watcher_win32::watch>();
+				watch->path = path;
+				watch->handle = handle;
+				watch->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+				watch->buffer = std::make_unique<uint8_t[]>(buffer_size);
+
+				if (!ReadDirectoryChangesW(handle, watch->buffer.get(), buffer_size, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &watch->overlapped, nullptr))
+				{
+					LOG(WARN) << "Failed to watch " << path << " for changes with error code " << GetLastError() << '.';
+					CloseHandle(watch->overlapped.hEvent);
+					CloseHandle(handle);
+					continue;
+				}
+
+				_watches.push_back(std::move(watch));
+			}
+		}
+		~file_watcher_win32() override
+		{
+			for (const std::unique_ptr<watch> &watch : _watches)
+			{
+				// Wait for the cancellation to complete, since the system writes to the buffer until then
+				DWORD size = 0;
+				CancelIo(watch->handle);
+				GetOverlappedResult(watch->handle, &watch->overlapped, &size, TRUE);
+
+				CloseHandle(watch->overlapped.hEvent);
+				CloseHandle(watch->handle);
+			}
+		}
+
+		void read_changes(std::vector<std::filesystem::path> &modifications) override
+		{
+			for (const std::unique_ptr<watch> &watch : _watches)
+			{
+				DWORD size = 0;
+				if (!GetOverlappedResult(watch->handle, &watch->overlapped, &size, FALSE))
+					continue; // No changes yet (or the directory cannot be watched anymore)
+
+				// A size of zero means the buffer overflowed and the changes are lost, in which case there is nothing to do but to wait for the next ones
+				for (auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(watch->buffer.get()); size != 0;
+					info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(reinterpret_cast<const uint8_t *>(info) + info->NextEntryOffset))
+				{
+					// Editors often save to a temporary file and rename it afterwards, so the new name of a renamed file counts as a modification too
+					if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+						modifications.push_back(watch->path / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+
+					if (info->NextEntryOffset == 0)
+						break;
+				}
+
+				// Continue watching for the next changes
+				ReadDirectoryChangesW(watch->handle, watch->buffer.get(), buffer_size, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &watch->overlapped, nullptr);
+			}
+		}
+
+	private:
+		struct watch
+		{
+			std::filesystem::path path;
+			HANDLE handle = INVALID_HANDLE_VALUE;
+			OVERLAPPED overlapped = {};
+			std::unique_ptr<uint8_t[]> buffer;
+		};
+
+		std::vector<std::unique_ptr<watch>> _watches;
+	};
+}
+
+std::unique_ptr<reshade::file_watcher::backend> reshade::create_file_watcher_backend(const std::vector<std::filesystem::path> &directories)
+{
+	return std::make_unique<file_watcher_win32>(directories);
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "job_system.hpp"
+#include <algorithm> // std::max
+
+// Token of the job the worker thread is currently executing
+static thread_local const reshade::job_system::cancellation_token *s_current_token = nullptr;
+
+void reshade::job_system::job::wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done_signal.wait(lock, [this]() { return _done.load(); });
+}
+
+reshade::job_system::job_system(size_t num_threads)
+{
+	if (num_threads == 0)
+		num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1;
+
+	for (size_t i = 0; i < num_threads; ++i)
+		_threads.emplace_back(&job_system::worker_main, this);
+}
+reshade::job_system::~job_system()
+{
+	// Finish all jobs that are still in the queue (their owners can cancel them if they are no longer needed)
+	wait_idle();
+
+	{	const std::lock_guard<std::mutex> lock(_mutex);
+		_exit = true;
+	}
+
+	_work_signal.notify_all();
+
+	for (std::thread &thread : _threads)
+		thread.join();
+}
+
+reshade::job_system::job_handle reshade::job_system::submit(std::function<void()> func, priority prio, cancellation_token token)
+{
+	const auto job = std::make_shared<job_system::job>();
+	job->_priority = prio;
+	job->_token = std::move(token);
+	job->_func = std::move(func);
+
+	enqueue(job);
+
+	return job;
+}
+reshade::job_system::job_handle reshade::job_system::then(const job_handle &parent, std::function<void()> func, priority prio, cancellation_token token)
+{
+	const auto job = std::make_shared<job_system::job>();
+	job->_priority = prio;
+	job->_token = std::move(token);
+	job->_func = std::move(func);
+
+	{	const std::lock_guard<std::mutex> lock(parent->_mutex);
+		// Continuations are queued by 'finish' once the parent is done, unless it is done already
+		if (!parent->_done)
+		{
+			parent->_continuations.push_back(job);
+			return job;
+		}
+	}
+
+	enqueue(job);
+
+	return job;
+}
+
+void reshade::job_system::wait_idle()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle_signal.wait(lock, [this]() { return _num_pending == 0; });
+}
+
+bool reshade::job_system::is_current_job_cancelled()
+{
+	return s_current_token != nullptr && s_current_token->is_cancelled();
+}
+
+void reshade::job_system::enqueue(job_handle job)
+{
+	{	const std::lock_guard<std::mutex> lock(_mutex);
+		_num_pending++;
+		_queues[static_cast<size_t>(job->_priority)].push_back(std::move(job));
+	}
+
+	_work_signal.notify_one();
+}
+
+void reshade::job_system::worker_main()
+{
+	while (true)
+	{
+		job_handle job;
+
+		{	std::unique_lock<std::mutex> lock(_mutex);
+			_work_signal.wait(lock, [this]() {
+				return _exit || std::any_of(std::begin(_queues), std::end(_queues), [](const std::deque<job_handle> &queue) { return !queue.empty(); }); });
+
+			// Take the first job from the queue with the highest priority
+			for (std::deque<job_handle> &queue : _queues)
+			{
+				if (queue.empty())
+					continue;
+
+				job = std::move(queue.front());
+				queue.pop_front();
+				break;
+			}
+
+			if (job == nullptr)
+				return; // Queues are empty and the job system is being destroyed
+		}
+
+		if (!job->_token.is_cancelled())
+		{
+			s_current_token = &job->_token;
+			job->_func();
+			s_current_token = nullptr;
+		}
+
+		finish(job);
+	}
+}
+
+void reshade::job_system::finish(const job_handle &job)
+{
+	std::vector<job_handle> continuations;
+
+	{	const std::lock_guard<std::mutex> lock(job->_mutex);
+		job->_done = true;
+		job->_func = nullptr; // Release any resources the function captured
+		continuations = std::move(job->_continuations);
+	}
+
+	job->_done_signal.notify_all();
+
+	// Queue continuations before the job is no longer counted as pending, so that 'wait_idle' does not return in between
+	for (job_handle &continuation : continuations)
+		enqueue(std::move(continuation));
+
+	{	const std::lock_guard<std::mutex> lock(_mutex);
+		_num_pending--;
+	}
+
+	_idle_signal.notify_all();
+}
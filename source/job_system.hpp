@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace reshade
+{
+	/// <summary>
+	/// A fixed set of worker threads that execute jobs submitted from any thread, so that background work does not have to create threads of its own or stall the render thread.
+	/// </summary>
+	class job_system
+	{
+	public:
+		/// <summary>
+		/// Jobs of higher priority are started before any jobs of lower priority that are still waiting.
+		/// </summary>
+		enum class priority
+		{
+			high,
+			normal,
+			low,
+		};
+
+		/// <summary>
+		/// A flag shared between the submitter of jobs and the jobs themselves, to be able to abort work that is no longer needed.
+		/// Jobs that were not started yet when the token is cancelled are skipped, jobs that are running already have to check <see cref="is_cancelled"/> themselves.
+		/// </summary>
+		class cancellation_token
+		{
+		public:
+			cancellation_token() : _cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+			void cancel() { *_cancelled = true; }
+			bool is_cancelled() const { return *_cancelled; }
+
+		private:
+			std::shared_ptr<std::atomic<bool>> _cancelled;
+		};
+
+		class job
+		{
+			friend class job_system;
+
+		public:
+			/// <summary>
+			/// Returns <c>true</c> if the job has finished executing or was skipped because it was cancelled.
+			/// </summary>
+			bool is_done() const { return _done; }
+
+			/// <summary>
+			/// Block the calling thread until the job has finished executing or was skipped because it was cancelled.
+			/// This must not be called from within a job, since that can deadlock if all worker threads end up waiting.
+			/// </summary>
+			void wait();
+
+		private:
+			priority _priority;
+			cancellation_token _token;
+			std::function<void()> _func;
+			std::atomic<bool> _done = false;
+			std::mutex _mutex;
+			std::condition_variable _done_signal;
+			// Jobs that are submitted as soon as this one is done
+			std::vector<std::shared_ptr<job>> _continuations;
+		};
+
+		using job_handle = std::shared_ptr<job>;
+
+		/// <param name="num_threads">Number of worker threads to create, or zero to use one less than the number of hardware threads.</param>
+		explicit job_system(size_t num_threads = 0);
+		~job_system();
+
+		job_system(const job_system &) = delete;
+		job_system &operator=(const job_system &) = delete;
+
+		size_t num_threads() const { return _threads.size(); }
+
+		/// <summary>
+		/// Add a job to the queue, which is executed by the next worker thread that becomes available.
+		/// </summary>
+		/// <param name="func">The function to execute.</param>
+		/// <param name="prio">The priority of the job.</param>
+		/// <param name="token">A token that can be used to cancel the job before it is started.</param>
+		/// <returns>A handle that can be used to wait for the job to finish or to add continuations to it.</returns>
+		job_handle submit(std::function<void()> func, priority prio = priority::normal, cancellation_token token = cancellation_token());
+		/// <summary>
+		/// Add a job that is only queued once the specified job is done (regardless of whether that was executed or skipped).
+		/// </summary>
+		/// <param name="parent">The job that has to be done before this one is queued.</param>
+		/// <param name="func">The function to execute.</param>
+		/// <param name="prio">The priority of the job.</param>
+		/// <param name="token">A token that can be used to cancel the job before it is started.</param>
+		/// <returns>A handle that can be used to wait for the job to finish or to add continuations to it.</returns>
+		job_handle then(const job_handle &parent, std::function<void()> func, priority prio = priority::normal, cancellation_token token = cancellation_token());
+
+		/// <summary>
+		/// Block the calling thread until all jobs in the queue have been executed or skipped.
+		/// </summary>
+		void wait_idle();
+
+		/// <summary>
+		/// Returns <c>true</c> if the job the calling thread is executing was cancelled after it was started, so that long running jobs can check this periodically and return early.
+		/// This always returns <c>false</c> when called outside of a job.
+		/// </summary>
+		static bool is_current_job_cancelled();
+
+	private:
+		void enqueue(job_handle job);
+		void worker_main();
+		void finish(const job_handle &job);
+
+		bool _exit = false;
+		size_t _num_pending = 0;
+		std::mutex _mutex;
+		std::condition_variable _work_signal;
+		std::condition_variable _idle_signal;
+		std::deque<job_handle> _queues[3];
+		std::vector<std::thread> _threads;
+	};
+}
@@ -52,6 +52,38 @@ namespace reshade::opengl
 	};
 }
 
+static void restore_minified_names(std::string &log, const std::unordered_map<std::string, std::string> &minified_names)
+{
+	if (minified_names.empty())
+		return;
+
+	const auto is_identifier_char = [](char c) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	};
+
+	// Replace all shortened identifiers in the compiler log with their original name, so that errors can be understood
+	for (size_t offset = 0; offset < log.size();)
+	{
+		if (!is_identifier_char(log[offset]))
+		{
+			offset++;
+			continue;
+		}
+
+		size_t end = offset;
+		while (end < log.size() && is_identifier_char(log[end]))
+			end++;
+
+		if (const auto it = minified_names.find(log.substr(offset, end - offset)); it != minified_names.end())
+		{
+			log.replace(offset, end - offset, it->second);
+			end = offset + it->second.size();
+		}
+
+		offset = end;
+	}
+}
+
 reshade::opengl::runtime_gl::runtime_gl()
 {
 	GLint major = 0, minor = 0;
@@ -384,6 +416,7 @@ bool reshade::opengl::runtime_gl::init_effect(size_t index)
 	}
 
 	// Compile all entry points
+	// This happens on the render thread (which owns the OpenGL context) instead of in a job, so it cannot be cancelled, and the driver does not offer a way to interrupt a glCompileShader or glSpecializeShader call either
 	std::unordered_map<std::string, GLuint> entry_points;
 	for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
 	{
@@ -462,7 +495,9 @@ bool reshade::opengl::runtime_gl::init_effect(size_t index)
 			std::vector<char> log(log_size);
 			glGetShaderInfoLog(shader_object, log_size, nullptr, log.data());
 
-			effect.errors += log.data();
+			std::string errors = log.data();
+			restore_minified_names(errors, effect.module.minified_names);
+			effect.errors += errors;
 
 			for (auto &it : entry_points)
 				glDeleteShader(it.second);
@@ -648,7 +683,9 @@ bool reshade::opengl::runtime_gl::init_effect(size_t index)
 				std::vector<char> log(log_size);
 				glGetProgramInfoLog(pass_data.program, log_size, nullptr, log.data());
 
-				effect.errors += log.data();
+				std::string errors = log.data();
+				restore_minified_names(errors, effect.module.minified_names);
+				effect.errors += errors;
 
 				LOG(ERROR) << "Failed to link program for pass " << pass_index << " in technique '" << technique.name << "'.";
 				success = false;
@@ -1063,18 +1100,27 @@ void reshade::opengl::runtime_gl::render_technique(technique &technique)
 	// Set up shader constants
 	if (_effect_ubos[technique.effect_index] != 0)
 	{
+		effect &effect = _effects[technique.effect_index];
 		glBindBufferBase(GL_UNIFORM_BUFFER, 0, _effect_ubos[technique.effect_index]);
-		glBufferSubData(GL_UNIFORM_BUFFER, 0, _effects[technique.effect_index].uniform_data_storage.size(), _effects[technique.effect_index].uniform_data_storage.data());
+
+		// Uniform variables updated every frame are packed at the end of the buffer and always uploaded, the others only after a value changed
+		const size_t update_offset = effect.uniform_data_dirty ? 0 : effect.module.per_frame_uniform_offset;
+		if (update_offset < effect.uniform_data_storage.size())
+			glBufferSubData(GL_UNIFORM_BUFFER, update_offset, effect.uniform_data_storage.size() - update_offset, effect.uniform_data_storage.data() + update_offset);
+
+		effect.uniform_data_dirty = false;
 	}
 
 	bool is_effect_stencil_cleared = false;
-	bool needs_implicit_backbuffer_copy = true; // First pass always needs the back buffer updated
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
-		if (needs_implicit_backbuffer_copy)
+		if (technique.culled_passes[pass_index])
+			continue; // Nothing uses the output of this pass, so can skip it
+
+		if (_backbuffer_copy_planner.next_pass(technique.pass_accesses[pass_index]))
 		{
-			// Copy back buffer of previous pass to texture
+			// Copy back buffer of previous pass to texture, since this pass samples it
 			glDisable(GL_FRAMEBUFFER_SRGB);
 			glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo[FBO_BACK]);
 			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo[FBO_BLIT]);
@@ -1112,9 +1158,6 @@ void reshade::opengl::runtime_gl::render_technique(technique &technique)
 
 		if (!pass_info.cs_entry_point.empty())
 		{
-			// Compute shaders do not write to the back buffer, so no update necessary
-			needs_implicit_backbuffer_copy = false;
-
 			glDispatchCompute(pass_info.viewport_width, pass_info.viewport_height, pass_info.viewport_dispatch_z);
 		}
 		else
@@ -1200,8 +1243,6 @@ void reshade::opengl::runtime_gl::render_technique(technique &technique)
 
 			_vertices += pass_info.num_vertices;
 			_drawcalls += 1;
-
-			needs_implicit_backbuffer_copy = pass_info.render_target_names[0].empty();
 		}
 
 		// Generate mipmaps for modified resources (graphics passes add their render targets to the 'storages' list)
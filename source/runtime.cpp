@@ -8,13 +8,15 @@
 #include "runtime.hpp"
 #include "runtime_config.hpp"
 #include "runtime_objects.hpp"
+#include "file_index.hpp"
+#include "file_watcher.hpp"
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_serialization.hpp"
 #include "input.hpp"
 #include "input_freepie.hpp"
 #include <set>
-#include <thread>
 #include <cassert>
 #include <algorithm>
 #include <stb_image.h>
@@ -45,31 +47,59 @@ bool resolve_preset_path(std::filesystem::path &path)
 	return !resolve_path(path) || reshade::ini_file::load_cache(path).has({}, "Techniques");
 }
 
-static bool find_file(const std::vector<std::filesystem::path> &search_paths, std::filesystem::path &path)
+static std::unordered_map<std::string, std::string> parse_preprocessor_definitions(const std::vector<std::string> &definitions)
 {
-	std::error_code ec;
-	// Do not have to perform a search if the path is already absolute
-	if (path.is_absolute())
-		return std::filesystem::exists(path, ec);
-	for (std::filesystem::path search_path : search_paths)
-		// Append relative file path to absolute search path
-		if (search_path /= path; resolve_path(search_path))
-			return path = std::move(search_path), true;
-	return false;
+	std::unordered_map<std::string, std::string> result;
+	for (const std::string &definition : definitions)
+	{
+		if (definition.empty() || definition == "=")
+			continue; // Skip invalid definitions
+
+		// The first definition of a name wins, same as when they are added to the preprocessor (the value includes the name, to tell definitions without one apart from those with an empty one)
+		result.emplace(definition.substr(0, definition.find('=')), definition);
+	}
+	return result;
 }
-static std::vector<std::filesystem::path> find_files(const std::vector<std::filesystem::path> &search_paths, std::initializer_list<std::filesystem::path> extensions)
+static uintmax_t calculate_cache_size(const std::filesystem::path &cache_path)
 {
+	uintmax_t size = 0;
 	std::error_code ec;
-	std::vector<std::filesystem::path> files;
-	for (std::filesystem::path search_path : search_paths)
-		if (resolve_path(search_path))
-			for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(search_path, std::filesystem::directory_options::skip_permission_denied, ec))
-				if (!entry.is_directory(ec) &&
-					std::find(extensions.begin(), extensions.end(), entry.path().extension()) != extensions.end())
-					files.emplace_back(entry); // Construct path from directory entry in-place
-	return files;
-}
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(cache_path, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		if (entry.is_directory(ec) || entry.path().filename().native().compare(0, 8, L"reshade-") != 0)
+			continue;
 
+		if (const uintmax_t file_size = entry.file_size(ec); !ec)
+			size += file_size;
+	}
+	return size;
+}
+static void replace_texture_references(reshadefx::pass_info &pass_info, const std::string &texture_name, const std::string &replacement_name)
+{
+	std::replace(std::begin(pass_info.render_target_names), std::end(pass_info.render_target_names), texture_name, replacement_name);
+
+	for (auto &sampler_info : pass_info.samplers)
+		if (sampler_info.texture_name == texture_name)
+			sampler_info.texture_name  = replacement_name;
+	for (auto &storage_info : pass_info.storages)
+		if (storage_info.texture_name == texture_name)
+			storage_info.texture_name  = replacement_name;
+}
+static void replace_texture_references(reshadefx::module &module, const std::string &texture_name, const std::string &replacement_name)
+{
+	// Overwrite referenced texture in samplers
+	for (auto &sampler_info : module.samplers)
+		if (sampler_info.texture_name == texture_name)
+			sampler_info.texture_name  = replacement_name;
+	// Overwrite referenced texture in storages
+	for (auto &storage_info : module.storages)
+		if (storage_info.texture_name == texture_name)
+			storage_info.texture_name  = replacement_name;
+	// Overwrite referenced texture in render targets
+	for (auto &technique_info : module.techniques)
+		for (auto &pass_info : technique_info.passes)
+			replace_texture_references(pass_info, texture_name, replacement_name);
+}
 reshade::runtime::runtime() :
 	_start_time(std::chrono::high_resolution_clock::now()),
 	_last_present_time(std::chrono::high_resolution_clock::now()),
@@ -107,7 +137,7 @@ reshade::runtime::runtime() :
 }
 reshade::runtime::~runtime()
 {
-	assert(_worker_threads.empty());
+	assert(_reload_jobs.empty());
 	assert(!_is_initialized && _techniques.empty());
 
 #if RESHADE_GUI
@@ -358,6 +388,19 @@ void reshade::runtime::on_present()
 
 bool reshade::runtime::load_effect(const std::filesystem::path &source_file, const reshade::ini_file &preset, size_t &effect_index, bool preprocess_required)
 {
+	// Files may have changed since the last reload (e.g. when this is called after editing the effect), so take a new snapshot
+	update_file_index();
+
+	return load_effect(source_file, preset, effect_index, preprocess_required, nullptr, *_file_index);
+}
+bool reshade::runtime::load_effect(const std::filesystem::path &source_file, const reshade::ini_file &preset, size_t &effect_index, bool preprocess_required, background_reload *reload, const file_index &files)
+{
+	// Effects that are loaded in the background are added to a separate set, so that the current one can keep rendering in the meantime
+	std::vector<effect> &effects = reload != nullptr ? reload->effects : _effects;
+	std::vector<texture> &textures = reload != nullptr ? reload->textures : _textures;
+	std::vector<technique> &techniques = reload != nullptr ? reload->techniques : _techniques;
+	std::atomic<size_t> &remaining_effects = reload != nullptr ? reload->remaining_effects : _reload_remaining_effects;
+
 	std::string attributes;
 	attributes += "app=" + g_target_executable_path.stem().u8string() + ';';
 	attributes += "width=" + std::to_string(_width) + ';';
@@ -375,32 +418,37 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		if (resolve_path(include_path))
 			include_paths.emplace(std::move(include_path));
 
+	// Effects that are precompiled for another preset use the definitions of that preset
+	const std::vector<std::string> &preset_preprocessor_definitions = reload != nullptr && reload->precompile ? reload->preset_preprocessor_definitions : _preset_preprocessor_definitions;
+
+	std::vector<std::string> preprocessor_definitions = _global_preprocessor_definitions;
+	preprocessor_definitions.insert(preprocessor_definitions.end(), preset_preprocessor_definitions.begin(), preset_preprocessor_definitions.end());
+	for (const std::string &definition : preprocessor_definitions)
+		attributes += definition + ';';
+
+	content_hasher source_hasher;
+	source_hasher.update(attributes);
+
+	// Hash the contents of all files the effect may include rather than their paths and modification times, so that the cache stays valid when the files are copied somewhere else
+	// The include paths themselves are only separated from each other, since the file names and contents are all that matters for which files an include resolves to
 	for (const std::filesystem::path &include_path : include_paths)
 	{
-		std::error_code ec;
-		attributes += include_path.u8string();
-		for (const auto &entry : std::filesystem::directory_iterator(include_path, std::filesystem::directory_options::skip_permission_denied, ec))
+		source_hasher.update(";", 1);
+		for (const file_index::entry &entry : files.files(include_path))
 		{
-			const std::filesystem::path filename = entry.path().filename();
+			const std::filesystem::path filename = entry.path.filename();
 			if (filename == source_file.filename() || filename.extension() == L".fxh")
 			{
-				attributes += ',';
-				attributes += filename.u8string();
-				attributes += '?';
-				attributes += std::to_string(entry.last_write_time(ec).time_since_epoch().count());
+				const content_hash contents_hash = files.hash_contents(entry);
+				source_hasher.update(filename.u8string());
+				source_hasher.update(&contents_hash, sizeof(contents_hash));
 			}
 		}
-		attributes += ';';
 	}
 
-	std::vector<std::string> preprocessor_definitions = _global_preprocessor_definitions;
-	preprocessor_definitions.insert(preprocessor_definitions.end(), _preset_preprocessor_definitions.begin(), _preset_preprocessor_definitions.end());
-	for (const std::string &definition : preprocessor_definitions)
-		attributes += definition + ';';
-
-	const size_t source_hash = std::hash<std::string>()(attributes);
+	const content_hash source_hash = source_hasher.finalize();
 
-	effect &effect = _effects[effect_index];
+	effect &effect = effects[effect_index];
 	const std::string effect_name = source_file.filename().u8string();
 	if (source_file != effect.source_file || source_hash != effect.source_hash)
 	{
@@ -409,26 +457,27 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		effect.source_hash = source_hash;
 	}
 
-	if (_effect_load_skipping && !_load_option_disable_skipping && !_worker_threads.empty()) // Only skip during 'load_effects'
+	// With prioritization, effects are skipped the same way, but are loaded in the background afterwards (see 'update_and_render_effects')
+	if ((_effect_load_skipping || _effect_load_prioritization) && !_load_option_disable_skipping && (reload != nullptr ? !reload->on_demand : is_loading())) // Only skip during 'load_effects'
 	{
-		if (std::vector<std::string> techniques;
-			preset.get({}, "Techniques", techniques))
+		if (std::vector<std::string> technique_list;
+			preset.get({}, "Techniques", technique_list))
 		{
-			effect.skipped = std::find_if(techniques.cbegin(), techniques.cend(), [&effect_name](const std::string &technique) {
+			effect.skipped = std::find_if(technique_list.cbegin(), technique_list.cend(), [&effect_name](const std::string &technique) {
 				const size_t at_pos = technique.find('@') + 1;
-				return at_pos == 0 || technique.find(effect_name, at_pos) == at_pos; }) == techniques.cend();
+				return at_pos == 0 || technique.find(effect_name, at_pos) == at_pos; }) == technique_list.cend();
 
 			if (effect.skipped)
 			{
-				if (_reload_remaining_effects != 0 && _reload_remaining_effects != std::numeric_limits<size_t>::max())
-					_reload_remaining_effects--;
+				if (remaining_effects != 0 && remaining_effects != std::numeric_limits<size_t>::max())
+					remaining_effects--;
 				return false;
 			}
 		}
 	}
 
 	bool source_cached = false; std::string source;
-	if (!effect.preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file, source_hash, source)) == false))
+	if (!effect.preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file, source_hash, files, source, effect.included_files)) == false))
 	{
 		reshadefx::preprocessor pp;
 		pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
@@ -461,6 +510,11 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		for (const std::filesystem::path &include_path : include_paths)
 			pp.add_include_path(include_path);
 
+		// Abort as soon as the reload this effect is part of was superseded by another one
+		pp.set_abort_callback(&job_system::is_current_job_cancelled);
+		// Resolve includes against the snapshot of the include paths too
+		pp.set_file_exists_callback([&files](const std::filesystem::path &path) { return files.exists(path); });
+
 		// Add some conversion macros for compatibility with older versions of ReShade
 		pp.append_string(
 			"#define tex2Doffset(s, coords, offset) tex2D(s, coords, offset)\n"
@@ -475,13 +529,22 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		// Load and preprocess the source file
 		effect.preprocessed = pp.append_file(source_file);
 
+		// The result is thrown away when the reload was superseded, so there is no point in continuing (or caching a partial result)
+		if (job_system::is_current_job_cancelled())
+			return false;
+
 		// Append preprocessor errors to the error list
 		effect.errors      += pp.errors();
 
 		if (effect.preprocessed)
 		{
 			source = std::move(pp.output());
-			source_cached = save_effect_cache(source_file, source_hash, source);
+
+			// Keep track of included files
+			effect.included_files = pp.included_files();
+			std::sort(effect.included_files.begin(), effect.included_files.end()); // Sort file names alphabetically
+
+			source_cached = save_effect_cache(source_file, source_hash, files, source, effect.included_files);
 
 			// Keep track of used preprocessor definitions (so they can be displayed in the overlay)
 			effect.definitions.clear();
@@ -495,9 +558,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 			std::sort(effect.definitions.begin(), effect.definitions.end());
 
-			// Keep track of included files
-			effect.included_files = pp.included_files();
-			std::sort(effect.included_files.begin(), effect.included_files.end()); // Sort file names alphabetically
+			effect.preprocessor_definitions = preprocessor_definitions;
+			effect.referenced_macros = pp.referenced_macros();
 		}
 	}
 
@@ -515,24 +577,50 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		else
 			shader_model = 60; // D3D12
 
-		std::unique_ptr<reshadefx::codegen> codegen;
-		if ((_renderer_id & 0xF0000) == 0)
-			codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, _performance_mode));
-		else if (_renderer_id < 0x20000)
-			codegen.reset(reshadefx::create_codegen_glsl(!_no_debug_info, _performance_mode, false, true));
-		else // Vulkan uses SPIR-V input
-			codegen.reset(reshadefx::create_codegen_spirv(true, !_no_debug_info, _performance_mode, false, true));
+		// The module only depends on the pre-processed source code and the code generation options, so it can be restored from the cache without parsing and generating code again
+		std::string module_attributes;
+		module_attributes += "version=" + std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION) + ';';
+		module_attributes += "format=" + std::to_string(reshadefx::module_serialization_version) + ';';
+		module_attributes += "shader_model=" + std::to_string(shader_model) + ';';
+		module_attributes += "debug_info=" + std::string(_no_debug_info ? "0" : "1") + ';';
+		module_attributes += "performance_mode=" + std::string(_performance_mode ? "1" : "0") + ';';
 
-		reshadefx::parser parser;
+		const content_hash module_hash = content_hasher().update(module_attributes).update(source).finalize();
 
-		// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
-		effect.compiled = parser.parse(std::move(source), codegen.get());
+		if (std::string warnings; load_effect_cache(source_file, module_hash, effect.module, warnings))
+		{
+			effect.compiled = true;
+			effect.errors += warnings;
+		}
+		else
+		{
+			std::unique_ptr<reshadefx::codegen> codegen;
+			if ((_renderer_id & 0xF0000) == 0)
+				codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, _performance_mode, _performance_mode));
+			else if (_renderer_id < 0x20000)
+				codegen.reset(reshadefx::create_codegen_glsl(!_no_debug_info, _performance_mode, false, true, _no_debug_info));
+			else // Vulkan uses SPIR-V input
+				codegen.reset(reshadefx::create_codegen_spirv(true, !_no_debug_info, _performance_mode, false, true, _performance_mode));
 
-		// Append parser errors to the error list
-		effect.errors  += parser.errors();
+			reshadefx::parser parser;
+			parser.set_abort_callback(&job_system::is_current_job_cancelled);
 
-		// Write result to effect module
-		codegen->write_result(effect.module);
+			// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
+			effect.compiled = parser.parse(std::move(source), codegen.get());
+
+			if (job_system::is_current_job_cancelled())
+				return false;
+
+			// Append parser errors to the error list
+			effect.errors  += parser.errors();
+
+			// Write result to effect module
+			codegen->write_result(effect.module);
+
+			// Only successfully compiled modules are cached, so that errors are always reported again (the warnings are cached along with the module)
+			if (effect.compiled)
+				save_effect_cache(source_file, module_hash, effect.module, parser.errors());
+		}
 
 		if (effect.compiled)
 		{
@@ -545,8 +633,9 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			{
 				variable.effect_index = effect_index;
 
-				// Copy initial data into uniform storage area
-				reset_uniform_value(variable);
+				// Copy initial data into uniform storage area (effects loaded in the background are not in the effect list yet, so this happens when they are swapped in)
+				if (reload == nullptr)
+					reset_uniform_value(variable);
 
 				const std::string_view special = variable.annotation_as_string("source");
 				if (special.empty()) /* Ignore if annotation is missing */;
@@ -648,15 +737,15 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			texture.effect_index = effect_index;
 
 			// Try to share textures with the same name across effects
-			if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
+			if (const auto existing_texture = std::find_if(textures.begin(), textures.end(),
 				[&texture](const auto &item) { return item.unique_name == texture.unique_name; });
-				existing_texture != _textures.end())
+				existing_texture != textures.end())
 			{
 				// Cannot share texture if this is a normal one, but the existing one is a reference and vice versa
 				if (texture.semantic != existing_texture->semantic)
 				{
 					effect.errors += "error: " + texture.unique_name + ": another effect (";
-					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
+					effect.errors += effects[existing_texture->effect_index].source_file.filename().u8string();
 					effect.errors += ") already created a texture with the same name but different semantic\n";
 					effect.compiled = false;
 					break;
@@ -665,13 +754,13 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 				if (texture.semantic.empty() && !existing_texture->matches_description(texture))
 				{
 					effect.errors += "warning: " + texture.unique_name + ": another effect (";
-					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
+					effect.errors += effects[existing_texture->effect_index].source_file.filename().u8string();
 					effect.errors += ") already created a texture with the same name but different dimensions\n";
 				}
 				if (texture.semantic.empty() && (existing_texture->annotation_as_string("source") != texture.annotation_as_string("source")))
 				{
 					effect.errors += "warning: " + texture.unique_name + ": another effect (";
-					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
+					effect.errors += effects[existing_texture->effect_index].source_file.filename().u8string();
 					effect.errors += ") already created a texture with another image file\n";
 				}
 
@@ -698,197 +787,976 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			if (texture.annotation_as_int("pooled") && texture.semantic.empty())
 			{
 				// Try to find another pooled texture to share with
-				if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
+				if (const auto existing_texture = std::find_if(textures.begin(), textures.end(),
 					[&texture](const auto &item) { return item.annotation_as_int("pooled") && item.matches_description(texture); });
-					existing_texture != _textures.end())
+					existing_texture != textures.end())
 				{
-					// Overwrite referenced texture in samplers with the pooled one
-					for (auto &sampler_info : effect.module.samplers)
-						if (sampler_info.texture_name == texture.unique_name)
-							sampler_info.texture_name  = existing_texture->unique_name;
-					// Overwrite referenced texture in storages with the pooled one
-					for (auto &storage_info : effect.module.storages)
-						if (storage_info.texture_name == texture.unique_name)
-							storage_info.texture_name  = existing_texture->unique_name;
-					// Overwrite referenced texture in render targets with the pooled one
-					for (auto &technique_info : effect.module.techniques)
-					{
-						for (auto &pass_info : technique_info.passes)
-						{
-							std::replace(std::begin(pass_info.render_target_names), std::end(pass_info.render_target_names),
-								texture.unique_name, existing_texture->unique_name);
-
-							for (auto &sampler_info : pass_info.samplers)
-								if (sampler_info.texture_name == texture.unique_name)
-									sampler_info.texture_name  = existing_texture->unique_name;
-							for (auto &storage_info : pass_info.storages)
-								if (storage_info.texture_name == texture.unique_name)
-									storage_info.texture_name  = existing_texture->unique_name;
-						}
-					}
+					// Overwrite referenced texture with the pooled one
+					replace_texture_references(effect.module, texture.unique_name, existing_texture->unique_name);
+
+					if (std::find(existing_texture->shared.begin(), existing_texture->shared.end(), effect_index) == existing_texture->shared.end())
+						existing_texture->shared.push_back(effect_index);
+
+					existing_texture->render_target = true;
+					existing_texture->storage_access = true;
+					continue;
+				}
+			}
+
+			if (!texture.semantic.empty() && (texture.semantic != "COLOR" && texture.semantic != "DEPTH"))
+				effect.errors += "warning: " + texture.unique_name + ": unknown semantic '" + texture.semantic + "'\n";
+
+			// This is the first effect using this texture
+			texture.shared.push_back(effect_index);
+
+			textures.push_back(std::move(texture));
+		}
+
+		for (technique technique : effect.module.techniques)
+		{
+			technique.effect_index = effect_index;
+
+			// Determine which resources each pass reads from and writes to once, so that back buffer copies can be planned during rendering
+			for (const reshadefx::pass_info &pass : technique.passes)
+			{
+				technique.pass_accesses.push_back(reshadefx::analyze_pass_access(effect.module, pass));
+				technique.pass_costs.push_back(reshadefx::estimate_pass_cost(effect.module, pass, _width, _height));
+			}
+
+			technique.hidden = technique.annotation_as_int("hidden") != 0;
+
+			if (technique.annotation_as_int("enabled") && reload == nullptr)
+				enable_technique(technique);
+
+			techniques.push_back(std::move(technique));
+		}
+	}
+
+	if (remaining_effects != 0 && remaining_effects != std::numeric_limits<size_t>::max())
+		remaining_effects--;
+	else
+		remaining_effects = 0; // Force effect initialization in 'update_and_render_effects'
+
+	// Precompiled effects are never used, so do not report anything about them
+	if (reload != nullptr && reload->precompile)
+		return effect.compiled && (effect.preprocessed || source_cached);
+
+	if ( effect.compiled && (effect.preprocessed || source_cached))
+	{
+		if (effect.errors.empty())
+			LOG(INFO) << "Successfully loaded " << source_file << '.';
+		else
+			LOG(WARN) << "Successfully loaded " << source_file << " with warnings:\n" << effect.errors;
+		return true;
+	}
+	else
+	{
+		_last_shader_reload_successfull = false;
+
+		if (effect.errors.empty())
+			LOG(ERROR) << "Failed to load " << source_file << '.';
+		else
+			LOG(ERROR) << "Failed to load " << source_file << ":\n" << effect.errors;
+		return false;
+	}
+}
+void reshade::runtime::update_file_index()
+{
+	const auto files = std::make_shared<file_index>();
+	for (std::filesystem::path search_path : _effect_search_paths)
+		if (resolve_path(search_path))
+			files->add_directory(search_path);
+	for (std::filesystem::path search_path : _texture_search_paths)
+		if (resolve_path(search_path))
+			files->add_directory(search_path);
+
+	_file_index = files;
+}
+void reshade::runtime::load_effects()
+{
+	// Effects that were skipped before are part of this reload already
+	_reload_skipped_effects = false;
+
+	// Keep rendering the current effects while the new ones are loaded, unless there is nothing to render yet or the current ones are in the middle of loading themselves
+	const bool in_background = _reload_in_background && !_effects.empty() && !is_loading() && _reload_compile_queue.empty();
+
+	// Clear out any previous effects (or only a previous reload in the background, which this one supersedes)
+	if (in_background)
+		discard_background_reload();
+	else
+		unload_effects();
+
+	// The new effects may include files from different directories, so start watching again once they are loaded
+	_file_watcher.reset();
+	// Same for precompiling the effects of other presets, which may have changed too
+	discard_preset_precompilation();
+
+#if RESHADE_GUI
+	if (!in_background)
+		_show_splash = true; // Always show splash bar when reloading everything
+	_reload_count++;
+#endif
+	_last_shader_reload_successfull = true;
+
+	// Reload preprocessor definitions from current preset before compiling
+	_preset_preprocessor_definitions.clear();
+	// The jobs read from a copy of the preset, since the render thread keeps modifying the cached one (e.g. when values are edited in the overlay while loading in the background)
+	const auto preset = std::make_shared<const ini_file>(ini_file::load_cache(_current_preset_path));
+	preset->get({}, "PreprocessorDefinitions", _preset_preprocessor_definitions);
+
+	// Take one snapshot of the search paths that all effects of this reload look up files in, instead of querying the file system for every single one of them
+	update_file_index();
+	const std::shared_ptr<const file_index> files = _file_index;
+
+	// Build a list of effect files by walking through the effect search paths
+	std::vector<std::filesystem::path> effect_files;
+	for (std::filesystem::path search_path : _effect_search_paths)
+		if (resolve_path(search_path))
+			for (const file_index::entry &file : files->files(search_path))
+				if (file.path.extension() == L".fx")
+					effect_files.push_back(file.path);
+
+	if (effect_files.empty())
+	{
+		if (in_background)
+			unload_effects(); // There is nothing to replace the current effects with
+		return; // No effect files found, so nothing more to do
+	}
+
+	// Allocate space for effects which are placed in this array during the 'load_effect' call
+	background_reload *const reload = in_background ? (_background_reload = std::make_unique<background_reload>()).get() : nullptr;
+	if (in_background)
+	{
+		reload->effects.resize(effect_files.size());
+		reload->remaining_effects = effect_files.size();
+	}
+	else
+	{
+		_effects.resize(effect_files.size());
+		_reload_remaining_effects = effect_files.size();
+	}
+	_last_reload_start_time = std::chrono::high_resolution_clock::now();
+
+	// Start with the effects that took longest to load last time, so that a single slow effect does not end up holding back the reload at the very end
+	// Effects without a previous timing go first, since there is no telling how long they take, ordered by source file size as the best guess available
+	std::vector<std::pair<size_t, std::chrono::high_resolution_clock::duration>> load_order;
+	load_order.reserve(effect_files.size());
+	for (size_t effect_index = 0; effect_index < effect_files.size(); ++effect_index)
+	{
+		std::chrono::high_resolution_clock::duration duration = std::chrono::high_resolution_clock::duration::max();
+		if (const auto it = _effect_load_durations.find(effect_files[effect_index].native()); it != _effect_load_durations.end())
+			duration = it->second;
+		load_order.emplace_back(effect_index, duration);
+	}
+
+	std::vector<uintmax_t> file_sizes(effect_files.size());
+	for (size_t effect_index = 0; effect_index < effect_files.size(); ++effect_index)
+		if (const file_index::entry *const file = files->find(effect_files[effect_index]))
+			file_sizes[effect_index] = file->file_size;
+
+	std::stable_sort(load_order.begin(), load_order.end(), [&file_sizes](const auto &lhs, const auto &rhs) {
+		return lhs.second != rhs.second ? lhs.second > rhs.second : file_sizes[lhs.first] > file_sizes[rhs.first]; });
+
+	// Now that we have a list of files, load them in parallel
+	// Every effect is a separate job, so whichever worker thread becomes available first takes the next effect in the list and no thread sits idle while others still have work left
+	// Keep track of the jobs, so the runtime cannot be destroyed while they are still running
+	std::vector<job_system::job_handle> &jobs = in_background ? reload->jobs : _reload_jobs;
+	jobs.reserve(load_order.size());
+	for (const auto &load_order_entry : load_order)
+		jobs.push_back(_job_system.submit([this, source_file = effect_files[load_order_entry.first], effect_index = load_order_entry.first, preset, reload, files]() mutable {
+			// Abort loading when initialization state changes (indicating that 'on_reset' was called in the meantime)
+			if (!_is_initialized)
+				return;
+
+			const auto load_start_time = std::chrono::high_resolution_clock::now();
+			load_effect(source_file, *preset, effect_index, false, reload, *files);
+			const auto load_duration = std::chrono::high_resolution_clock::now() - load_start_time;
+
+			if (reload != nullptr)
+				compile_background_effect(*reload, effect_index, *preset);
+
+			const std::lock_guard<std::mutex> lock(_reload_mutex);
+			_effect_load_durations[source_file.native()] = load_duration;
+		}, in_background ? reload->priority : job_system::priority::normal, in_background ? reload->cancellation : _reload_cancellation));
+}
+void reshade::runtime::compile_background_effect(background_reload &reload, size_t effect_index, const reshade::ini_file &preset)
+{
+	const effect &effect = reload.effects[effect_index];
+	if (!effect.compiled || effect.skipped)
+		return;
+
+	std::vector<std::string> technique_list;
+	preset.get({}, "Techniques", technique_list);
+
+	const std::lock_guard<std::mutex> lock(_reload_mutex);
+
+	// Only compile effects that are going to be enabled right away, the others are compiled on demand after the swap like usual
+	const std::string effect_name = effect.source_file.filename().u8string();
+	if (!reload.compile_all && std::none_of(reload.techniques.begin(), reload.techniques.end(), [effect_index, &effect_name, &technique_list](const technique &tech) {
+			return tech.effect_index == effect_index && (tech.annotation_as_int("enabled") ||
+				std::find(technique_list.begin(), technique_list.end(), tech.name + '@' + effect_name) != technique_list.end() ||
+				std::find(technique_list.begin(), technique_list.end(), tech.name) != technique_list.end()); }))
+		return;
+
+	std::vector<std::shared_ptr<entry_point_compilation>> &compilations = reload.entry_point_compilations[effect_index];
+
+	// Same as in 'compile_queued_effects', except that the effect is owned by the reload, which waits for these jobs before it is discarded
+	for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
+	{
+		const auto compilation = std::make_shared<entry_point_compilation>();
+		compilation->entry_point_name = entry_point.name;
+
+		// Nothing is waiting for these yet, so leave the worker threads to anything that blocks rendering first
+		compilation->job = _job_system.submit([this, compilation, &effect, &entry_point]() {
+			compilation->success = compile_entry_point(effect, entry_point, compilation->cso, compilation->assembly, compilation->errors);
+		}, reload.priority, reload.cancellation);
+
+		compilations.push_back(compilation);
+	}
+}
+void reshade::runtime::discard_background_reload()
+{
+	std::vector<background_reload *> reloads;
+	if (_background_reload != nullptr)
+		reloads.push_back(_background_reload.get());
+	for (const std::unique_ptr<on_demand_load> &load : _on_demand_loads)
+		reloads.push_back(&load->reload);
+
+	// Make sure no jobs are still accessing the effects of the reloads (and skip those that were not started yet)
+	for (background_reload *const reload : reloads)
+		reload->cancellation.cancel();
+	for (background_reload *const reload : reloads)
+		wait_for_background_reload(*reload);
+
+	// None of their textures were created yet, so there is nothing else to clean up
+	_background_reload.reset();
+	_on_demand_loads.clear();
+}
+void reshade::runtime::wait_for_background_reload(background_reload &reload)
+{
+	for (const job_system::job_handle &job : reload.jobs)
+		job->wait();
+	for (const auto &[effect_index, compilations] : reload.entry_point_compilations)
+		for (const std::shared_ptr<entry_point_compilation> &compilation : compilations)
+			compilation->job->wait();
+}
+bool reshade::runtime::is_background_reload_done(const background_reload &reload)
+{
+	// The entry points are queued for compilation by the load jobs, so only check them once those are done
+	if (std::any_of(reload.jobs.begin(), reload.jobs.end(),
+		[](const job_system::job_handle &job) { return !job->is_done(); }))
+		return false;
+
+	return std::all_of(reload.entry_point_compilations.begin(), reload.entry_point_compilations.end(),
+		[](const auto &it) { return std::all_of(it.second.begin(), it.second.end(),
+			[](const std::shared_ptr<entry_point_compilation> &compilation) { return compilation->job->is_done(); }); });
+}
+void reshade::runtime::finish_background_reload()
+{
+	const std::unique_ptr<background_reload> reload = std::move(_background_reload);
+
+	// The effects are all loaded, but the jobs may still be recording how long that took or queuing entry points for compilation
+	for (const job_system::job_handle &job : reload->jobs)
+		job->wait();
+
+	// Destroy the current effects and swap in the new ones (the effect indices stay the same, so the compile jobs remain valid)
+	unload_effects();
+
+	_effects = std::move(reload->effects);
+	_textures = std::move(reload->textures);
+	_techniques = std::move(reload->techniques);
+	_entry_point_compilations = std::move(reload->entry_point_compilations);
+	_reload_cancellation = std::move(reload->cancellation);
+	// The queue still refers to effects of the previous set
+	_reload_compile_queue.clear();
+
+	// Copy initial data into uniform storage areas now that the effects are in place ('load_current_preset' applies the preset values on top of it afterwards)
+	for (effect &effect : _effects)
+		for (uniform &variable : effect.uniforms)
+			reset_uniform_value(variable);
+
+	LOG(INFO) << "Loaded " << _effects.size() << " effects in the background in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - _last_reload_start_time).count() << " ms.";
+
+	// Let 'update_and_render_effects' finish loading like after any other reload
+	_reload_remaining_effects = 0;
+}
+void reshade::runtime::load_effect_on_demand(size_t effect_index, bool enable_techniques, bool preprocess_required, bool restart)
+{
+	assert(effect_index < _effects.size());
+
+	// Effects that are loaded as part of a full reload already do not need to be loaded again
+	if (is_loading() || _background_reload != nullptr)
+		return;
+
+	if (const auto it = std::find_if(_on_demand_loads.begin(), _on_demand_loads.end(),
+		[effect_index](const std::unique_ptr<on_demand_load> &load) {
+			return std::find(load->effect_indices.begin(), load->effect_indices.end(), effect_index) != load->effect_indices.end(); });
+		it != _on_demand_loads.end())
+	{
+		if (!restart)
+		{
+			if (enable_techniques && std::find((*it)->enabled_effect_indices.begin(), (*it)->enabled_effect_indices.end(), effect_index) == (*it)->enabled_effect_indices.end())
+				(*it)->enabled_effect_indices.push_back(effect_index);
+			return;
+		}
+
+		// The pending load may have read the files or definitions before they were modified, so throw it away and start over
+		(*it)->reload.cancellation.cancel();
+		wait_for_background_reload((*it)->reload);
+
+		enable_techniques |= std::find((*it)->enabled_effect_indices.begin(), (*it)->enabled_effect_indices.end(), effect_index) != (*it)->enabled_effect_indices.end();
+		// Any other skipped effects that were loaded together with this one are loaded again in another batch
+		if ((*it)->in_background)
+			_reload_skipped_effects = true;
+		_on_demand_loads.erase(it);
+	}
+
+	auto load = std::make_unique<on_demand_load>();
+	load->effect_indices = { effect_index };
+	if (enable_techniques)
+		load->enabled_effect_indices = { effect_index };
 
+	// Someone is waiting for this effect to show up, so load it before any other background work (and compile it right away, since its techniques may be enabled as soon as it is there)
+	load->reload.priority = job_system::priority::high;
+	load->reload.compile_all = true;
+
+	start_on_demand_load(std::move(load), preprocess_required);
+}
+void reshade::runtime::load_skipped_effects()
+{
+	std::vector<size_t> effect_indices;
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+		if (_effects[effect_index].skipped && std::none_of(_on_demand_loads.begin(), _on_demand_loads.end(),
+				[effect_index](const std::unique_ptr<on_demand_load> &load) {
+					return std::find(load->effect_indices.begin(), load->effect_indices.end(), effect_index) != load->effect_indices.end(); }))
+			effect_indices.push_back(effect_index);
+
+	if (effect_indices.empty())
+		return;
+
+	// All of them are loaded in a single batch, so that the current effects only have to be updated once when they are added
+	auto load = std::make_unique<on_demand_load>();
+	load->effect_indices = std::move(effect_indices);
+	load->in_background = true;
+	// Nothing is waiting for these, they only need to show up in the UI, so leave the worker threads to anything else first
+	load->reload.priority = job_system::priority::low;
+
+	LOG(INFO) << "Loading " << load->effect_indices.size() << " effects the preset does not enable in the background.";
+
+	start_on_demand_load(std::move(load), false);
+}
+void reshade::runtime::start_on_demand_load(std::unique_ptr<on_demand_load> load, bool preprocess_required)
+{
+	load->reload.effects.resize(_effects.size());
+	load->reload.textures = _textures;
+	load->reload.remaining_effects = load->effect_indices.size();
+	load->reload.on_demand = true;
+
+	update_file_index();
+
+	// Same as in 'load_effects', the jobs read from a copy of the preset
+	const auto preset = std::make_shared<const ini_file>(ini_file::load_cache(_current_preset_path));
+
+	background_reload *const reload = &load->reload;
+	for (const size_t effect_index : load->effect_indices)
+	{
+		reload->jobs.push_back(_job_system.submit([this, source_file = _effects[effect_index].source_file, effect_index, preprocess_required, preset, reload, files = _file_index]() mutable {
+			// Abort loading when initialization state changes (indicating that 'on_reset' was called in the meantime)
+			if (!_is_initialized)
+				return;
+
+			load_effect(source_file, *preset, effect_index, preprocess_required, reload, *files);
+			compile_background_effect(*reload, effect_index, *preset);
+		}, reload->priority, reload->cancellation));
+	}
+
+	_on_demand_loads.push_back(std::move(load));
+}
+void reshade::runtime::finish_on_demand_loads()
+{
+	for (auto it = _on_demand_loads.begin(); it != _on_demand_loads.end();)
+	{
+		on_demand_load &load = **it;
+		if (load.reload.remaining_effects != 0 || !is_background_reload_done(load.reload))
+		{
+			++it;
+			continue;
+		}
+
+		// The compile jobs refer to the effects in the reload, so they must not be moved out of there before they are all done
+		wait_for_background_reload(load.reload);
+
+		// Destroy the previous version of the effects, after saving their current state so that it is applied to the new one
+		bool replace = false;
+		for (const size_t effect_index : load.effect_indices)
+		{
+			if (_effects[effect_index].skipped)
+				continue;
+
+			if (!replace)
+				save_current_preset();
+			replace = true;
+
+			unload_effect(effect_index);
+		}
+
+		// Add the textures the effects use, which either exist already (in which case they are shared now) or are new
+		for (texture &tex : load.reload.textures)
+		{
+			std::vector<size_t> effect_indices;
+			for (const size_t effect_index : load.effect_indices)
+				if (std::find(tex.shared.begin(), tex.shared.end(), effect_index) != tex.shared.end())
+					effect_indices.push_back(effect_index);
+			if (effect_indices.empty())
+				continue;
+
+			if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
+				[&tex](const texture &item) { return item.unique_name == tex.unique_name; });
+				existing_texture != _textures.end())
+			{
+				for (const size_t effect_index : effect_indices)
 					if (std::find(existing_texture->shared.begin(), existing_texture->shared.end(), effect_index) == existing_texture->shared.end())
 						existing_texture->shared.push_back(effect_index);
 
-					existing_texture->render_target = true;
-					existing_texture->storage_access = true;
-					continue;
-				}
-			}
+				// Always make shared textures render targets, same as in 'load_effect'
+				existing_texture->render_target = true;
+				existing_texture->storage_access = true;
+			}
+			else
+			{
+				// This may also be a copy of a texture that was destroyed since the load started, so make sure it belongs to these effects only
+				tex.impl = nullptr;
+				tex.effect_index = effect_indices[0];
+				tex.shared = std::move(effect_indices);
+
+				_textures.push_back(std::move(tex));
+			}
+		}
+
+		// Only the techniques of these effects were added to the copy
+		for (technique &tech : load.reload.techniques)
+			_techniques.push_back(std::move(tech));
+
+		for (const size_t effect_index : load.effect_indices)
+		{
+			_effects[effect_index] = std::move(load.reload.effects[effect_index]);
+			if (const auto compilations_it = load.reload.entry_point_compilations.find(effect_index);
+				compilations_it != load.reload.entry_point_compilations.end())
+				_entry_point_compilations[effect_index] = std::move(compilations_it->second);
+
+			// Copy initial data into uniform storage area now that the effect is in place
+			for (uniform &variable : _effects[effect_index].uniforms)
+				reset_uniform_value(variable);
+		}
+
+		if (!load.enabled_effect_indices.empty())
+		{
+			for (technique &tech : _techniques)
+				if (std::find(load.enabled_effect_indices.begin(), load.enabled_effect_indices.end(), tech.effect_index) != load.enabled_effect_indices.end() && !tech.hidden)
+					enable_technique(tech);
+
+			// Add the techniques to the preset, so that they stay enabled when it is applied below
+			save_current_preset();
+		}
+
+		if (load.in_background)
+			LOG(INFO) << "Loaded " << load.effect_indices.size() << " effects in the background.";
+		else
+			LOG(INFO) << (replace ? "Reloaded " : "Loaded ") << _effects[load.effect_indices[0]].source_file << " on demand.";
+
+		// Let 'update_and_render_effects' apply the preset to the new techniques, like after reloading a single effect
+		_reload_remaining_effects = 0;
+
+		it = _on_demand_loads.erase(it);
+	}
+}
+void reshade::runtime::precompile_presets()
+{
+	discard_preset_precompilation();
+
+	_precompiled_preset_path = _current_preset_path;
+
+	// These are the presets the preset shortcuts switch to
+	std::vector<std::filesystem::path> preset_paths;
+	for (const bool reversed : { false, true })
+		if (std::filesystem::path preset_path; find_next_preset(_current_preset_path.parent_path(), reversed, preset_path) &&
+			preset_path != _current_preset_path && std::find(preset_paths.begin(), preset_paths.end(), preset_path) == preset_paths.end())
+			preset_paths.push_back(std::move(preset_path));
+
+	update_file_index();
+	const std::shared_ptr<const file_index> files = _file_index;
+	const std::filesystem::path cache_path = g_reshade_base_path / _intermediate_cache_path;
+	const uintmax_t cache_quota = static_cast<uintmax_t>(_preset_precompilation_cache_quota) * 1024 * 1024;
+
+	job_system::job_handle previous_job;
+	for (const std::filesystem::path &preset_path : preset_paths)
+	{
+		// Same as in 'load_effects', the jobs read from a copy of the preset
+		const auto preset = std::make_shared<const ini_file>(ini_file::load_cache(preset_path));
+
+		std::vector<std::string> preset_preprocessor_definitions;
+		preset->get({}, "PreprocessorDefinitions", preset_preprocessor_definitions);
+		// Switching to a preset with the same definitions does not compile anything, unless preset values are compile-time constants
+		if (!_performance_mode && preset_preprocessor_definitions == _preset_preprocessor_definitions)
+			continue;
+
+		std::vector<std::string> technique_list;
+		preset->get({}, "Techniques", technique_list);
+
+		for (const effect &effect : _effects)
+		{
+			// Only compile the effects the preset enables
+			const std::string effect_name = effect.source_file.filename().u8string();
+			if (std::none_of(technique_list.begin(), technique_list.end(), [&effect_name](const std::string &technique) {
+					const size_t at_pos = technique.find('@') + 1;
+					return at_pos == 0 || technique.find(effect_name, at_pos) == at_pos; }))
+				continue;
+
+			const auto precompile = [this, source_file = effect.source_file, preset, preset_preprocessor_definitions, files, cache_path, cache_quota, cancellation = _precompilation_cancellation]() mutable {
+				// Abort when initialization state changes (indicating that 'on_reset' was called in the meantime)
+				if (!_is_initialized)
+					return;
+
+				if (calculate_cache_size(cache_path) >= cache_quota)
+				{
+					LOG(INFO) << "Stopped precompiling effects for other presets, since the effect cache exceeds its quota of " << (cache_quota / (1024 * 1024)) << " MiB.";
+					cancellation.cancel(); // Skip all remaining jobs
+					return;
+				}
+
+				background_reload reload;
+				reload.precompile = true;
+				reload.preset_preprocessor_definitions = std::move(preset_preprocessor_definitions);
+				reload.effects.resize(1);
+
+				if (size_t effect_index = 0; !load_effect(source_file, *preset, effect_index, false, &reload, *files))
+					return;
+
+				// The back-end writes the compiled binaries to the cache, nothing else is done with them here
+				for (const reshadefx::entry_point &entry_point : reload.effects[0].module.entry_points)
+				{
+					if (job_system::is_current_job_cancelled())
+						return;
+
+					std::vector<char> cso; std::string assembly, errors;
+					compile_entry_point(reload.effects[0], entry_point, cso, assembly, errors);
+				}
+			};
+
+			// Chain the jobs, so that only one of them runs at a time and anything else that is queued in the meantime gets to run in between
+			previous_job = previous_job == nullptr ?
+				_job_system.submit(precompile, job_system::priority::low, _precompilation_cancellation) :
+				_job_system.then(previous_job, precompile, job_system::priority::low, _precompilation_cancellation);
+			_precompilation_jobs.push_back(previous_job);
+		}
+	}
+
+	if (!_precompilation_jobs.empty())
+		LOG(INFO) << "Precompiling " << _precompilation_jobs.size() << " effects for the next and previous preset in the background.";
+}
+void reshade::runtime::discard_preset_precompilation()
+{
+	_precompilation_cancellation.cancel();
+	for (const job_system::job_handle &job : _precompilation_jobs)
+		job->wait();
+	_precompilation_jobs.clear();
+	_precompilation_cancellation = job_system::cancellation_token();
+
+	// Start over the next time effects are idle
+	_precompiled_preset_path.clear();
+}
+bool reshade::runtime::reload_effects_with_modified_definitions()
+{
+	// Cannot replace single effects while all of them are being loaded
+	if (is_loading() || _background_reload != nullptr)
+		return false;
+
+	std::vector<std::string> preprocessor_definitions = _global_preprocessor_definitions;
+	preprocessor_definitions.insert(preprocessor_definitions.end(), _preset_preprocessor_definitions.begin(), _preset_preprocessor_definitions.end());
+	const std::unordered_map<std::string, std::string> current_definitions = parse_preprocessor_definitions(preprocessor_definitions);
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const effect &effect = _effects[effect_index];
+		// Skipped effects are loaded with the current definitions once they are enabled anyway
+		if (effect.skipped)
+			continue;
+
+		// Effects that were loaded from the preprocessed source in the cache do not know which macros they reference, so have to assume they reference all of them
+		if (effect.preprocessed)
+		{
+			const std::unordered_map<std::string, std::string> effect_definitions = parse_preprocessor_definitions(effect.preprocessor_definitions);
+
+			const auto is_modified = [&](const std::unordered_map<std::string, std::string> &lhs, const std::unordered_map<std::string, std::string> &rhs) {
+				return std::any_of(lhs.begin(), lhs.end(), [&](const std::pair<const std::string, std::string> &definition) {
+					if (const auto it = rhs.find(definition.first); it != rhs.end() && it->second == definition.second)
+						return false; // Definition did not change
+					return std::binary_search(effect.referenced_macros.begin(), effect.referenced_macros.end(), definition.first);
+				});
+			};
+
+			// Check both directions to catch definitions that were added as well as those that were removed
+			if (!is_modified(current_definitions, effect_definitions) && !is_modified(effect_definitions, current_definitions))
+				continue;
+		}
+
+		LOG(INFO) << "Reloading " << effect.source_file << " in the background, since a preprocessor definition it uses was modified.";
+
+		// The definitions are part of the cache key, so the preprocessed source in the cache can be used (e.g. the one 'precompile_presets' put there)
+		load_effect_on_demand(effect_index, false, false, true);
+	}
+
+	return true;
+}
+void reshade::runtime::reload_modified_effects()
+{
+	if (_file_watcher == nullptr)
+	{
+		// Watch the effect search paths and the directories of all files the effects include, which may be elsewhere
+		std::vector<std::filesystem::path> directories;
+		for (std::filesystem::path search_path : _effect_search_paths)
+			if (resolve_path(search_path))
+				directories.push_back(std::move(search_path));
+		for (const effect &effect : _effects)
+			for (const std::filesystem::path &included_file : effect.included_files)
+				directories.push_back(included_file.parent_path().lexically_normal());
+
+		std::sort(directories.begin(), directories.end());
+		directories.erase(std::unique(directories.begin(), directories.end()), directories.end());
+
+		_file_watcher = std::make_unique<file_watcher>(directories);
+		return;
+	}
+
+	std::vector<std::filesystem::path> modifications;
+	if (!_file_watcher->check(modifications))
+		return;
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const effect &effect = _effects[effect_index];
+		// Skipped effects are read from disk anyway once they are enabled
+		if (effect.skipped || !is_affected_by_modifications(effect.source_file, effect.included_files, modifications))
+			continue;
+
+		LOG(INFO) << "Reloading " << effect.source_file << " in the background, since it or a file it includes was modified.";
+
+		load_effect_on_demand(effect_index, false, true, true);
+	}
+}
+bool reshade::runtime::compile_queued_effects()
+{
+	for (const size_t effect_index : _reload_compile_queue)
+	{
+		if (_entry_point_compilations.find(effect_index) != _entry_point_compilations.end())
+			continue; // Already compiling this effect
+
+		const effect &effect = _effects[effect_index];
+
+		std::vector<std::shared_ptr<entry_point_compilation>> &compilations = _entry_point_compilations[effect_index];
+		if (!effect.compiled)
+			continue;
+
+		// The effect is not modified until it is initialized or unloaded (both of which wait for these jobs), so the jobs can reference it directly
+		for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
+		{
+			const auto compilation = std::make_shared<entry_point_compilation>();
+			compilation->entry_point_name = entry_point.name;
+
+			// The compile queue blocks the effects in it from rendering, so compile before any other work
+			compilation->job = _job_system.submit([this, compilation, &effect, &entry_point]() {
+				compilation->success = compile_entry_point(effect, entry_point, compilation->cso, compilation->assembly, compilation->errors);
+			}, job_system::priority::high, _reload_cancellation);
+
+			compilations.push_back(compilation);
+		}
+	}
+
+	const std::vector<std::shared_ptr<entry_point_compilation>> &compilations = _entry_point_compilations.at(_reload_compile_queue.back());
+
+	return std::all_of(compilations.begin(), compilations.end(),
+		[](const std::shared_ptr<entry_point_compilation> &compilation) { return compilation->job->is_done(); });
+}
+void reshade::runtime::init_queued_effect()
+{
+	// Pop an effect from the queue once its entry points were compiled on the worker threads, which leaves only creating the API objects for the render thread
+	const size_t effect_index = _reload_compile_queue.back();
+	_reload_compile_queue.pop_back();
+	effect &effect = _effects[effect_index];
+
+	for (const std::shared_ptr<entry_point_compilation> &compilation : _entry_point_compilations.at(effect_index))
+	{
+		effect.errors += compilation->errors;
+
+		// No need to setup resources if any of the shaders failed to compile
+		if (!compilation->success)
+			effect.compiled = false;
+
+		if (!compilation->assembly.empty())
+			effect.assembly[compilation->entry_point_name] = std::move(compilation->assembly);
+		effect.compiled_entry_points[compilation->entry_point_name] = std::move(compilation->cso);
+	}
+
+	_entry_point_compilations.erase(effect_index);
+
+	// Create textures now, since they are referenced when building samplers in the 'init_effect' call below
+	for (texture &tex : _textures)
+	{
+		if (tex.impl != nullptr || (
+			// Always create shared textures, since they may be in use by this effect already
+			tex.effect_index != effect_index && tex.shared.size() <= 1))
+			continue;
+
+		if (!init_texture(tex))
+		{
+			effect.errors += "Failed to create texture " + tex.unique_name;
+			effect.compiled = false;
+			break;
+		}
+	}
+
+	// Create the API objects for the effect with the back-end implementation (unless compilation or texture creation failed)
+	if (effect.compiled)
+		effect.compiled = init_effect(effect_index);
+
+	// Binaries are not needed anymore once the shader objects were created
+	effect.compiled_entry_points.clear();
+
+	// De-duplicate error lines (D3DCompiler sometimes repeats the same error multiple times)
+	for (size_t line_offset = 0, next_line_offset;
+		(next_line_offset = effect.errors.find('\n', line_offset)) != std::string::npos; line_offset = next_line_offset + 1)
+	{
+		const std::string_view cur_line(effect.errors.c_str() + line_offset, next_line_offset - line_offset);
+
+		if (const size_t end_offset = effect.errors.find('\n', next_line_offset + 1);
+			end_offset != std::string::npos)
+		{
+			const std::string_view next_line(effect.errors.c_str() + next_line_offset + 1, end_offset - next_line_offset - 1);
+			if (cur_line == next_line)
+			{
+				effect.errors.erase(next_line_offset, end_offset - next_line_offset);
+				next_line_offset = line_offset - 1;
+			}
+		}
+
+		// Also remove D3DCompiler warnings about 'groupshared' specifier used in VS/PS modules
+		if (cur_line.find("X3579") != std::string_view::npos)
+		{
+			effect.errors.erase(line_offset, next_line_offset + 1 - line_offset);
+			next_line_offset = line_offset - 1;
+		}
+	}
+
+	if (!effect.compiled) // Something went wrong, do clean up
+	{
+		if (effect.errors.empty())
+			LOG(ERROR) << "Failed initializing " << effect.source_file << '.';
+		else
+			LOG(ERROR) << "Failed initializing " << effect.source_file << ":\n" << effect.errors;
+
+		// Destroy all textures belonging to this effect
+		for (texture &tex : _textures)
+			if (tex.effect_index == effect_index && tex.shared.size() <= 1)
+				destroy_texture(tex);
+		// Disable all techniques belonging to this effect
+		for (technique &tech : _techniques)
+			if (tech.effect_index == effect_index)
+				disable_technique(tech);
+
+		_last_shader_reload_successfull = false;
+	}
+
+	// An effect has changed, need to reload textures (and discard any image data that was decoded for the previous set of textures, the jobs own it and simply finish in the background)
+	_textures_loaded = false;
+	_decoded_images.clear();
+
+#if RESHADE_GUI
+	// Update assembly in viewer after a reload
+	if (_show_code_viewer && !_viewer_entry_point.empty() && effect.compiled)
+	{
+		if (const auto assembly_it = effect.assembly.find(_viewer_entry_point);
+			assembly_it != effect.assembly.end())
+			_viewer.set_text(assembly_it->second);
+	}
+#endif
+}
+void reshade::runtime::alias_transient_textures()
+{
+	reshadefx::transient_texture_allocator allocator;
+
+	for (const texture &tex : _textures)
+	{
+		// Only render targets of a single effect qualify, since the contents of other textures are loaded from an image file, provided by the application or shared with another effect
+		if (!tex.semantic.empty() || !tex.render_target || tex.shared.size() > 1 || !tex.annotation_as_string("source").empty())
+			continue;
+
+		allocator.add_texture(tex, tex.impl != nullptr);
+	}
+
+	for (const technique &tech : _techniques)
+		allocator.add_technique(tech.pass_accesses);
+
+	for (const auto &[texture_name, storage_name] : allocator.allocate())
+	{
+		const auto alias_texture = std::find_if(_textures.begin(), _textures.end(),
+			[&texture_name = texture_name](const auto &item) { return item.unique_name == texture_name; });
+		const auto storage_texture = std::find_if(_textures.begin(), _textures.end(),
+			[&storage_name = storage_name](const auto &item) { return item.unique_name == storage_name; });
+		assert(alias_texture != _textures.end() && storage_texture != _textures.end());
+
+		const size_t effect_index = alias_texture->effect_index;
+		effect &effect = _effects[effect_index];
 
-			if (!texture.semantic.empty() && (texture.semantic != "COLOR" && texture.semantic != "DEPTH"))
-				effect.errors += "warning: " + texture.unique_name + ": unknown semantic '" + texture.semantic + "'\n";
+		// Overwrite referenced texture with the one providing the storage, same as for pooled textures
+		replace_texture_references(effect.module, texture_name, storage_name);
 
-			// This is the first effect using this texture
-			texture.shared.push_back(effect_index);
+		for (technique &tech : _techniques)
+		{
+			if (tech.effect_index != effect_index)
+				continue;
 
-			_textures.push_back(std::move(texture));
+			for (size_t pass_index = 0; pass_index < tech.passes.size(); ++pass_index)
+			{
+				replace_texture_references(tech.passes[pass_index], texture_name, storage_name);
+				tech.pass_accesses[pass_index] = reshadefx::analyze_pass_access(effect.module, tech.passes[pass_index]);
+			}
 		}
 
-		for (technique technique : effect.module.techniques)
-		{
-			technique.effect_index = effect_index;
+		// Rename the texture in the module too, so that it is shared by name again when the module is reused during a reload of the effect
+		if (std::find_if(effect.module.textures.begin(), effect.module.textures.end(),
+			[&storage_name = storage_name](const auto &item) { return item.unique_name == storage_name; }) != effect.module.textures.end())
+			effect.module.textures.erase(std::remove_if(effect.module.textures.begin(), effect.module.textures.end(),
+				[&texture_name = texture_name](const auto &item) { return item.unique_name == texture_name; }), effect.module.textures.end());
+		else
+			for (reshadefx::texture_info &info : effect.module.textures)
+				if (info.unique_name == texture_name)
+					info.unique_name  = storage_name;
 
-			technique.hidden = technique.annotation_as_int("hidden") != 0;
+		if (std::find(storage_texture->shared.begin(), storage_texture->shared.end(), effect_index) == storage_texture->shared.end())
+			storage_texture->shared.push_back(effect_index);
 
-			if (technique.annotation_as_int("enabled"))
-				enable_technique(technique);
+		storage_texture->storage_access |= alias_texture->storage_access;
 
-			_techniques.push_back(std::move(technique));
-		}
-	}
+		effect.aliased_texture_memory_size += reshadefx::texture_memory_size(*alias_texture);
 
-	if (_reload_remaining_effects != 0 && _reload_remaining_effects != std::numeric_limits<size_t>::max())
-		_reload_remaining_effects--;
-	else
-		_reload_remaining_effects = 0; // Force effect initialization in 'update_and_render_effects'
+		LOG(DEBUG) << "Sharing storage of transient texture '" << texture_name << "' with '" << storage_name << "'.";
 
-	if ( effect.compiled && (effect.preprocessed || source_cached))
-	{
-		if (effect.errors.empty())
-			LOG(INFO) << "Successfully loaded " << source_file << '.';
-		else
-			LOG(WARN) << "Successfully loaded " << source_file << " with warnings:\n" << effect.errors;
-		return true;
+		_textures.erase(alias_texture);
 	}
-	else
-	{
-		_last_shader_reload_successfull = false;
 
-		if (effect.errors.empty())
-			LOG(ERROR) << "Failed to load " << source_file << '.';
-		else
-			LOG(ERROR) << "Failed to load " << source_file << ":\n" << effect.errors;
-		return false;
-	}
+	if (allocator.saved_memory_size() != 0)
+		LOG(INFO) << "Saved " << allocator.saved_memory_size() / 1024 << " KiB of texture memory by sharing storage between transient textures.";
 }
-void reshade::runtime::load_effects()
+
+void reshade::runtime::load_textures()
 {
-	// Clear out any previous effects
-	unload_effects();
+	// Decode all image files in background jobs first, so that the render thread does not stall while doing so
+	if (_decoded_images.empty())
+	{
+		_last_texture_reload_successfull = true;
 
-#if RESHADE_GUI
-	_show_splash = true; // Always show splash bar when reloading everything
-	_reload_count++;
-#endif
-	_last_shader_reload_successfull = true;
+		LOG(INFO) << "Loading image files for textures ...";
 
-	// Reload preprocessor definitions from current preset before compiling
-	_preset_preprocessor_definitions.clear();
-	ini_file &preset = ini_file::load_cache(_current_preset_path);
-	preset.get({}, "PreprocessorDefinitions", _preset_preprocessor_definitions);
+		// Look up image files in the snapshot taken during the last reload
+		if (_file_index == nullptr)
+			update_file_index();
 
-	// Build a list of effect files by walking through the effect search paths
-	const std::vector<std::filesystem::path> effect_files =
-		find_files(_effect_search_paths, { L".fx" });
+		std::vector<std::filesystem::path> texture_search_paths;
+		for (std::filesystem::path search_path : _texture_search_paths)
+			if (resolve_path(search_path))
+				texture_search_paths.push_back(std::move(search_path));
 
-	if (effect_files.empty())
-		return; // No effect files found, so nothing more to do
+		for (texture &texture : _textures)
+		{
+			if (texture.impl == nullptr || !texture.semantic.empty())
+				continue; // Ignore textures that are not created yet and those that are handled in the runtime implementation
 
-	// Allocate space for effects which are placed in this array during the 'load_effect' call
-	_effects.resize(effect_files.size());
-	_reload_remaining_effects = effect_files.size();
+			std::filesystem::path source_path = std::filesystem::u8path(
+				texture.annotation_as_string("source"));
+			// Ignore textures that have no image file attached to them (e.g. plain render targets)
+			if (source_path.empty())
+				continue;
 
-	// Now that we have a list of files, load them in parallel
-	// Split workload into batches instead of launching a thread for every file to avoid launch overhead and stutters due to too many threads being in flight
-	const size_t num_splits = std::min<size_t>(effect_files.size(), std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1);
+			// Search for image file using the provided search paths unless the path provided is already absolute
+			if (!_file_index->find_file(texture_search_paths, source_path))
+			{
+				LOG(ERROR) << "Source " << source_path << " for texture '" << texture.unique_name << "' could not be found in any of the texture search paths.";
+				_last_texture_reload_successfull = false;
+				continue;
+			}
 
-	// Keep track of the spawned threads, so the runtime cannot be destroyed while they are still running
-	for (size_t n = 0; n < num_splits; ++n)
-		_worker_threads.emplace_back([this, effect_files, num_splits, n, &preset]() {
-			// Abort loading when initialization state changes (indicating that 'on_reset' was called in the meantime)
-			for (size_t i = 0; i < effect_files.size() && _is_initialized; ++i)
-				if (i * num_splits / effect_files.size() == n)
-					load_effect(effect_files[i], preset, i);
-		});
-}
-void reshade::runtime::load_textures()
-{
-	_last_texture_reload_successfull = true;
+			const auto image = std::make_shared<decoded_image>();
+			image->texture_name = texture.unique_name;
+			image->source_path = std::move(source_path);
 
-	LOG(INFO) << "Loading image files for textures ...";
+			// Textures block rendering until they are loaded, so decode them before any other work
+			image->job = _job_system.submit([image, texture_width = texture.width, texture_height = texture.height]() {
+				unsigned char *filedata = nullptr;
+				int width = 0, height = 0, channels = 0;
 
-	for (texture &texture : _textures)
-	{
-		if (texture.impl == nullptr || !texture.semantic.empty())
-			continue; // Ignore textures that are not created yet and those that are handled in the runtime implementation
+				if (FILE *file; _wfopen_s(&file, image->source_path.c_str(), L"rb") == 0)
+				{
+					// Read texture data into memory in one go since that is faster than reading chunk by chunk
+					std::vector<uint8_t> mem(static_cast<size_t>(std::filesystem::file_size(image->source_path)));
+					fread(mem.data(), 1, mem.size(), file);
+					fclose(file);
 
-		std::filesystem::path source_path = std::filesystem::u8path(
-			texture.annotation_as_string("source"));
-		// Ignore textures that have no image file attached to them (e.g. plain render targets)
-		if (source_path.empty())
-			continue;
+					if (stbi_dds_test_memory(mem.data(), static_cast<int>(mem.size())))
+						filedata = stbi_dds_load_from_memory(mem.data(), static_cast<int>(mem.size()), &width, &height, &channels, STBI_rgb_alpha);
+					else
+						filedata = stbi_load_from_memory(mem.data(), static_cast<int>(mem.size()), &width, &height, &channels, STBI_rgb_alpha);
+				}
 
-		// Search for image file using the provided search paths unless the path provided is already absolute
-		if (!find_file(_texture_search_paths, source_path))
-		{
-			LOG(ERROR) << "Source " << source_path << " for texture '" << texture.unique_name << "' could not be found in any of the texture search paths.";
-			_last_texture_reload_successfull = false;
-			continue;
-		}
+				if (filedata == nullptr)
+					return;
 
-		unsigned char *filedata = nullptr;
-		int width = 0, height = 0, channels = 0;
+				image->data.resize(texture_width * texture_height * 4);
 
-		if (FILE *file; _wfopen_s(&file, source_path.c_str(), L"rb") == 0)
-		{
-			// Read texture data into memory in one go since that is faster than reading chunk by chunk
-			std::vector<uint8_t> mem(static_cast<size_t>(std::filesystem::file_size(source_path)));
-			fread(mem.data(), 1, mem.size(), file);
-			fclose(file);
+				// Need to potentially resize image data to the texture dimensions
+				if (texture_width != uint32_t(width) || texture_height != uint32_t(height))
+				{
+					LOG(INFO) << "Resizing image data for texture '" << image->texture_name << "' from " << width << "x" << height << " to " << texture_width << "x" << texture_height << " ...";
 
-			if (stbi_dds_test_memory(mem.data(), static_cast<int>(mem.size())))
-				filedata = stbi_dds_load_from_memory(mem.data(), static_cast<int>(mem.size()), &width, &height, &channels, STBI_rgb_alpha);
-			else
-				filedata = stbi_load_from_memory(mem.data(), static_cast<int>(mem.size()), &width, &height, &channels, STBI_rgb_alpha);
-		}
+					stbir_resize_uint8(filedata, width, height, 0, image->data.data(), texture_width, texture_height, 0, 4);
+				}
+				else
+				{
+					std::memcpy(image->data.data(), filedata, image->data.size());
+				}
 
-		if (filedata == nullptr)
-		{
-			LOG(ERROR) << "Source " << source_path << " for texture '" << texture.unique_name << "' could not be loaded! Make sure it is of a compatible file format.";
-			_last_texture_reload_successfull = false;
-			continue;
+				stbi_image_free(filedata);
+			}, job_system::priority::high, _reload_cancellation);
+
+			_decoded_images.push_back(image);
 		}
+	}
 
-		// Need to potentially resize image data to the texture dimensions
-		if (texture.width != uint32_t(width) || texture.height != uint32_t(height))
-		{
-			LOG(INFO) << "Resizing image data for texture '" << texture.unique_name << "' from " << width << "x" << height << " to " << texture.width << "x" << texture.height << " ...";
+	if (std::any_of(_decoded_images.begin(), _decoded_images.end(),
+		[](const std::shared_ptr<decoded_image> &image) { return !image->job->is_done(); }))
+		return; // Cannot upload while image files are still being decoded
 
-			std::vector<uint8_t> resized(texture.width * texture.height * 4);
-			stbir_resize_uint8(filedata, width, height, 0, resized.data(), texture.width, texture.height, 0, 4);
-			upload_texture(texture, resized.data());
-		}
-		else
+	// Upload the decoded image data on the render thread
+	for (const std::shared_ptr<decoded_image> &image : _decoded_images)
+	{
+		const auto texture = std::find_if(_textures.begin(), _textures.end(),
+			[&image](const reshade::texture &item) { return item.unique_name == image->texture_name; });
+		if (texture == _textures.end() || texture->impl == nullptr)
+			continue; // Texture was destroyed in the meantime
+
+		if (image->data.empty())
 		{
-			upload_texture(texture, filedata);
+			LOG(ERROR) << "Source " << image->source_path << " for texture '" << texture->unique_name << "' could not be loaded! Make sure it is of a compatible file format.";
+			_last_texture_reload_successfull = false;
+			continue;
 		}
 
-		stbi_image_free(filedata);
+		upload_texture(*texture, image->data.data());
 
-		texture.loaded = true;
+		texture->loaded = true;
 	}
 
+	_decoded_images.clear();
+
 	_textures_loaded = true;
 }
 
@@ -900,6 +1768,14 @@ void reshade::runtime::unload_effect(size_t effect_index)
 	_preview_texture = nullptr;
 #endif
 
+	// Make sure no jobs are still compiling entry points of this effect
+	if (const auto it = _entry_point_compilations.find(effect_index); it != _entry_point_compilations.end())
+	{
+		for (const std::shared_ptr<entry_point_compilation> &compilation : it->second)
+			compilation->job->wait();
+		_entry_point_compilations.erase(it);
+	}
+
 	// Lock here to be safe in case another effect is still loading
 	const std::lock_guard<std::mutex> lock(_reload_mutex);
 
@@ -929,11 +1805,23 @@ void reshade::runtime::unload_effects()
 	_effect_filter[0] = '\0'; // And reset filter too, since the list of techniques might have changed
 #endif
 
-	// Make sure no threads are still accessing effect data
-	for (std::thread &thread : _worker_threads)
-		if (thread.joinable())
-			thread.join();
-	_worker_threads.clear();
+	// Make sure no jobs are still accessing effect data (and skip those that were not started yet)
+	_reload_cancellation.cancel();
+	for (const job_system::job_handle &job : _reload_jobs)
+		job->wait();
+	_reload_jobs.clear();
+	for (const auto &[effect_index, compilations] : _entry_point_compilations)
+		for (const std::shared_ptr<entry_point_compilation> &compilation : compilations)
+			compilation->job->wait();
+	_entry_point_compilations.clear();
+	_reload_cancellation = job_system::cancellation_token();
+
+	// Effects that are still being loaded in the background would only replace the ones destroyed here later
+	discard_background_reload();
+	discard_preset_precompilation();
+
+	// Image data that is still being decoded is no longer needed either (the jobs own it, so they can just finish in the background)
+	_decoded_images.clear();
 
 	// Destroy all textures
 	for (texture &tex : _textures)
@@ -947,24 +1835,72 @@ void reshade::runtime::unload_effects()
 	_effects.clear();
 }
 
-bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const size_t hash, std::string &source) const
+bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const content_hash &hash, const file_index &files, std::string &source, std::vector<std::filesystem::path> &included_files) const
 {
 	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
-	path /= "reshade-" + source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(hash) + ".i";
+	path /= "reshade-" + source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + hash.to_string() + ".i";
 
 	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
 	if (file == INVALID_HANDLE_VALUE)
 		return false;
+	std::string data;
 	DWORD size = GetFileSize(file, nullptr);
-	source.resize(size);
-	const BOOL result = ReadFile(file, source.data(), size, &size, nullptr);
+	data.resize(size);
+	const BOOL result = ReadFile(file, data.data(), size, &size, nullptr);
 	CloseHandle(file);
-	return result != FALSE;
+	if (result == FALSE)
+		return false;
+
+	// The included files and the hashes of their contents are stored in front of the source, terminated by a null character
+	const size_t manifest_end = data.find('\0');
+	if (manifest_end == std::string::npos)
+		return false;
+
+	// The hash in the file name only covers the source file and the headers next to it or in the include paths, so files included from elsewhere (e.g. subdirectories) have to be checked here
+	// If any of them were modified, the source is preprocessed again and the entry overwritten
+	std::vector<std::filesystem::path> cached_included_files;
+	if (!check_file_hashes(files, std::string_view(data).substr(0, manifest_end), cached_included_files))
+		return false;
+
+	source = data.substr(manifest_end + 1);
+	included_files = std::move(cached_included_files);
+	return true;
+}
+bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const content_hash &hash, reshadefx::module &module, std::string &warnings) const
+{
+	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
+	path /= "reshade-" + source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + hash.to_string() + ".module";
+
+	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	std::string data;
+	DWORD size = GetFileSize(file, nullptr);
+	data.resize(size);
+	const BOOL result = ReadFile(file, data.data(), size, &size, nullptr);
+	CloseHandle(file);
+	if (result == FALSE)
+		return false;
+
+	// The warnings are stored in front of the module, terminated by a null character
+	const size_t warnings_end = data.find('\0');
+	if (warnings_end == std::string::npos)
+		return false;
+
+	// Data written by a different version of the format (or a partial write) is rejected, in which case the effect is just compiled again
+	if (reshadefx::module cached_module; reshadefx::deserialize_module(std::string_view(data).substr(warnings_end + 1), cached_module))
+	{
+		module = std::move(cached_module);
+		warnings = data.substr(0, warnings_end);
+		return true;
+	}
+
+	return false;
 }
-bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, std::vector<char> &cso, std::string &dasm) const
+bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const content_hash &hash, std::vector<char> &cso, std::string &dasm) const
 {
 	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
-	path /= "reshade-" + source_file.stem().u8string() + '-' + entry_point + '-' + std::to_string(_renderer_id) + '-' + std::to_string(hash) + ".cso";
+	path /= "reshade-" + source_file.stem().u8string() + '-' + entry_point + '-' + std::to_string(_renderer_id) + '-' + hash.to_string() + ".cso";
 
 	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
 		if (file == INVALID_HANDLE_VALUE)
@@ -992,47 +1928,73 @@ bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_fil
 
 	return true;
 }
-bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const std::string &source) const
+bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const content_hash &hash, const file_index &files, const std::string &source, const std::vector<std::filesystem::path> &included_files) const
 {
 	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
-	path /= "reshade-" + source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(hash) + ".i";
+	path /= "reshade-" + source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + hash.to_string() + ".i";
 
-	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	std::string data;
+	if (!format_file_hashes(files, included_files, data))
+		return false;
+	data += '\0';
+	data += source;
+
+	// Entries with the same name may exist already when an included file outside of what the hash in the file name covers was modified, so overwrite them
+	// Files are not shared while being written, so that a reload happening at the same time treats them as not cached yet instead of reading partial data
+	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
 	if (file == INVALID_HANDLE_VALUE)
 		return false;
-	DWORD size = static_cast<DWORD>(source.size());
-	const BOOL result = WriteFile(file, source.data(), size, &size, nullptr);
+	DWORD size = static_cast<DWORD>(data.size());
+	const BOOL result = WriteFile(file, data.data(), size, &size, nullptr);
 	CloseHandle(file);
 	return result != FALSE;
 }
-bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, const std::vector<char> &cso, const std::string &dasm) const
+bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const content_hash &hash, const reshadefx::module &module, const std::string &warnings) const
 {
 	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
-	path /= "reshade-" + source_file.stem().u8string() + '-' + entry_point + '-' + std::to_string(_renderer_id) + '-' + std::to_string(hash) + ".cso";
+	path /= "reshade-" + source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + hash.to_string() + ".module";
 
-	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
-		if (file == INVALID_HANDLE_VALUE)
-			return false;
-		DWORD size = static_cast<DWORD>(cso.size());
-		const BOOL result = WriteFile(file, cso.data(), size, &size, nullptr);
-		CloseHandle(file);
-		if (result == FALSE)
-			return false;
-	}
+	std::string data = warnings;
+	data += '\0';
+	reshadefx::serialize_module(module, data);
 
-	path.replace_extension(L".asm");
+	// Files are not shared while being written, so that a reload happening at the same time treats them as not cached yet instead of reading partial data
+	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	DWORD size = static_cast<DWORD>(data.size());
+	const BOOL result = WriteFile(file, data.data(), size, &size, nullptr);
+	CloseHandle(file);
+	return result != FALSE;
+}
+void reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const content_hash &hash, const std::vector<char> &cso, const std::string &dasm)
+{
+	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
+	path /= "reshade-" + source_file.stem().u8string() + '-' + entry_point + '-' + std::to_string(_renderer_id) + '-' + hash.to_string() + ".cso";
+
+	// Nothing waits for the cache to be written, so do that in a background job
+	// Files are not shared while being written, so that a reload happening at the same time treats them as not cached yet instead of reading partial data
+	_job_system.submit([path = std::move(path), cso, dasm]() mutable {
+		{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+			DWORD size = static_cast<DWORD>(cso.size());
+			const BOOL result = WriteFile(file, cso.data(), size, &size, nullptr);
+			CloseHandle(file);
+			if (result == FALSE)
+				return;
+		}
 
-	{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
-		if (file == INVALID_HANDLE_VALUE)
-			return false;
-		DWORD size = static_cast<DWORD>(dasm.size());
-		const BOOL result = WriteFile(file, dasm.c_str(), size, &size, NULL);
-		CloseHandle(file);
-		if (result == FALSE)
-			return false;
-	}
+		path.replace_extension(L".asm");
 
-	return true;
+		{	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+			DWORD size = static_cast<DWORD>(dasm.size());
+			WriteFile(file, dasm.c_str(), size, &size, NULL);
+			CloseHandle(file);
+		}
+	}, job_system::priority::low);
 }
 
 void reshade::runtime::update_and_render_effects()
@@ -1041,13 +2003,95 @@ void reshade::runtime::update_and_render_effects()
 	if (_framecount == 0 && !_no_reload_on_init)
 		load_effects();
 
+	// Swap in effects that were loaded in the background as soon as all of them are there, so that they replace the current ones on a frame boundary
+	const bool background_reload_finished = _background_reload != nullptr && _background_reload->remaining_effects == 0;
+	if (background_reload_finished)
+		finish_background_reload();
+
+	// Same for effects that were loaded on demand, which are added to the current ones
+	if (!_on_demand_loads.empty() && !is_loading())
+		finish_on_demand_loads();
+
+	// Effects that are loading pick up any modifications anyway, so only look for them in between reloads
+	if (!_watch_effect_files)
+		_file_watcher.reset();
+	else if (!is_loading() && _background_reload == nullptr)
+		reload_modified_effects();
+
+	// Use the time the effects are idle to fill the cache with the effects of the presets that are likely switched to next
+	if (!_preset_precompilation)
+	{
+		if (!_precompilation_jobs.empty())
+			discard_preset_precompilation();
+	}
+	else if (_precompiled_preset_path != _current_preset_path && !is_loading() && _background_reload == nullptr && _on_demand_loads.empty() && _reload_compile_queue.empty() && _textures_loaded)
+	{
+		precompile_presets();
+	}
+
 	if (_reload_remaining_effects == 0)
 	{
-		// Clear the thread list now that they all have finished
-		for (std::thread &thread : _worker_threads)
-			if (thread.joinable())
-				thread.join(); // Threads have exited, but still need to join them prior to destruction
-		_worker_threads.clear();
+		// Only log how long loading took if this was a full reload, not just a single effect that was reloaded
+		if (!_reload_jobs.empty())
+			LOG(INFO) << "Loaded " << _effects.size() << " effects in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - _last_reload_start_time).count() << " ms.";
+
+		// Clear the job list now that they all have finished
+		for (const job_system::job_handle &job : _reload_jobs)
+			job->wait(); // Jobs have loaded their effect, but may still be recording how long that took
+		_reload_jobs.clear();
+
+		// All techniques are known now, so can figure out which render targets are able to share storage
+		alias_transient_textures();
+
+		// Also figure out which passes can be skipped, because nothing uses their output
+		reshadefx::dead_pass_analysis dead_passes;
+		for (const technique &tech : _techniques)
+			dead_passes.add_technique(tech.pass_accesses);
+
+		std::vector<std::vector<bool>> culled_passes = dead_passes.resolve();
+		for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+			_techniques[technique_index].culled_passes = std::move(culled_passes[technique_index]);
+
+		// Add up the video memory every effect would occupy, so that it is easy to tell which ones are responsible for most of it (the depth buffer copy is assumed to match the back buffer in size)
+		reshadefx::memory_footprint_calculator footprints(
+			static_cast<size_t>(_width) * _height * (_color_bit_depth > 10 ? 8 : 4),
+			static_cast<size_t>(_width) * _height * 4);
+		for (const effect &effect : _effects)
+			footprints.add_effect(effect.compiled ? effect.module : reshadefx::module());
+
+		std::vector<reshadefx::memory_footprint> effect_footprints;
+		std::vector<std::vector<reshadefx::memory_footprint>> technique_footprints;
+		footprints.resolve(effect_footprints, technique_footprints);
+
+		size_t total_memory_size = 0;
+		for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+		{
+			effect &effect = _effects[effect_index];
+			effect.memory_footprint = effect_footprints[effect_index];
+
+			if (effect.memory_footprint.total() == 0)
+				continue;
+
+			total_memory_size += effect.memory_footprint.total();
+
+			LOG(INFO) << "Effect " << effect.source_file << " occupies " << effect.memory_footprint.total() / 1024 << " KiB of video memory ("
+				<< effect.memory_footprint.texture_memory_size / 1024 << " KiB textures, "
+				<< effect.memory_footprint.buffer_copy_memory_size / 1024 << " KiB back buffer and depth buffer copies, "
+				<< effect.memory_footprint.uniform_memory_size << " bytes uniforms).";
+		}
+
+		for (technique &tech : _techniques)
+		{
+			if (!_effects[tech.effect_index].compiled)
+				continue;
+
+			const std::vector<reshadefx::technique_info> &module_techniques = _effects[tech.effect_index].module.techniques;
+			if (const auto it = std::find_if(module_techniques.begin(), module_techniques.end(),
+				[&tech](const reshadefx::technique_info &info) { return info.name == tech.name; }); it != module_techniques.end())
+				tech.memory_footprint = technique_footprints[tech.effect_index][it - module_techniques.begin()];
+		}
+
+		LOG(INFO) << "Effects occupy " << total_memory_size / 1024 << " KiB of video memory in total.";
 
 		// Finished loading effects, so apply preset to figure out which ones need compiling
 		load_current_preset();
@@ -1055,9 +2099,32 @@ void reshade::runtime::update_and_render_effects()
 		_last_reload_time = std::chrono::high_resolution_clock::now();
 		_reload_remaining_effects = std::numeric_limits<size_t>::max();
 
+		// Effects that were only skipped to render the enabled ones sooner still have to be loaded
+		_reload_skipped_effects = _effect_load_prioritization && !_effect_load_skipping && !_load_option_disable_skipping &&
+			std::any_of(_effects.begin(), _effects.end(), [](const effect &effect) { return effect.skipped; });
+
 		// Reset all effect loading options
 		_load_option_disable_skipping = false;
 
+		// The previous effects are gone already, so initialize all enabled effects and their textures in this frame too, instead of spreading that out over the next frames without rendering anything
+		if (background_reload_finished)
+		{
+			while (!_reload_compile_queue.empty())
+			{
+				if (!compile_queued_effects())
+					for (const std::shared_ptr<entry_point_compilation> &compilation : _entry_point_compilations.at(_reload_compile_queue.back()))
+						compilation->job->wait();
+
+				init_queued_effect();
+			}
+
+			load_textures();
+			for (const std::shared_ptr<decoded_image> &image : _decoded_images)
+				image->job->wait();
+			if (!_textures_loaded)
+				load_textures();
+		}
+
 #if RESHADE_GUI
 		// Re-open last file in code editor after a reload
 		if (_show_code_editor && !_editor_file.empty())
@@ -1072,94 +2139,24 @@ void reshade::runtime::update_and_render_effects()
 	{
 		return; // Cannot render while effects are still being loaded
 	}
-	else if (!_reload_compile_queue.empty())
+	else if (!_reload_compile_queue.empty() && compile_queued_effects())
 	{
-		// Pop an effect from the queue
-		const size_t effect_index = _reload_compile_queue.back();
-		_reload_compile_queue.pop_back();
-		effect &effect = _effects[effect_index];
-
-		// Create textures now, since they are referenced when building samplers in the 'init_effect' call below
-		for (texture &tex : _textures)
-		{
-			if (tex.impl != nullptr || (
-				// Always create shared textures, since they may be in use by this effect already
-				tex.effect_index != effect_index && tex.shared.size() <= 1))
-				continue;
-
-			if (!init_texture(tex))
-			{
-				effect.errors += "Failed to create texture " + tex.unique_name;
-				effect.compiled = false;
-				break;
-			}
-		}
-
-		// Compile the effect with the back-end implementation (unless texture creation failed)
-		if (effect.compiled)
-			effect.compiled = init_effect(effect_index);
-
-		// De-duplicate error lines (D3DCompiler sometimes repeats the same error multiple times)
-		for (size_t line_offset = 0, next_line_offset;
-			(next_line_offset = effect.errors.find('\n', line_offset)) != std::string::npos; line_offset = next_line_offset + 1)
-		{
-			const std::string_view cur_line(effect.errors.c_str() + line_offset, next_line_offset - line_offset);
-
-			if (const size_t end_offset = effect.errors.find('\n', next_line_offset + 1);
-				end_offset != std::string::npos)
-			{
-				const std::string_view next_line(effect.errors.c_str() + next_line_offset + 1, end_offset - next_line_offset - 1);
-				if (cur_line == next_line)
-				{
-					effect.errors.erase(next_line_offset, end_offset - next_line_offset);
-					next_line_offset = line_offset - 1;
-				}
-			}
-
-			// Also remove D3DCompiler warnings about 'groupshared' specifier used in VS/PS modules
-			if (cur_line.find("X3579") != std::string_view::npos)
-			{
-				effect.errors.erase(line_offset, next_line_offset + 1 - line_offset);
-				next_line_offset = line_offset - 1;
-			}
-		}
-
-		if (!effect.compiled) // Something went wrong, do clean up
-		{
-			if (effect.errors.empty())
-				LOG(ERROR) << "Failed initializing " << effect.source_file << '.';
-			else
-				LOG(ERROR) << "Failed initializing " << effect.source_file << ":\n" << effect.errors;
-
-			// Destroy all textures belonging to this effect
-			for (texture &tex : _textures)
-				if (tex.effect_index == effect_index && tex.shared.size() <= 1)
-					destroy_texture(tex);
-			// Disable all techniques belonging to this effect
-			for (technique &tech : _techniques)
-				if (tech.effect_index == effect_index)
-					disable_technique(tech);
-
-			_last_shader_reload_successfull = false;
-		}
-
-		// An effect has changed, need to reload textures
-		_textures_loaded = false;
-
-#if RESHADE_GUI
-		// Update assembly in viewer after a reload
-		if (_show_code_viewer && !_viewer_entry_point.empty() && effect.compiled)
-		{
-			if (const auto assembly_it = effect.assembly.find(_viewer_entry_point);
-				assembly_it != effect.assembly.end())
-				_viewer.set_text(assembly_it->second);
-		}
-#endif
+		init_queued_effect();
 	}
-	else if (!_textures_loaded)
+	else if (_reload_compile_queue.empty() && !_textures_loaded)
 	{
 		// Now that all effects were compiled, load all textures
 		load_textures();
+
+		if (!_textures_loaded)
+			return; // Cannot render while textures are still being loaded
+	}
+
+	// The enabled effects are ready to render now, so load the remaining ones (which are needed to show up in the UI) in the background
+	if (_reload_skipped_effects && _reload_compile_queue.empty() && _textures_loaded)
+	{
+		_reload_skipped_effects = false;
+		load_skipped_effects();
 	}
 
 #ifdef NDEBUG
@@ -1378,6 +2375,9 @@ void reshade::runtime::update_and_render_effects()
 		}
 	}
 
+	// The application rendered a new frame, so the back buffer texture is outdated again
+	_backbuffer_copy_planner.begin_frame();
+
 	// Render all enabled techniques
 	for (technique &technique : _techniques)
 	{
@@ -1474,6 +2474,11 @@ void reshade::runtime::load_config()
 	config.get("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config.get("GENERAL", "PerformanceMode", _performance_mode);
 	config.get("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
+	config.get("GENERAL", "PrioritizeEnabledEffects", _effect_load_prioritization);
+	config.get("GENERAL", "WatchEffectFiles", _watch_effect_files);
+	config.get("GENERAL", "PrecompilePresets", _preset_precompilation);
+	config.get("GENERAL", "PrecompileCacheQuota", _preset_precompilation_cache_quota);
+	config.get("GENERAL", "ReloadInBackground", _reload_in_background);
 	config.get("GENERAL", "SkipLoadingDisabledEffects", _effect_load_skipping);
 	config.get("GENERAL", "TextureSearchPaths", _texture_search_paths);
 	config.get("GENERAL", "IntermediateCachePath", _intermediate_cache_path);
@@ -1515,6 +2520,11 @@ void reshade::runtime::save_config() const
 	config.set("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config.set("GENERAL", "PerformanceMode", _performance_mode);
 	config.set("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
+	config.set("GENERAL", "PrioritizeEnabledEffects", _effect_load_prioritization);
+	config.set("GENERAL", "WatchEffectFiles", _watch_effect_files);
+	config.set("GENERAL", "PrecompilePresets", _preset_precompilation);
+	config.set("GENERAL", "PrecompileCacheQuota", _preset_precompilation_cache_quota);
+	config.set("GENERAL", "ReloadInBackground", _reload_in_background);
 	config.set("GENERAL", "SkipLoadingDisabledEffects", _effect_load_skipping);
 	config.set("GENERAL", "TextureSearchPaths", _texture_search_paths);
 	config.set("GENERAL", "IntermediateCachePath", _intermediate_cache_path);
@@ -1562,25 +2572,43 @@ void reshade::runtime::load_current_preset()
 	// Recompile effects if preprocessor definitions have changed or running in performance mode (in which case all preset values are compile-time constants)
 	if (_reload_remaining_effects != 0) // ... unless this is the 'load_current_preset' call in 'update_and_render_effects'
 	{
-		if (_performance_mode || preset_preprocessor_definitions != _preset_preprocessor_definitions)
+		if (_performance_mode)
 		{
 			_preset_preprocessor_definitions = std::move(preset_preprocessor_definitions);
 			load_effects();
 			return; // Preset values are loaded in 'update_and_render_effects' during effect loading
 		}
 
-		if (std::find_if(technique_list.begin(), technique_list.end(), [this](const std::string &technique) {
+		if (preset_preprocessor_definitions != _preset_preprocessor_definitions)
+		{
+			_preset_preprocessor_definitions = std::move(preset_preprocessor_definitions);
+
+			// Only effects that use any of the modified definitions have to be compiled again (the preset is applied to them again once they were)
+			if (!reload_effects_with_modified_definitions())
+			{
+				load_effects();
+				return;
+			}
+		}
+
+		std::vector<size_t> skipped_effects;
+		if (std::find_if(technique_list.begin(), technique_list.end(), [this, &skipped_effects](const std::string &technique) {
 				if (const size_t at_pos = technique.find('@'); at_pos == std::string::npos)
 					return true;
 				else if (const auto it = std::find_if(_effects.begin(), _effects.end(),
 					[effect_name = static_cast<std::string_view>(technique).substr(at_pos + 1)](const effect &effect) { return effect_name == effect.source_file.filename().u8string(); }); it == _effects.end())
 					return true;
-				else
-					return it->skipped; }) != technique_list.end())
+				else if (it->skipped)
+					skipped_effects.push_back(it - _effects.begin());
+				return false; }) != technique_list.end())
 		{
 			load_effects();
 			return;
 		}
+
+		// Effects that were skipped are loaded on their own, without reloading all the others (their techniques are enabled when this is called again after they were added)
+		for (const size_t effect_index : skipped_effects)
+			load_effect_on_demand(effect_index, false);
 	}
 
 	if (sorted_technique_list.empty())
@@ -1764,6 +2792,10 @@ void reshade::runtime::save_current_preset() const
 }
 
 bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path, bool reversed)
+{
+	return find_next_preset(std::move(filter_path), reversed, _current_preset_path);
+}
+bool reshade::runtime::find_next_preset(std::filesystem::path filter_path, bool reversed, std::filesystem::path &next_preset_path) const
 {
 	std::error_code ec; // This is here to ignore file system errors below
 
@@ -1802,17 +2834,17 @@ bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path,
 	{
 		// Current preset was not in the container path, so just use the first or last file
 		if (reversed)
-			_current_preset_path = preset_paths.back();
+			next_preset_path = preset_paths.back();
 		else
-			_current_preset_path = preset_paths.front();
+			next_preset_path = preset_paths.front();
 	}
 	else
 	{
 		// Current preset was found in the container path, so use the file before or after it
 		if (auto it = std::next(preset_paths.begin(), current_preset_index); reversed)
-			_current_preset_path = it == preset_paths.begin() ? preset_paths.back() : *--it;
+			next_preset_path = it == preset_paths.begin() ? preset_paths.back() : *--it;
 		else
-			_current_preset_path = it == std::prev(preset_paths.end()) ? preset_paths.front() : *++it;
+			next_preset_path = it == std::prev(preset_paths.end()) ? preset_paths.front() : *++it;
 	}
 
 	return true;
@@ -1838,16 +2870,36 @@ void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool s
 
 	LOG(INFO) << "Saving screenshot to " << screenshot_path << " ...";
 
-	_screenshot_save_success = false; // Default to a save failure unless it is reported to succeed below
+	_last_screenshot_file = screenshot_path;
+	_last_screenshot_time = std::chrono::high_resolution_clock::now();
 
-	if (std::vector<uint8_t> data(_width * _height * 4); capture_screenshot(data.data()))
+	std::vector<uint8_t> data(_width * _height * 4);
+	if (!capture_screenshot(data.data()))
 	{
+		_screenshot_save_success = false;
+		LOG(ERROR) << "Failed to capture screenshot for " << screenshot_path << '!';
+		return;
+	}
+
+	// Preset is flushed to disk here, since the cache is only accessed from the render thread, so that the job can just copy it over to the new location
+	std::filesystem::path preset_path;
+	if (_screenshot_include_preset && should_save_preset && ini_file::flush_cache(_current_preset_path))
+		preset_path = _current_preset_path;
+
+	// Encoding and writing the image file takes a while, so do that in a background job instead of stalling the render thread
+	// The result is reported as soon as the job is done, until then assume it succeeds so that a previous failure is not reported for this screenshot
+	_screenshot_save_success = true;
+
+	_job_system.submit([this, data = std::move(data), screenshot_path = std::move(screenshot_path), preset_path = std::move(preset_path),
+		width = _width, height = _height, format = _screenshot_format, jpeg_quality = _screenshot_jpeg_quality, clear_alpha = _screenshot_clear_alpha]() mutable {
 		// Clear alpha channel
 		// The alpha channel doesn't need to be cleared if we're saving a JPEG, stbi ignores it
-		if (_screenshot_clear_alpha && _screenshot_format != 2)
-			for (uint32_t h = 0; h < _height; ++h)
-				for (uint32_t w = 0; w < _width; ++w)
-					data[(h * _width + w) * 4 + 3] = 0xFF;
+		if (clear_alpha && format != 2)
+			for (uint32_t h = 0; h < height; ++h)
+				for (uint32_t w = 0; w < width; ++w)
+					data[(h * width + w) * 4 + 3] = 0xFF;
+
+		bool save_success = false; // Default to a save failure unless it is reported to succeed below
 
 		if (FILE *file; _wfopen_s(&file, screenshot_path.c_str(), L"wb") == 0)
 		{
@@ -1855,35 +2907,33 @@ void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool s
 				fwrite(data, 1, size, static_cast<FILE *>(context));
 			};
 
-			switch (_screenshot_format)
+			switch (format)
 			{
 			case 0:
-				_screenshot_save_success = stbi_write_bmp_to_func(write_callback, file, _width, _height, 4, data.data()) != 0;
+				save_success = stbi_write_bmp_to_func(write_callback, file, width, height, 4, data.data()) != 0;
 				break;
 			case 1:
-				_screenshot_save_success = stbi_write_png_to_func(write_callback, file, _width, _height, 4, data.data(), 0) != 0;
+				save_success = stbi_write_png_to_func(write_callback, file, width, height, 4, data.data(), 0) != 0;
 				break;
 			case 2:
-				_screenshot_save_success = stbi_write_jpg_to_func(write_callback, file, _width, _height, 4, data.data(), _screenshot_jpeg_quality) != 0;
+				save_success = stbi_write_jpg_to_func(write_callback, file, width, height, 4, data.data(), jpeg_quality) != 0;
 				break;
 			}
 
 			fclose(file);
 		}
-	}
 
-	_last_screenshot_file = screenshot_path;
-	_last_screenshot_time = std::chrono::high_resolution_clock::now();
+		_screenshot_save_success = save_success;
 
-	if (!_screenshot_save_success)
-	{
-		LOG(ERROR) << "Failed to write screenshot to " << screenshot_path << '!';
-	}
-	else if (_screenshot_include_preset && should_save_preset && ini_file::flush_cache(_current_preset_path))
-	{
-		// Preset was flushed to disk, so can just copy it over to the new location
-		std::error_code ec; std::filesystem::copy_file(_current_preset_path, screenshot_path.replace_extension(L".ini"), std::filesystem::copy_options::overwrite_existing, ec);
-	}
+		if (!save_success)
+		{
+			LOG(ERROR) << "Failed to write screenshot to " << screenshot_path << '!';
+		}
+		else if (!preset_path.empty())
+		{
+			std::error_code ec; std::filesystem::copy_file(preset_path, screenshot_path.replace_extension(L".ini"), std::filesystem::copy_options::overwrite_existing, ec);
+		}
+	}, job_system::priority::normal);
 }
 
 static inline bool force_floating_point_value(const reshadefx::type &type, uint32_t renderer_id)
@@ -1990,6 +3040,10 @@ void reshade::runtime::set_uniform_value(uniform &variable, const uint8_t *data,
 	auto &data_storage = _effects[variable.effect_index].uniform_data_storage;
 	assert(variable.offset + size <= data_storage.size());
 
+	// Variables updated every frame are uploaded anyway, everything else is only uploaded again after a change
+	if (variable.offset < _effects[variable.effect_index].module.per_frame_uniform_offset)
+		_effects[variable.effect_index].uniform_data_dirty = true;
+
 	const size_t array_length = (variable.type.is_array() ? variable.type.array_length : 1);
 	assert(base_index < array_length);
 
@@ -2087,6 +3141,7 @@ void reshade::runtime::reset_uniform_value(uniform &variable)
 	if (!variable.has_initializer_value)
 	{
 		std::memset(_effects[variable.effect_index].uniform_data_storage.data() + variable.offset, 0, variable.size);
+		_effects[variable.effect_index].uniform_data_dirty = true;
 		return;
 	}
 
@@ -11,6 +11,8 @@
 #include <chrono>
 #include <functional>
 #include <filesystem>
+#include "job_system.hpp"
+#include "effect_pass_analysis.hpp"
 
 #if RESHADE_GUI
 #include "imgui_editor.hpp"
@@ -24,6 +26,9 @@ extern volatile long g_network_traffic;
 namespace reshade
 {
 	class ini_file; // Forward declarations to avoid excessive #include
+	class file_index;
+	class file_watcher;
+	struct content_hash;
 	struct effect;
 	struct uniform;
 	struct texture;
@@ -179,7 +184,19 @@ namespace reshade
 		/// </summary>
 		void load_effects();
 		/// <summary>
+		/// Compile the generated shader code of an entry point to the binary format the back-end creates shader objects from.
+		/// This is called on worker threads (for all entry points of all effects in the compile queue in parallel) before 'init_effect', so it may only read the effect and runtime state that does not change while effects are compiled.
+		/// Back-ends whose driver compiles shaders while creating the shader objects do not need to implement this.
+		/// </summary>
+		/// <param name="effect">The effect the entry point belongs to.</param>
+		/// <param name="entry_point">The entry point to compile.</param>
+		/// <param name="cso">Receives the compiled shader binary.</param>
+		/// <param name="assembly">Receives the disassembly of the compiled shader.</param>
+		/// <param name="errors">Receives any errors and warnings that occurred during compilation.</param>
+		virtual bool compile_entry_point(const effect &effect, const reshadefx::entry_point &entry_point, std::vector<char> &cso, std::string &assembly, std::string &errors) { return true; }
+		/// <summary>
 		/// Initialize resources for the effect and load the effect module.
+		/// This is called on the render thread, after all entry points were compiled with 'compile_entry_point'.
 		/// </summary>
 		/// <param name="effect_index">The ID of the effect.</param>
 		virtual bool init_effect(size_t effect_index) = 0;
@@ -196,16 +213,34 @@ namespace reshade
 		/// <summary>
 		/// Load compiled shader data from the cache.
 		/// </summary>
-		bool load_effect_cache(const std::filesystem::path &source_file, const size_t hash, std::string &source) const;
-		bool load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, std::vector<char> &cso, std::string &dasm) const;
+		bool load_effect_cache(const std::filesystem::path &source_file, const content_hash &hash, const file_index &files, std::string &source, std::vector<std::filesystem::path> &included_files) const;
+		bool load_effect_cache(const std::filesystem::path &source_file, const content_hash &hash, reshadefx::module &module, std::string &warnings) const;
+		bool load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const content_hash &hash, std::vector<char> &cso, std::string &dasm) const;
 		/// <summary>
 		/// Save compiled shader data to the cache.
+		/// Shader binaries are written in a background job, since they are created on the render thread.
+		/// </summary>
+		bool save_effect_cache(const std::filesystem::path &source_file, const content_hash &hash, const file_index &files, const std::string &source, const std::vector<std::filesystem::path> &included_files) const;
+		bool save_effect_cache(const std::filesystem::path &source_file, const content_hash &hash, const reshadefx::module &module, const std::string &warnings) const;
+		void save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const content_hash &hash, const std::vector<char> &cso, const std::string &dasm);
+
+		/// <summary>
+		/// Start compiling the entry points of all effects in the compile queue on worker threads (unless that was done already).
+		/// </summary>
+		/// <returns><c>true</c> if the entry points of the effect at the back of the queue have finished compiling, so that it can be initialized, <c>false</c> otherwise.</returns>
+		bool compile_queued_effects();
+		/// <summary>
+		/// Remove the effect at the back of the compile queue and create its textures and API objects from the compiled entry points.
 		/// </summary>
-		bool save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const std::string &source) const;
-		bool save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, const std::vector<char> &cso, const std::string &dasm) const;
+		void init_queued_effect();
 
+		/// <summary>
+		/// Share storage between render targets that are only used temporarily within a single technique and have matching descriptions.
+		/// </summary>
+		void alias_transient_textures();
 		/// <summary>
 		/// Load image files and update textures with image data.
+		/// The image files are decoded in background jobs, so this has to be called every frame until '_textures_loaded' is set.
 		/// </summary>
 		void load_textures();
 
@@ -253,6 +288,9 @@ namespace reshade
 		std::vector<texture> _textures;
 		std::vector<technique> _techniques;
 
+		// Decides before which passes the back buffer texture has to be updated (see 'technique::pass_accesses')
+		reshadefx::back_buffer_copy_planner _backbuffer_copy_planner;
+
 	private:
 		/// <summary>
 		/// Compare current version against the latest published one.
@@ -266,6 +304,79 @@ namespace reshade
 		/// </summary>
 		bool is_loading() const { return _reload_remaining_effects != std::numeric_limits<size_t>::max(); }
 
+		struct background_reload;
+		struct on_demand_load;
+
+		/// <summary>
+		/// Same as the protected overload, but adds the effect to the specified reload in the background instead of the current effects if one is passed.
+		/// </summary>
+		bool load_effect(const std::filesystem::path &source_file, const reshade::ini_file &preset, size_t &effect_index, bool preprocess_required, background_reload *reload, const file_index &files);
+		/// <summary>
+		/// Take a new snapshot of the files in the effect and texture search paths, which is used for all file lookups until the next one.
+		/// </summary>
+		void update_file_index();
+		/// <summary>
+		/// Start compiling the entry points of an effect that was loaded in the background on worker threads, if the preset enables any of its techniques.
+		/// </summary>
+		void compile_background_effect(background_reload &reload, size_t effect_index, const reshade::ini_file &preset);
+		/// <summary>
+		/// Cancel a reload that is running in the background (and any effects that are loaded on demand) and throw away what it has loaded so far.
+		/// </summary>
+		void discard_background_reload();
+		/// <summary>
+		/// Replace the current effects with those that were loaded in the background.
+		/// </summary>
+		void finish_background_reload();
+		/// <summary>
+		/// Wait for all jobs of a reload in the background to finish (or skip them, if it was cancelled).
+		/// </summary>
+		void wait_for_background_reload(background_reload &reload);
+		/// <summary>
+		/// Check whether all jobs of a reload in the background have finished, including the compilation of the entry points they queued, without waiting for them.
+		/// </summary>
+		static bool is_background_reload_done(const background_reload &reload);
+		/// <summary>
+		/// Load an effect that was skipped during the last reload on a worker thread, without touching any of the other effects.
+		/// If the effect is loaded already, the current version keeps rendering until it is replaced with the new one.
+		/// </summary>
+		/// <param name="effect_index">The ID of the effect.</param>
+		/// <param name="enable_techniques">Set to <c>true</c> to enable all its techniques once it is loaded (instead of only those in the preset).</param>
+		/// <param name="preprocess_required">Set to <c>true</c> to ignore the preprocessed source in the cache.</param>
+		/// <param name="restart">Set to <c>true</c> to start over if the effect is being loaded already, because what it depends on was modified since.</param>
+		void load_effect_on_demand(size_t effect_index, bool enable_techniques, bool preprocess_required = false, bool restart = false);
+		/// <summary>
+		/// Load all effects that were skipped during the last reload together on worker threads at low priority, so that they show up in the UI without reloading the ones that render already.
+		/// </summary>
+		void load_skipped_effects();
+		/// <summary>
+		/// Submit the jobs that load the effects of an on-demand load and add it to the pending ones.
+		/// </summary>
+		/// <param name="load">The effects to load, with the priority and compile options of the reload set up already.</param>
+		/// <param name="preprocess_required">Set to <c>true</c> to ignore the preprocessed source in the cache.</param>
+		void start_on_demand_load(std::unique_ptr<on_demand_load> load, bool preprocess_required);
+		/// <summary>
+		/// Add the effects that finished loading on demand to the current effects, together with their textures and techniques.
+		/// </summary>
+		void finish_on_demand_loads();
+		/// <summary>
+		/// Start compiling the effects the next and previous preset in the preset directory enable into the cache on worker threads, so that switching to them later finds everything there already.
+		/// This uses a single low priority job at a time and stops once the cache exceeds its quota.
+		/// </summary>
+		void precompile_presets();
+		/// <summary>
+		/// Cancel precompiling effects for other presets and wait for the job that is currently running.
+		/// </summary>
+		void discard_preset_precompilation();
+		/// <summary>
+		/// Recompile only the effects that reference any of the global or preset preprocessor definitions that were modified since they were loaded, instead of all effects.
+		/// </summary>
+		/// <returns><c>false</c> if effects are being loaded at the moment, in which case all of them have to be reloaded instead, <c>true</c> otherwise.</returns>
+		bool reload_effects_with_modified_definitions();
+		/// <summary>
+		/// Recompile all effects whose source file or any of the files they include were modified since the last check.
+		/// </summary>
+		void reload_modified_effects();
+
 		/// <summary>
 		/// Enable a technique so it is rendered.
 		/// </summary>
@@ -298,6 +409,14 @@ namespace reshade
 		/// <param name="reversed">Set to <c>true</c> to switch to previous instead of next preset.</param>
 		/// <returns><c>true</c> if there was another preset to switch to, <c>false</c> if not and therefore no changes were made.</returns>
 		bool switch_to_next_preset(std::filesystem::path filter_path, bool reversed = false);
+		/// <summary>
+		/// Find next preset is the directory, without switching to it.
+		/// </summary>
+		/// <param name="filter_path">Directory base to search in and/or an optional filter to skip preset files.</param>
+		/// <param name="reversed">Set to <c>true</c> to find the previous instead of next preset.</param>
+		/// <param name="next_preset_path">Receives the path to the preset that was found.</param>
+		/// <returns><c>true</c> if there was another preset, <c>false</c> if not and therefore no changes were made.</returns>
+		bool find_next_preset(std::filesystem::path filter_path, bool reversed, std::filesystem::path &next_preset_path) const;
 
 		/// <summary>
 		/// Create a copy of the current frame and write it to an image file on disk.
@@ -323,10 +442,54 @@ namespace reshade
 		std::vector<std::function<void(const ini_file &)>> _load_config_callables;
 
 		// === Effect Loading ===
+		struct decoded_image
+		{
+			std::string texture_name;
+			std::filesystem::path source_path;
+			// Image data in RGBA8 format resized to the texture dimensions, or empty if the image file could not be decoded
+			std::vector<uint8_t> data;
+			job_system::job_handle job;
+		};
+		struct entry_point_compilation
+		{
+			std::string entry_point_name;
+			bool success = false;
+			std::vector<char> cso;
+			std::string assembly;
+			std::string errors;
+			job_system::job_handle job;
+		};
+		struct background_reload
+		{
+			// A complete set of effects that is built while the current one keeps rendering and replaces it once all effects were loaded
+			std::vector<effect> effects;
+			std::vector<texture> textures;
+			std::vector<technique> techniques;
+			std::atomic<size_t> remaining_effects = 0;
+			std::vector<job_system::job_handle> jobs;
+			job_system::cancellation_token cancellation;
+			job_system::priority priority = job_system::priority::normal;
+			// Set when only some effects are loaded into this set on demand, which are never skipped
+			bool on_demand = false;
+			// Set to compile all entry points ahead of time, instead of only those of the techniques the preset enables
+			bool compile_all = false;
+			// Set when an effect is only compiled to fill the cache for another preset, which uses these preprocessor definitions instead of the current ones
+			bool precompile = false;
+			std::vector<std::string> preset_preprocessor_definitions;
+			// Entry points of the effects the preset enables, which are compiled ahead of time so that only the API objects are left to create once the set is swapped in
+			std::unordered_map<size_t, std::vector<std::shared_ptr<entry_point_compilation>>> entry_point_compilations;
+		};
+
 		bool _no_debug_info = 0;
 		bool _no_reload_on_init = false;
 		bool _effect_load_skipping = false;
+		bool _reload_in_background = false;
+		bool _effect_load_prioritization = false;
+		bool _watch_effect_files = false;
+		bool _preset_precompilation = false;
+		unsigned int _preset_precompilation_cache_quota = 512; // MiB
 		bool _load_option_disable_skipping = false;
+		bool _reload_skipped_effects = false;
 		std::atomic<int> _last_shader_reload_successfull = true;
 		bool _last_texture_reload_successfull = true;
 		bool _textures_loaded = false;
@@ -335,19 +498,43 @@ namespace reshade
 		std::vector<size_t> _reload_compile_queue;
 		std::atomic<size_t> _reload_remaining_effects = 0;
 		std::mutex _reload_mutex;
-		std::vector<std::thread> _worker_threads;
+		std::vector<job_system::job_handle> _reload_jobs;
+		job_system::cancellation_token _reload_cancellation;
 		std::vector<std::string> _global_preprocessor_definitions;
 		std::vector<std::string> _preset_preprocessor_definitions;
 		std::vector<std::filesystem::path> _effect_search_paths;
 		std::vector<std::filesystem::path> _texture_search_paths;
 		std::filesystem::path _intermediate_cache_path;
 		std::chrono::high_resolution_clock::time_point _last_reload_time;
+		std::chrono::high_resolution_clock::time_point _last_reload_start_time;
+		std::unordered_map<std::filesystem::path::string_type, std::chrono::high_resolution_clock::duration> _effect_load_durations;
+		std::vector<std::shared_ptr<decoded_image>> _decoded_images;
+		std::unordered_map<size_t, std::vector<std::shared_ptr<entry_point_compilation>>> _entry_point_compilations;
+		std::unique_ptr<background_reload> _background_reload;
+		// Jobs keep a reference to the snapshot they started with, so it can be replaced while they are still running
+		std::shared_ptr<const file_index> _file_index;
+		struct on_demand_load
+		{
+			std::vector<size_t> effect_indices;
+			// Effects to enable all techniques of once they were added to the current effects
+			std::vector<size_t> enabled_effect_indices;
+			// Set for the batch of effects that were skipped during the last reload (see 'load_skipped_effects')
+			bool in_background = false;
+			// Starts out with a copy of the current textures, so that the effects can share them just like during a full reload
+			background_reload reload;
+		};
+		std::vector<std::unique_ptr<on_demand_load>> _on_demand_loads;
+		std::unique_ptr<file_watcher> _file_watcher;
+		// The preset the effects of the next and previous preset were precompiled for (cleared to start over)
+		std::filesystem::path _precompiled_preset_path;
+		std::vector<job_system::job_handle> _precompilation_jobs;
+		job_system::cancellation_token _precompilation_cancellation;
 
 		// === Screenshots ===
 		bool _should_save_screenshot = false;
 		bool _screenshot_save_ui = false;
 		bool _screenshot_save_before = false;
-		bool _screenshot_save_success = true;
+		std::atomic<bool> _screenshot_save_success = true;
 		bool _screenshot_include_preset = false;
 		bool _screenshot_clear_alpha = true;
 		unsigned int _screenshot_format = 1;
@@ -448,5 +635,9 @@ namespace reshade
 		std::filesystem::path _editor_file;
 		std::string _viewer_entry_point;
 #endif
+
+		// === Jobs ===
+		// Declared last, so that it is destroyed first and all jobs are done before any of the data they access is destroyed
+		job_system _job_system;
 	};
 }
@@ -15,6 +15,10 @@ reshade::ini_file::ini_file(const std::filesystem::path &path)
 {
 	load();
 }
+reshade::ini_file::ini_file(const ini_file &other)
+	: _path(other._path), _modified_at(other._modified_at), _sections(other._sections)
+{
+}
 reshade::ini_file::~ini_file()
 {
 	save();
@@ -36,6 +36,11 @@ namespace reshade
 		/// </summary>
 		/// <param name="path">The path to the INI file to access.</param>
 		explicit ini_file(const std::filesystem::path &path);
+		/// <summary>
+		/// Create a copy of the contents of another INI file, which does not save its pending modifications again when it is destroyed.
+		/// This can be read on other threads while the original keeps being modified.
+		/// </summary>
+		ini_file(const ini_file &other);
 		~ini_file();
 
 		/// <summary>
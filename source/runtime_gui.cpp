@@ -1282,6 +1282,11 @@ void reshade::runtime::draw_gui_settings()
 		modified |= widgets::path_list("Texture search paths", _texture_search_paths, _file_selection_path, g_reshade_base_path);
 
 		modified |= ImGui::Checkbox("Load only enabled effects", &_effect_load_skipping);
+		if (!_effect_load_skipping)
+			modified |= ImGui::Checkbox("Load enabled effects first", &_effect_load_prioritization);
+		modified |= ImGui::Checkbox("Keep rendering while reloading effects", &_reload_in_background);
+		modified |= ImGui::Checkbox("Reload effects when their files are modified", &_watch_effect_files);
+		modified |= ImGui::Checkbox("Precompile effects of the next and previous preset", &_preset_precompilation);
 
 		if (ImGui::Button("Clear effect cache", ImVec2(ImGui::CalcItemWidth(), 0)))
 		{
@@ -1294,7 +1299,7 @@ void reshade::runtime::draw_gui_settings()
 
 				const std::filesystem::path filename = entry.path().filename();
 				const std::filesystem::path extension = entry.path().extension();
-				if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != ".i" && extension != ".cso" && extension != ".asm"))
+				if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != ".i" && extension != ".module" && extension != ".cso" && extension != ".asm"))
 					continue;
 
 				DeleteFileW(entry.path().c_str());
@@ -1587,7 +1592,9 @@ void reshade::runtime::draw_gui_statistics()
 			if (!technique.enabled)
 				continue;
 
-			if (technique.passes.size() > 1)
+			if (const size_t num_culled_passes = std::count(technique.culled_passes.begin(), technique.culled_passes.end(), true); num_culled_passes != 0)
+				ImGui::Text("%s (%zu passes, %zu culled)", technique.name.c_str(), technique.passes.size(), num_culled_passes);
+			else if (technique.passes.size() > 1)
 				ImGui::Text("%s (%zu passes)", technique.name.c_str(), technique.passes.size());
 			else
 				ImGui::TextUnformatted(technique.name.c_str());
@@ -1619,9 +1626,44 @@ void reshade::runtime::draw_gui_statistics()
 
 			// GPU timings are not available for all APIs
 			if (technique.average_gpu_duration != 0)
+			{
 				ImGui::Text("%*.3f ms GPU", gpu_digits + 4, technique.average_gpu_duration * 1e-6f);
-			else
-				ImGui::NewLine();
+				ImGui::SameLine();
+			}
+
+			// Show the static cost estimate next to it, so that it can be compared against the measured duration
+			reshadefx::pass_cost technique_cost;
+			for (size_t pass_index = 0; pass_index < technique.pass_costs.size(); ++pass_index)
+			{
+				if (technique.culled_passes[pass_index])
+					continue;
+
+				technique_cost.texture_fetches += technique.pass_costs[pass_index].texture_fetches;
+				technique_cost.alu_operations += technique.pass_costs[pass_index].alu_operations;
+				technique_cost.render_target_bandwidth += technique.pass_costs[pass_index].render_target_bandwidth;
+				technique_cost.invocation_cost.has_unbounded_loops |= technique.pass_costs[pass_index].invocation_cost.has_unbounded_loops;
+			}
+
+			ImGui::TextDisabled("~%.1fM fetches, %.1fM ops, %.1f MB%s", technique_cost.texture_fetches * 1e-6f, technique_cost.alu_operations * 1e-6f, technique_cost.render_target_bandwidth * 1e-6f,
+				technique_cost.invocation_cost.has_unbounded_loops ? "+" : "");
+
+			if (ImGui::IsItemHovered())
+			{
+				ImGui::BeginTooltip();
+				ImGui::Text("Video memory: %.3f MiB (%.3f MiB textures, %.3f MiB back buffer and depth buffer copies, %zu bytes uniforms)",
+					technique.memory_footprint.total() / (1024.0f * 1024.0f),
+					technique.memory_footprint.texture_memory_size / (1024.0f * 1024.0f),
+					technique.memory_footprint.buffer_copy_memory_size / (1024.0f * 1024.0f),
+					technique.memory_footprint.uniform_memory_size);
+				for (size_t pass_index = 0; pass_index < technique.pass_costs.size(); ++pass_index)
+				{
+					const reshadefx::pass_cost &cost = technique.pass_costs[pass_index];
+					ImGui::Text("Pass %zu: %u texture fetches and %u ALU operations per %s (%llu), %.1f MB render target bandwidth%s", pass_index,
+						cost.invocation_cost.texture_fetches, cost.invocation_cost.alu_operations, technique.passes[pass_index].cs_entry_point.empty() ? "pixel" : "thread group", cost.invocations,
+						cost.render_target_bandwidth * 1e-6f, technique.culled_passes[pass_index] ? " (culled)" : cost.invocation_cost.has_unbounded_loops ? " (loops with unknown iteration count counted once)" : "");
+				}
+				ImGui::EndTooltip();
+			}
 		}
 
 		ImGui::EndGroup();
@@ -1633,10 +1675,6 @@ void reshade::runtime::draw_gui_statistics()
 			"unknown",
 			"R8", "R16F", "R32F", "RG8", "RG16", "RG16F", "RG32F", "RGBA8", "RGBA16", "RGBA16F", "RGBA32F", "RGB10A2"
 		};
-		const unsigned int pixel_sizes[] = {
-			0,
-			1 /*R8*/, 2 /*R16F*/, 4 /*R32F*/, 2 /*RG8*/, 4 /*RG16*/, 4 /*RG16F*/, 8 /*RG32F*/, 4 /*RGBA8*/, 8 /*RGBA16*/, 8 /*RGBA16F*/, 16 /*RGBA32F*/, 4 /*RGB10A2*/
-		};
 
 		static_assert(std::size(texture_formats) - 1 == static_cast<size_t>(reshadefx::texture_format::rgb10a2));
 
@@ -1658,9 +1696,7 @@ void reshade::runtime::draw_gui_statistics()
 			ImGui::PushID(texture_index);
 			ImGui::BeginGroup();
 
-			uint32_t memory_size = 0;
-			for (uint32_t level = 0, width = tex.width, height = tex.height; level < tex.levels; ++level, width /= 2, height /= 2)
-				memory_size += width * height * pixel_sizes[static_cast<unsigned int>(tex.format)];
+			const uint32_t memory_size = static_cast<uint32_t>(reshadefx::texture_memory_size(tex));
 
 			post_processing_memory_size += memory_size;
 
@@ -1830,6 +1866,51 @@ void reshade::runtime::draw_gui_statistics()
 		}
 
 		ImGui::Text("Total memory usage: %ld.%03ld %s", memory_view.quot, memory_view.rem, memory_size_unit);
+
+		uint32_t aliased_memory_size = 0;
+		for (const effect &effect : _effects)
+			if (effect.rendering)
+				aliased_memory_size += static_cast<uint32_t>(effect.aliased_texture_memory_size);
+
+		if (aliased_memory_size != 0)
+		{
+			if (aliased_memory_size >= 1024 * 1024) {
+				memory_view = std::ldiv(aliased_memory_size, 1024 * 1024);
+				memory_view.rem /= 1000;
+				memory_size_unit = "MiB";
+			}
+			else {
+				memory_view = std::ldiv(aliased_memory_size, 1024);
+				memory_size_unit = "KiB";
+			}
+
+			ImGui::Text("Saved by sharing transient render targets: %ld.%03ld %s", memory_view.quot, memory_view.rem, memory_size_unit);
+		}
+
+		// Unlike the texture list above, this includes the back buffer and depth buffer copies and uniform buffers, with shared resources split between the effects using them
+		reshadefx::memory_footprint total_footprint;
+		for (const effect &effect : _effects)
+		{
+			if (!effect.rendering)
+				continue;
+
+			total_footprint.texture_memory_size += effect.memory_footprint.texture_memory_size;
+			total_footprint.buffer_copy_memory_size += effect.memory_footprint.buffer_copy_memory_size;
+			total_footprint.uniform_memory_size += effect.memory_footprint.uniform_memory_size;
+		}
+
+		if (total_footprint.total() != 0)
+		{
+			ImGui::Text("Video memory of active effects: %.3f MiB (%.3f MiB textures, %.3f MiB back buffer and depth buffer copies, %zu bytes uniforms)",
+				total_footprint.total() / (1024.0f * 1024.0f),
+				total_footprint.texture_memory_size / (1024.0f * 1024.0f),
+				total_footprint.buffer_copy_memory_size / (1024.0f * 1024.0f),
+				total_footprint.uniform_memory_size);
+
+			for (const effect &effect : _effects)
+				if (effect.rendering && effect.memory_footprint.total() != 0)
+					ImGui::BulletText("%s: %.3f MiB", effect.source_file.filename().u8string().c_str(), effect.memory_footprint.total() / (1024.0f * 1024.0f));
+		}
 	}
 }
 void reshade::runtime::draw_gui_log()
@@ -5615,7 +5696,8 @@ void reshade::runtime::draw_variable_editor()
 	}
 	else if (_was_preprocessor_popup_edited)
 	{
-		load_effects();
+		if (!reload_effects_with_modified_definitions())
+			load_effects();
 		_was_preprocessor_popup_edited = false;
 	}
 
@@ -6282,6 +6364,32 @@ void reshade::runtime::draw_technique_editor()
 		ImGui::PopID();
 	}
 
+	// Skipped effects can be loaded on their own by enabling them here, which enables all their techniques once they are loaded
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const reshade::effect &effect = _effects[effect_index];
+		if (!effect.skipped)
+			continue;
+
+		const bool loading = std::any_of(_on_demand_loads.begin(), _on_demand_loads.end(),
+			[effect_index](const std::unique_ptr<on_demand_load> &load) {
+				return std::find(load->effect_indices.begin(), load->effect_indices.end(), effect_index) != load->effect_indices.end(); });
+
+		ImGui::PushID(effect.source_file.u8string().c_str());
+		ImGui::PushItemFlag(ImGuiItemFlags_Disabled, loading || is_loading());
+		ImGui::PushStyleColor(ImGuiCol_Text, _imgui_context->Style.Colors[ImGuiCol_TextDisabled]);
+
+		const std::string label = '[' + effect.source_file.filename().u8string() + ']' + (loading ? " loading ..." : " not loaded");
+
+		if (bool status = loading;
+			ImGui::Checkbox(label.c_str(), &status) && status)
+			load_effect_on_demand(effect_index, true);
+
+		ImGui::PopStyleColor();
+		ImGui::PopItemFlag();
+		ImGui::PopID();
+	}
+
 	// Move the selected technique to the position of the mouse in the list
 	if (_selected_technique < _techniques.size() && ImGui::IsMouseDragging(ImGuiMouseButton_Left))
 	{
@@ -5,7 +5,9 @@
 
 #pragma once
 
+#include "content_hash.hpp"
 #include "effect_module.hpp"
+#include "effect_pass_analysis.hpp"
 
 namespace reshade
 {
@@ -167,6 +169,12 @@ namespace reshade
 
 		void *impl = nullptr;
 		size_t effect_index = std::numeric_limits<size_t>::max();
+		std::vector<reshadefx::pass_access> pass_accesses;
+		// Static estimate of the work each pass does, to compare against the measured durations
+		std::vector<reshadefx::pass_cost> pass_costs;
+		reshadefx::memory_footprint memory_footprint;
+		// Flags for passes that are skipped during rendering, since nothing uses their output
+		std::vector<bool> culled_passes;
 		bool hidden = false;
 		bool enabled = false;
 		int64_t time_left = 0;
@@ -181,15 +189,25 @@ namespace reshade
 		bool skipped = false;
 		bool compiled = false;
 		bool preprocessed = false;
+		// Set when a uniform variable outside the per-frame range was modified, so the uniform data needs to be uploaded again
+		bool uniform_data_dirty = true;
 		std::string errors;
 		std::string preamble;
 		reshadefx::module module;
-		size_t source_hash = 0;
+		content_hash source_hash;
 		std::filesystem::path source_file;
 		std::vector<std::filesystem::path> included_files;
 		std::vector<std::pair<std::string, std::string>> definitions;
+		// Global and preset preprocessor definitions the effect was preprocessed with, together with the names of all macros it referenced, to figure out whether modifying a definition affects it
+		std::vector<std::string> preprocessor_definitions;
+		std::vector<std::string> referenced_macros;
 		std::unordered_map<std::string, std::string> assembly;
+		// Binaries of all entry points, compiled on worker threads before 'init_effect' is called and released again afterwards
+		std::unordered_map<std::string, std::vector<char>> compiled_entry_points;
 		std::vector<uniform> uniforms;
 		std::vector<unsigned char> uniform_data_storage;
+		// Amount of texture memory saved by transient render targets of this effect sharing storage with others
+		size_t aliased_texture_memory_size = 0;
+		reshadefx::memory_footprint memory_footprint;
 	};
 }
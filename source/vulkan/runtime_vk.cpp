@@ -65,58 +65,60 @@ namespace reshade::vulkan
 	const uint32_t MAX_IMAGE_DESCRIPTOR_SETS = 128; // TODO: Check if these limits are enough
 	const uint32_t MAX_EFFECT_DESCRIPTOR_SETS = 50 * 2 * 4; // 50 resources, 4 passes
 
+	VkAccessFlags layout_to_access(VkImageLayout layout)
+	{
+		switch (layout)
+		{
+		default:
+		case VK_IMAGE_LAYOUT_UNDEFINED:
+			return 0; // No prending writes to flush
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			return VK_ACCESS_TRANSFER_READ_BIT;
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+			return VK_ACCESS_TRANSFER_WRITE_BIT;
+		case VK_IMAGE_LAYOUT_GENERAL:
+			return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+			return VK_ACCESS_SHADER_READ_BIT;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+			return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL:
+			return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+			return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		}
+	}
+	VkPipelineStageFlags layout_to_stage(VkImageLayout layout)
+	{
+		switch (layout)
+		{
+		default:
+		case VK_IMAGE_LAYOUT_UNDEFINED:
+			return VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT; // Do not wait on any previous stage
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+			return VK_PIPELINE_STAGE_TRANSFER_BIT;
+		case VK_IMAGE_LAYOUT_GENERAL:
+			return VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+			return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL:
+			return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: // Can use color attachment output here, since the semaphores wait on that stage
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+			return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		}
+	}
+
 	void transition_layout(const VkLayerDispatchTable &vk, VkCommandBuffer cmd_list, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
 		const VkImageSubresourceRange &subresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS })
 	{
-		const auto layout_to_access = [](VkImageLayout layout) -> VkAccessFlags {
-			switch (layout)
-			{
-			default:
-			case VK_IMAGE_LAYOUT_UNDEFINED:
-				return 0; // No prending writes to flush
-			case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-				return VK_ACCESS_TRANSFER_READ_BIT;
-			case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-				return VK_ACCESS_TRANSFER_WRITE_BIT;
-			case VK_IMAGE_LAYOUT_GENERAL:
-				return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
-			case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-				return VK_ACCESS_SHADER_READ_BIT;
-			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
-				return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-			case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL:
-			case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL:
-				return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-			case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
-			case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-				return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			}
-		};
-		const auto layout_to_stage = [](VkImageLayout layout) -> VkPipelineStageFlags {
-			switch (layout)
-			{
-			default:
-			case VK_IMAGE_LAYOUT_UNDEFINED:
-				return VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT; // Do not wait on any previous stage
-			case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-			case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-				return VK_PIPELINE_STAGE_TRANSFER_BIT;
-			case VK_IMAGE_LAYOUT_GENERAL:
-				return VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-			case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-				return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
-			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-			case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL:
-			case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL:
-				return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-			case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: // Can use color attachment output here, since the semaphores wait on that stage
-			case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-				return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			}
-		};
-
 		VkImageMemoryBarrier transition { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
 		transition.srcAccessMask = layout_to_access(old_layout);
 		transition.dstAccessMask = layout_to_access(new_layout);
@@ -610,6 +612,11 @@ void reshade::vulkan::runtime_vk::on_present(VkQueue queue, uint32_t swapchain_i
 #endif
 
 	update_and_render_effects();
+
+	// Put all textures back into shader read-only layout, which is what everything outside of effect rendering expects them to be in
+	if (begin_command_buffer())
+		apply_texture_barriers(_texture_barrier_planner.finish());
+
 	runtime::on_present();
 
 #ifndef NDEBUG
@@ -781,6 +788,7 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 	effect &effect = _effects[index];
 
 	// Load shader modules
+	// The driver compiles these during pipeline creation further below, which happens on the render thread instead of in a job and cannot be interrupted, so it is not cancellable
 	std::unordered_map<std::string, VkShaderModule> entry_points;
 	std::vector<vk_handle<VK_OBJECT_TYPE_SHADER_MODULE>> shader_modules;
 
@@ -1255,8 +1263,9 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 					attachment_desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 					attachment_desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 					attachment_desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-					attachment_desc.initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-					attachment_desc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+					// Render targets are transitioned before and after the render pass as needed (see 'apply_texture_barriers')
+					attachment_desc.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+					attachment_desc.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 				}
 
 				if (pass_info.clear_render_targets)
@@ -1846,6 +1855,57 @@ void reshade::vulkan::runtime_vk::generate_mipmaps(const vulkan_tex_data *impl)
 	}
 }
 
+void reshade::vulkan::runtime_vk::apply_texture_barriers(const std::vector<reshadefx::texture_barrier> &barriers)
+{
+	const auto usage_to_layout = [](reshadefx::texture_usage usage) -> VkImageLayout {
+		switch (usage)
+		{
+		default:
+		case reshadefx::texture_usage::shader_resource:
+			return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		case reshadefx::texture_usage::render_target:
+			return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		case reshadefx::texture_usage::unordered_access:
+			return VK_IMAGE_LAYOUT_GENERAL;
+		}
+	};
+
+	VkPipelineStageFlags src_stage_mask = 0;
+	VkPipelineStageFlags dst_stage_mask = 0;
+	std::vector<VkImageMemoryBarrier> transitions;
+	transitions.reserve(barriers.size());
+
+	for (const reshadefx::texture_barrier &barrier : barriers)
+	{
+		// Textures with a semantic (like the back buffer) are not managed by the barrier planner
+		const auto texture = std::find_if(_textures.begin(), _textures.end(),
+			[&barrier](const auto &item) { return item.unique_name == barrier.texture_name && item.impl != nullptr && item.semantic.empty(); });
+		if (texture == _textures.end())
+			continue;
+
+		const VkImageLayout old_layout = usage_to_layout(barrier.old_usage);
+		const VkImageLayout new_layout = usage_to_layout(barrier.new_usage);
+
+		VkImageMemoryBarrier &transition = transitions.emplace_back();
+		transition = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		transition.srcAccessMask = layout_to_access(old_layout);
+		transition.dstAccessMask = layout_to_access(new_layout);
+		transition.oldLayout = old_layout;
+		transition.newLayout = new_layout;
+		transition.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		transition.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		transition.image = static_cast<vulkan_tex_data *>(texture->impl)->image;
+		transition.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+		src_stage_mask |= layout_to_stage(old_layout);
+		dst_stage_mask |= layout_to_stage(new_layout);
+	}
+
+	// Submit all transitions in a single pipeline barrier
+	if (!transitions.empty())
+		vk.CmdPipelineBarrier(_cmd_buffers[_cmd_index].first, src_stage_mask, dst_stage_mask, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(transitions.size()), transitions.data());
+}
+
 void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 {
 	const auto impl = static_cast<vulkan_technique_data *>(technique.impl);
@@ -1889,7 +1949,16 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 
 	// Setup shader constants
 	if (effect_data.ubo != VK_NULL_HANDLE)
-		vk.CmdUpdateBuffer(cmd_list, effect_data.ubo, 0, _effects[technique.effect_index].uniform_data_storage.size(), _effects[technique.effect_index].uniform_data_storage.data());
+	{
+		effect &effect = _effects[technique.effect_index];
+
+		// Uniform variables updated every frame are packed at the end of the buffer and always uploaded, the others only after a value changed
+		const VkDeviceSize update_offset = effect.uniform_data_dirty ? 0 : effect.module.per_frame_uniform_offset;
+		if (update_offset < effect.uniform_data_storage.size())
+			vk.CmdUpdateBuffer(cmd_list, effect_data.ubo, update_offset, effect.uniform_data_storage.size() - update_offset, effect.uniform_data_storage.data() + update_offset);
+
+		effect.uniform_data_dirty = false;
+	}
 
 #if RESHADE_DEPTH
 	if (_depth_image != VK_NULL_HANDLE)
@@ -1900,13 +1969,15 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 #endif
 
 	bool is_effect_stencil_cleared = false;
-	bool needs_implicit_backbuffer_copy = true; // First pass always needs the back buffer updated
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
-		if (needs_implicit_backbuffer_copy)
+		if (technique.culled_passes[pass_index])
+			continue; // Nothing uses the output of this pass, so can skip it
+
+		if (_backbuffer_copy_planner.next_pass(technique.pass_accesses[pass_index]))
 		{
-			// Save back buffer of previous pass
+			// Save back buffer of previous pass, since this pass samples it
 			const VkImageCopy copy_range = {
 				{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 }, { 0, 0, 0 },
 				{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 }, { 0, 0, 0 }, { _width, _height, 1 }
@@ -1921,6 +1992,10 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 		const vulkan_pass_data &pass_data = impl->passes[pass_index];
 		const reshadefx::pass_info &pass_info = technique.passes[pass_index];
 
+		// Transition textures this pass accesses into the required layout (which only does something if the layout differs from the one a previous pass, possibly in another technique, left them in)
+		_texture_barrier_planner.require(technique.pass_accesses[pass_index]);
+		apply_texture_barriers(_texture_barrier_planner.flush());
+
 #ifndef NDEBUG
 		if (insert_debug_markers)
 		{
@@ -1939,18 +2014,9 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 
 		if (!pass_info.cs_entry_point.empty())
 		{
-			// Compute shaders do not write to the back buffer, so no update necessary
-			needs_implicit_backbuffer_copy = false;
-
-			for (const vulkan_tex_data *storage_resource : pass_data.modified_resources)
-				transition_layout(vk, cmd_list, storage_resource->image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
-
 			vk.CmdBindPipeline(cmd_list, VK_PIPELINE_BIND_POINT_COMPUTE, pass_data.pipeline);
 			vk.CmdBindDescriptorSets(cmd_list, VK_PIPELINE_BIND_POINT_COMPUTE, effect_data.pipeline_layout, 1, 2, pass_data.set, 0, nullptr);
 			vk.CmdDispatch(cmd_list, pass_info.viewport_width, pass_info.viewport_height, pass_info.viewport_dispatch_z);
-
-			for (const vulkan_tex_data *storage_resource : pass_data.modified_resources)
-				transition_layout(vk, cmd_list, storage_resource->image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 		}
 		else
 		{
@@ -1967,14 +2033,7 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 
 			VkRenderPassBeginInfo begin_info = pass_data.begin_info;
 			if (begin_info.framebuffer == VK_NULL_HANDLE)
-			{
 				begin_info.framebuffer = _swapchain_frames[_swap_index * 2 + pass_info.srgb_write_enable];
-				needs_implicit_backbuffer_copy = true;
-			}
-			else
-			{
-				needs_implicit_backbuffer_copy = false;
-			}
 
 			vk.CmdBeginRenderPass(cmd_list, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -1988,7 +2047,12 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 			vk.CmdEndRenderPass(cmd_list);
 		}
 
-		// Generate mipmaps for modified resources
+		// Generate mipmaps for modified resources, which requires them to be in shader read-only layout
+		for (const std::string &texture_name : technique.pass_accesses[pass_index].written_textures)
+			if (look_up_texture_by_name(texture_name).levels > 1)
+				_texture_barrier_planner.require(texture_name, reshadefx::texture_usage::shader_resource);
+		apply_texture_barriers(_texture_barrier_planner.flush());
+
 		for (const vulkan_tex_data *texture : pass_data.modified_resources)
 			generate_mipmaps(texture);
 
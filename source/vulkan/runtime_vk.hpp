@@ -42,6 +42,7 @@ namespace reshade::vulkan
 		void upload_texture(const texture &texture, const uint8_t *pixels) override;
 		void destroy_texture(texture &texture) override;
 		void generate_mipmaps(const struct vulkan_tex_data *impl);
+		void apply_texture_barriers(const std::vector<reshadefx::texture_barrier> &barriers);
 
 		void render_technique(technique &technique) override;
 
@@ -90,6 +91,7 @@ namespace reshade::vulkan
 		VkFormat _effect_stencil_format = VK_FORMAT_UNDEFINED;
 		VkImageView _effect_stencil_view = VK_NULL_HANDLE;
 		std::vector<struct vulkan_effect_data> _effect_data;
+		reshadefx::texture_barrier_planner _texture_barrier_planner;
 		VkDescriptorPool _effect_descriptor_pool = VK_NULL_HANDLE;
 		VkDescriptorSetLayout _effect_descriptor_layout = VK_NULL_HANDLE;
 		std::unordered_map<size_t, VkSampler> _effect_sampler_states;
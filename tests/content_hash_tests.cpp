@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "content_hash.hpp"
+#include <cstring>
+
+using namespace reshade;
+
+// Prefixes of this message, so that every tail length is covered along with an empty input, exactly one block and one block plus a byte
+static const char reference_message[] = "0123456789abcdefg";
+
+// Results of the reference implementation (MurmurHash3_x64_128 from SMHasher with a seed of zero) for those prefixes
+static const struct { size_t size; uint64_t low, high; } reference_hashes[] = {
+	{  0, 0x0000000000000000, 0x0000000000000000 },
+	{  1, 0x2ac9debed546a380, 0x3a8de9e53c875e09 },
+	{  2, 0x649e4eaa7fc1708e, 0xe6945110230f2ad6 },
+	{  3, 0xce68f60d7c353bdb, 0x00364cd5936bf18a },
+	{  4, 0x0f95757ce7f38254, 0xb4c67c9e6f12ab4b },
+	{  5, 0x0f04e459497f3fc1, 0xeccc6223a28dd613 },
+	{  6, 0x88c0a92586be0a27, 0x81062d6137728244 },
+	{  7, 0x13eb9fb82606f7a6, 0xb4ebef492fdef34e },
+	{  8, 0x8236039b7387354d, 0xc3369387d8964920 },
+	{  9, 0x4c1e87519fe738ba, 0x72a17af899d597f1 },
+	{ 10, 0x3f9652ac3effeb24, 0x8027a17cf2990b07 },
+	{ 11, 0x4bc3eacd29d38629, 0x7cb2d9e797da9c92 },
+	{ 12, 0x66352b8cee9e3ca7, 0xa9edf0b381a8fc58 },
+	{ 13, 0x5eb2f8db4265931e, 0x801ce853e61d0ab7 },
+	{ 14, 0x07a4a014dd59f71a, 0xaaf437854cd22231 },
+	{ 15, 0xa62dd5f6c0bf2351, 0x4fccf50c7c544cf0 },
+	{ 16, 0x4be06d94cf4ad1a7, 0x87c35b5c63a708da },
+	{ 17, 0x8e32612daa45f9de, 0x0800f4c206c372ee },
+};
+
+TEST_CASE(content_hash_reference_vectors)
+{
+	for (const auto &reference : reference_hashes)
+	{
+		const content_hash hash = content_hasher().update(reference_message, reference.size).finalize();
+		CHECK(hash.low == reference.low);
+		CHECK(hash.high == reference.high);
+	}
+
+	// The commonly published hash of this sentence, which is written out in byte order
+	const char *const sentence = "The quick brown fox jumps over the lazy dog";
+	const content_hash hash = content_hasher().update(sentence, std::strlen(sentence)).finalize();
+	CHECK(hash.to_string() == "e34bbc7bbc071b6c7a433ca9c49a9347");
+}
+
+TEST_CASE(content_hash_split_updates)
+{
+	char message[100];
+	for (size_t i = 0; i < sizeof(message); ++i)
+		message[i] = static_cast<char>(i * 7 + 3);
+
+	const content_hash expected = content_hasher().update(message, sizeof(message)).finalize();
+
+	// Splitting the data at any point (inside a block, at a block boundary or into empty chunks) has to give the same result
+	for (size_t split = 0; split <= sizeof(message); ++split)
+	{
+		const content_hash hash = content_hasher()
+			.update(message, split)
+			.update(message + split, 0)
+			.update(message + split, sizeof(message) - split)
+			.finalize();
+		CHECK(hash == expected);
+	}
+
+	// Same when it is added one byte at a time, so that every block is completed from the partial one
+	content_hasher hasher;
+	for (size_t i = 0; i < sizeof(message); ++i)
+		hasher.update(message + i, 1);
+	CHECK(hasher.finalize() == expected);
+}
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include <memory>
+#include <algorithm>
+
+static bool compile_glsl(const char *source, bool minify, reshadefx::module &module)
+{
+	const std::unique_ptr<reshadefx::codegen> codegen(reshadefx::create_codegen_glsl(false, false, false, true, minify));
+
+	reshadefx::parser parser;
+	if (!parser.parse(source, codegen.get()))
+		return false;
+
+	codegen->write_result(module);
+	return true;
+}
+
+TEST_CASE(codegen_glsl_minify_keeps_line_numbers)
+{
+	// Only entry point functions, so that minification does not remove any code and line numbers can be compared directly
+	const char *const source = R"(
+		uniform float Strength < ui_type = "slider"; > = 0.5;
+		texture ColorTex : COLOR;
+		sampler ColorSampler { Texture = ColorTex; };
+
+		void MainVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		}
+
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			float4 color = tex2D(ColorSampler, texcoord);
+			color.rgb = lerp(color.rgb, dot(color.rgb, float3(0.299, 0.587, 0.114)), Strength);
+			return color;
+		}
+
+		technique Main { pass { VertexShader = MainVS; PixelShader = MainPS; } }
+	)";
+
+	reshadefx::module module, minified_module;
+	CHECK(compile_glsl(source, false, module));
+	CHECK(compile_glsl(source, true, minified_module));
+
+	// Minification has to make the code smaller without joining any lines, or else line numbers in errors from the driver would be meaningless
+	CHECK(minified_module.hlsl.size() < module.hlsl.size());
+	CHECK(std::count(minified_module.hlsl.begin(), minified_module.hlsl.end(), '\n') == std::count(module.hlsl.begin(), module.hlsl.end(), '\n'));
+	CHECK(std::count(minified_module.hlsl.begin(), minified_module.hlsl.end(), '\n') > 40);
+}
+
+// Returns the line number of the first line in the code that contains the specified text
+static size_t line_number_of(const std::string &code, const std::string &text)
+{
+	return std::count(code.begin(), code.begin() + code.find(text), '\n') + 1;
+}
+
+TEST_CASE(codegen_glsl_minify_keeps_line_numbers_of_pruned_code)
+{
+	// A helper function that no entry point uses is removed and one that only the pixel shader uses is enclosed in a preprocessor guard, both in front of the entry points
+	const char *const source = R"(
+		texture ColorTex : COLOR;
+		sampler ColorSampler { Texture = ColorTex; };
+
+		float3 UnusedHelper(float3 color)
+		{
+			return color * 2.0;
+		}
+
+		float3 UsedHelper(float3 color)
+		{
+			float luma = dot(color, float3(0.299, 0.587, 0.114));
+			return lerp(color, luma, 0.5);
+		}
+
+		void MainVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		}
+
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			float4 color = tex2D(ColorSampler, texcoord);
+			color.rgb = UsedHelper(color.rgb);
+			return color;
+		}
+
+		technique Main { pass { VertexShader = MainVS; PixelShader = MainPS; } }
+	)";
+
+	reshadefx::module module, minified_module;
+	CHECK(compile_glsl(source, false, module));
+	CHECK(compile_glsl(source, true, minified_module));
+
+	CHECK(module.hlsl.find("UnusedHelper") != std::string::npos);
+	CHECK(minified_module.hlsl.find("vec3(2.00000000e+00,2.00000000e+00,2.00000000e+00)") == std::string::npos);
+	CHECK(minified_module.hlsl.find("#if defined(ENTRY_POINT_F_MainPS)\n") != std::string::npos);
+
+	// Statements are on the same lines as without minification, in the pruned functions as well as after them
+	CHECK(line_number_of(minified_module.hlsl, "=dot(") == line_number_of(module.hlsl, " = dot("));
+	CHECK(line_number_of(minified_module.hlsl, "=mix(") == line_number_of(module.hlsl, " = mix("));
+	CHECK(line_number_of(minified_module.hlsl, "=texture(") == line_number_of(module.hlsl, " = texture("));
+	CHECK(line_number_of(minified_module.hlsl, "gl_Position.y=") == line_number_of(module.hlsl, "gl_Position.y = "));
+	CHECK(std::count(minified_module.hlsl.begin(), minified_module.hlsl.end(), '\n') == std::count(module.hlsl.begin(), module.hlsl.end(), '\n'));
+}
+
+TEST_CASE(codegen_hlsl_sm3_uniforms_referenced_directly)
+{
+	const char *const source = R"(
+		uniform float Strength = 0.5;
+		uniform float3 Tint = float3(1.0, 0.9, 0.8);
+
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			return float4(Tint * Strength, 1.0);
+		}
+
+		technique Main { pass { VertexShader = MainPS; PixelShader = MainPS; } }
+	)";
+
+	const std::unique_ptr<reshadefx::codegen> codegen(reshadefx::create_codegen_hlsl(30, false, false));
+
+	reshadefx::parser parser;
+	CHECK(parser.parse(source, codegen.get()));
+
+	reshadefx::module module;
+	codegen->write_result(module);
+
+	// Both uniforms are packed into the same constant register and are used in place, without copying them into a temporary variable first
+	CHECK(module.hlsl.find("(__c0.yzw) * (__c0.x)") != std::string::npos);
+	CHECK(module.hlsl.find(" = (__c0.x);") == std::string::npos && module.hlsl.find(" = (__c0.yzw);") == std::string::npos);
+
+	// Reading them still counts towards the constant registers of the entry point
+	const std::string &entry_point_name = module.techniques[0].passes[0].ps_entry_point;
+	const auto entry_point = std::find_if(module.entry_points.begin(), module.entry_points.end(),
+		[&entry_point_name](const reshadefx::entry_point &ep) { return ep.name == entry_point_name; });
+	CHECK(entry_point != module.entry_points.end() && entry_point->first_constant_register == 0 && entry_point->num_constant_registers == 1);
+}
+
+static bool compile_hlsl_reduced_precision(const std::string &pixel_shader, reshadefx::module &module)
+{
+	const std::unique_ptr<reshadefx::codegen> codegen(reshadefx::create_codegen_hlsl(50, false, false, true));
+
+	reshadefx::parser parser;
+	if (!parser.parse(R"(
+		texture DataTex { Width = 64; Height = 64; Format = RGBA8; };
+		sampler DataSampler { Texture = DataTex; };
+		texture DepthTex : DEPTH;
+		sampler DepthSampler { Texture = DepthTex; };
+
+		void MainVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		}
+	)" + pixel_shader + R"(
+		technique Main { pass { VertexShader = MainVS; PixelShader = MainPS; } }
+	)", codegen.get()))
+		return false;
+
+	codegen->write_result(module);
+	return true;
+}
+
+// Returns the type of the declaration on the first line of the pixel shader that contains the specified code
+static std::string declared_type(const reshadefx::module &module, const std::string &code)
+{
+	const size_t line_offset = module.hlsl.rfind('\n', module.hlsl.find(code, module.hlsl.find("F__MainPS"))) + 1;
+	const size_t type_offset = module.hlsl.find_first_not_of('\t', line_offset);
+	return module.hlsl.substr(type_offset, module.hlsl.find(' ', type_offset) - type_offset);
+}
+
+TEST_CASE(codegen_hlsl_reduced_precision_color_math)
+{
+	// The variable is assigned a value computed from itself, which must not count as an endless chain of operations
+	reshadefx::module module;
+	CHECK(compile_hlsl_reduced_precision(R"(
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			float4 color = tex2D(DataSampler, texcoord);
+			color.rgb = saturate(color.rgb * 1.5 + 0.25);
+			return color;
+		}
+	)", module));
+
+	CHECK(declared_type(module, "V__DataSampler.t.Sample") == "min16float4");
+	CHECK(declared_type(module, " color = ") == "min16float4");
+	CHECK(declared_type(module, "* float3(1.50000000e+00") == "min16float3");
+	CHECK(declared_type(module, "saturate(") == "min16float3");
+}
+
+TEST_CASE(codegen_hlsl_reduced_precision_operation_limit)
+{
+	// Too many operations in a row accumulate too much rounding error, even if each of them is safe on its own
+	reshadefx::module module;
+	CHECK(compile_hlsl_reduced_precision(R"(
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			float4 color = tex2D(DataSampler, texcoord);
+			for (int i = 0; i < 4; ++i)
+				color = color * 0.5 + 0.25;
+			color = color * 0.5 + 0.25;
+			color = color * 0.5 + 0.25;
+			color = color * 0.5 + 0.25;
+			color = color * 0.5 + 0.25;
+			color = color * 0.5 + 0.25;
+			return color;
+		}
+	)", module));
+
+	// Only the texture fetch itself is still within the limit
+	CHECK(declared_type(module, "V__DataSampler.t.Sample") == "min16float4");
+	CHECK(declared_type(module, " color = ") == "float4");
+	CHECK(module.hlsl.find("min16float4") == module.hlsl.rfind("min16float4"));
+}
+
+TEST_CASE(codegen_hlsl_reduced_precision_sensitive_uses)
+{
+	// Values that end up in texture coordinates need full precision to address texels
+	reshadefx::module texcoord_module;
+	CHECK(compile_hlsl_reduced_precision(R"(
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			float2 offset = tex2D(DataSampler, texcoord).xy * 0.5;
+			return tex2D(DataSampler, texcoord + offset);
+		}
+	)", texcoord_module));
+
+	CHECK(declared_type(texcoord_module, "V__DataSampler.t.Sample(V__DataSampler.s, texcoord)") == "float4");
+	CHECK(declared_type(texcoord_module, " offset = ") == "float2");
+	CHECK(declared_type(texcoord_module, "texcoord + offset") == "float2");
+
+	// Comparisons can flip on small differences
+	reshadefx::module comparison_module;
+	CHECK(compile_hlsl_reduced_precision(R"(
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			float luma = saturate(tex2D(DataSampler, texcoord).x * 2.0);
+			return luma > 0.5 ? 1.0 : 0.0;
+		}
+	)", comparison_module));
+
+	CHECK(declared_type(comparison_module, "V__DataSampler.t.Sample") == "float4");
+	CHECK(declared_type(comparison_module, "saturate(") == "float");
+	CHECK(declared_type(comparison_module, " luma = ") == "float");
+
+	// Conversion to integers truncates, so the result can be off by one for values close to an integer
+	reshadefx::module cast_module;
+	CHECK(compile_hlsl_reduced_precision(R"(
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			float level = saturate(tex2D(DataSampler, texcoord).x * 2.0);
+			return (int)(level * 4.0) * 0.25;
+		}
+	)", cast_module));
+
+	CHECK(declared_type(cast_module, "V__DataSampler.t.Sample") == "float4");
+	CHECK(declared_type(cast_module, " level = ") == "float");
+	CHECK(declared_type(cast_module, "* 4.00000000e+00") == "float");
+
+	// The depth buffer usually has more precision than 16-bit floating-point
+	reshadefx::module depth_module;
+	CHECK(compile_hlsl_reduced_precision(R"(
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			return saturate(tex2D(DepthSampler, texcoord).x * 2.0);
+		}
+	)", depth_module));
+
+	CHECK(depth_module.hlsl.find("min16float") == std::string::npos);
+}
+
+static bool compile_hlsl_uniforms(const char *uniforms, reshadefx::module &module)
+{
+	const std::unique_ptr<reshadefx::codegen> codegen(reshadefx::create_codegen_hlsl(50, false, false));
+
+	reshadefx::parser parser;
+	if (!parser.parse(std::string(uniforms) + "float4 MainPS() : SV_Target { return 0; }\ntechnique Main { pass { VertexShader = MainPS; PixelShader = MainPS; } }\n", codegen.get()))
+		return false;
+
+	codegen->write_result(module);
+	return true;
+}
+
+static uint32_t uniform_offset(const reshadefx::module &module, const std::string &name)
+{
+	const auto it = std::find_if(module.uniforms.begin(), module.uniforms.end(),
+		[&name](const reshadefx::uniform_info &info) { return info.name == name; });
+	return it != module.uniforms.end() ? it->offset : ~0u;
+}
+
+static bool crosses_16_byte_boundary(const reshadefx::uniform_info &info)
+{
+	return (info.offset / 16) != ((info.offset + info.size - 1) / 16);
+}
+
+TEST_CASE(codegen_hlsl_uniform_layout_packs_rows)
+{
+	// In declaration order the 'float3' would have to skip to the next row after the 'float2', leaving 8 bytes of padding
+	reshadefx::module module;
+	CHECK(compile_hlsl_uniforms(
+		"uniform float2 A;\n"
+		"uniform float3 B;\n"
+		"uniform float C;\n", module));
+
+	// Largest first, with the 'float' filling the rest of the row of the 'float3'
+	CHECK(uniform_offset(module, "B") == 0);
+	CHECK(uniform_offset(module, "C") == 12);
+	CHECK(uniform_offset(module, "A") == 16);
+	CHECK(module.total_uniform_size == 24);
+
+	// Without any uniform variables updated every frame the per-frame range is empty and starts at the end
+	CHECK(module.per_frame_uniform_offset == module.total_uniform_size);
+	CHECK(module.hlsl.find("cbuffer _Globals : register(b0)") != std::string::npos);
+	CHECK(module.hlsl.find("register(b1)") == std::string::npos);
+}
+
+TEST_CASE(codegen_hlsl_uniform_layout_per_frame_last)
+{
+	reshadefx::module module;
+	CHECK(compile_hlsl_uniforms(
+		"uniform float Timer < source = \"timer\"; >;\n"
+		"uniform float A;\n"
+		"uniform float3 B;\n"
+		"uniform float2 C;\n"
+		"uniform float4x4 M;\n"
+		"uniform int Frame < source = \"framecount\"; >;\n"
+		"uniform float2 D;\n"
+		"uniform float2 E;\n", module));
+
+	// Matrices stay in front, the others fill rows in first-fit decreasing order
+	CHECK(uniform_offset(module, "M") == 0);
+	CHECK(uniform_offset(module, "B") == 64);
+	CHECK(uniform_offset(module, "A") == 76);
+	CHECK(uniform_offset(module, "C") == 80);
+	CHECK(uniform_offset(module, "D") == 88);
+	CHECK(uniform_offset(module, "E") == 96);
+
+	// Uniform variables updated every frame go behind all others, starting on the next 16-byte boundary so that they can be bound as a separate constant buffer
+	CHECK(module.per_frame_uniform_offset == 112);
+	CHECK(uniform_offset(module, "Timer") == 112);
+	CHECK(uniform_offset(module, "Frame") == 116);
+	CHECK(module.total_uniform_size == 120);
+	CHECK(module.hlsl.find("cbuffer _PerFrame : register(b1)") != std::string::npos);
+
+	// No scalar or vector is split across two rows
+	for (const reshadefx::uniform_info &info : module.uniforms)
+		CHECK(info.type.is_matrix() || !crosses_16_byte_boundary(info));
+}
+
+TEST_CASE(codegen_hlsl_uniform_layout_only_per_frame)
+{
+	reshadefx::module module;
+	CHECK(compile_hlsl_uniforms(
+		"uniform float Timer < source = \"timer\"; >;\n"
+		"uniform float2 Mouse < source = \"mousepoint\"; >;\n"
+		"uniform float3 Color < source = \"random\"; >;\n", module));
+
+	// The whole layout is per-frame, so that range starts at the beginning and the other constant buffer is left out
+	CHECK(module.per_frame_uniform_offset == 0);
+	CHECK(uniform_offset(module, "Color") == 0);
+	CHECK(uniform_offset(module, "Timer") == 12);
+	CHECK(uniform_offset(module, "Mouse") == 16);
+	CHECK(module.total_uniform_size == 24);
+	CHECK(module.hlsl.find("register(b0)") == std::string::npos);
+	CHECK(module.hlsl.find("cbuffer _PerFrame : register(b1)") != std::string::npos);
+}
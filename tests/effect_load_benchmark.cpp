@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+// Compares the two ways 'runtime::load_effects' has distributed effects across its worker threads:
+// - "static slices": every thread works through a fixed, contiguous slice of the file list (the previous implementation)
+// - "shared queue": threads take the next effect from a shared counter, with the effects that took longest on the previous load first (the current implementation)
+// Loading an effect here means preprocessing, parsing and generating HLSL, which is what the runtime does before handing the code to the graphics API compiler.
+
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_preprocessor.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+using duration = std::chrono::high_resolution_clock::duration;
+
+static std::string format_ms(duration value)
+{
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%.1f ms", std::chrono::duration_cast<std::chrono::microseconds>(value).count() / 1000.0);
+	return buffer;
+}
+
+static bool load_effect(const std::filesystem::path &source_file)
+{
+	reshadefx::preprocessor pp;
+	pp.add_macro_definition("__RESHADE__", "40900");
+	pp.add_macro_definition("BUFFER_WIDTH", "1920");
+	pp.add_macro_definition("BUFFER_HEIGHT", "1080");
+	pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+	pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+	pp.add_macro_definition("BUFFER_COLOR_BIT_DEPTH", "8");
+	pp.add_include_path(source_file.parent_path());
+
+	if (!pp.append_file(source_file))
+		return false;
+
+	const std::unique_ptr<reshadefx::codegen> codegen(reshadefx::create_codegen_hlsl(50, false, false));
+
+	reshadefx::parser parser;
+	if (!parser.parse(std::move(pp.output()), codegen.get()))
+		return false;
+
+	reshadefx::module module;
+	codegen->write_result(module);
+	return true;
+}
+
+// Write a set of effects that resembles a typical shader collection: many cheap effects with one or two short passes and a few expensive ones with lots of code
+static std::vector<std::filesystem::path> generate_effects(const std::filesystem::path &directory, size_t num_effects)
+{
+	std::filesystem::create_directories(directory);
+
+	std::ofstream(directory / "Common.fxh") << R"(
+		texture BackBufferTex : COLOR;
+		sampler BackBuffer { Texture = BackBufferTex; };
+		void PostProcessVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		}
+		float Luma(float3 color) { return dot(color, float3(0.2126, 0.7152, 0.0722)); }
+		float3 Saturate(float3 color, float amount) { return lerp(Luma(color), color, amount); }
+	)";
+
+	std::vector<std::filesystem::path> effect_files;
+
+	for (size_t effect_index = 0; effect_index < num_effects; ++effect_index)
+	{
+		// Every 15th effect is expensive, with a different amount of code each
+		const size_t num_functions = effect_index % 15 == 7 ? 100 + (effect_index * 37) % 300 : 1 + effect_index % 4;
+
+		std::string source = "#include \"Common.fxh\"\nuniform float Strength < ui_type = \"slider\"; > = 0.5;\n";
+		for (size_t i = 0; i < num_functions; ++i)
+		{
+			const std::string name = "Step" + std::to_string(i);
+			source += "float3 " + name + "(float3 color, float2 texcoord)\n{\n";
+			source += "\t[unroll] for (int k = 0; k < 4; ++k)\n\t\tcolor += tex2Dlod(BackBuffer, float4(texcoord + float2(k, " + std::to_string(i % 7) + ") * BUFFER_RCP_WIDTH, 0, 0)).rgb * 0.25;\n";
+			source += "\tcolor = Saturate(color, Strength + " + std::to_string(i % 10) + ".0 * 0.1);\n";
+			source += i == 0 ? "\treturn color;\n}\n" : "\treturn Step" + std::to_string(i - 1) + "(color * 0.5, texcoord);\n}\n";
+		}
+		source += "float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target\n{\n";
+		source += "\treturn float4(Step" + std::to_string(num_functions - 1) + "(tex2D(BackBuffer, texcoord).rgb, texcoord), 1.0);\n}\n";
+		source += "technique Effect" + std::to_string(effect_index) + " { pass { VertexShader = PostProcessVS; PixelShader = MainPS; } }\n";
+
+		char file_name[32];
+		std::snprintf(file_name, sizeof(file_name), "Effect%03zu.fx", effect_index);
+		std::ofstream(directory / file_name) << source;
+		effect_files.push_back(directory / file_name);
+	}
+
+	return effect_files;
+}
+
+static duration load_static_slices(const std::vector<std::filesystem::path> &effect_files, size_t num_threads)
+{
+	const auto start_time = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (size_t n = 0; n < num_threads; ++n)
+		threads.emplace_back([&effect_files, num_threads, n]() {
+			for (size_t i = 0; i < effect_files.size(); ++i)
+				if (i * num_threads / effect_files.size() == n)
+					load_effect(effect_files[i]);
+		});
+	for (std::thread &thread : threads)
+		thread.join();
+
+	return std::chrono::high_resolution_clock::now() - start_time;
+}
+static duration load_shared_queue(const std::vector<std::filesystem::path> &effect_files, const std::vector<size_t> &load_order, size_t num_threads)
+{
+	const auto start_time = std::chrono::high_resolution_clock::now();
+
+	std::atomic<size_t> next_effect = 0;
+	std::vector<std::thread> threads;
+	for (size_t n = 0; n < num_threads; ++n)
+		threads.emplace_back([&effect_files, &load_order, &next_effect]() {
+			for (size_t i; (i = next_effect.fetch_add(1)) < load_order.size();)
+				load_effect(effect_files[load_order[i]]);
+		});
+	for (std::thread &thread : threads)
+		thread.join();
+
+	return std::chrono::high_resolution_clock::now() - start_time;
+}
+
+// Calculate how long both schedules take with the specified number of threads from the load time of every effect, assuming every thread gets a core of its own
+static duration model_static_slices(const std::vector<duration> &load_durations, size_t num_threads)
+{
+	std::vector<duration> thread_durations(num_threads);
+	for (size_t i = 0; i < load_durations.size(); ++i)
+		thread_durations[i * num_threads / load_durations.size()] += load_durations[i];
+	return *std::max_element(thread_durations.begin(), thread_durations.end());
+}
+static duration model_shared_queue(const std::vector<duration> &load_durations, const std::vector<size_t> &load_order, size_t num_threads)
+{
+	std::vector<duration> thread_durations(num_threads);
+	for (const size_t effect_index : load_order)
+		*std::min_element(thread_durations.begin(), thread_durations.end()) += load_durations[effect_index];
+	return *std::max_element(thread_durations.begin(), thread_durations.end());
+}
+
+int main(int argc, char *argv[])
+{
+	std::filesystem::path effect_directory;
+	size_t num_effects = 150;
+	size_t num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1;
+	size_t num_runs = 3;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (0 == std::strcmp(argv[i], "--threads") && i + 1 < argc)
+			num_threads = std::max<size_t>(std::strtoul(argv[++i], nullptr, 10), 1);
+		else if (0 == std::strcmp(argv[i], "--effects") && i + 1 < argc)
+			num_effects = std::max<size_t>(std::strtoul(argv[++i], nullptr, 10), 1);
+		else if (0 == std::strcmp(argv[i], "--runs") && i + 1 < argc)
+			num_runs = std::max<size_t>(std::strtoul(argv[++i], nullptr, 10), 1);
+		else if (argv[i][0] != '-')
+			effect_directory = argv[i];
+		else
+		{
+			std::printf("usage: effect_load_benchmark [<directory with .fx files>] [--effects <count>] [--threads <count>] [--runs <count>]\n");
+			return 1;
+		}
+	}
+
+	std::vector<std::filesystem::path> effect_files;
+	if (effect_directory.empty())
+	{
+		effect_files = generate_effects(std::filesystem::temp_directory_path() / "reshade_effect_load_benchmark", num_effects);
+	}
+	else
+	{
+		for (const auto &entry : std::filesystem::directory_iterator(effect_directory))
+			if (entry.path().extension() == ".fx")
+				effect_files.push_back(entry.path());
+		std::sort(effect_files.begin(), effect_files.end());
+	}
+
+	if (effect_files.empty())
+	{
+		std::printf("No effect files found.\n");
+		return 1;
+	}
+
+	// The first load records the timings the next one orders effects by
+	std::vector<duration> load_durations(effect_files.size());
+	for (size_t i = 0; i < effect_files.size(); ++i)
+	{
+		const auto start_time = std::chrono::high_resolution_clock::now();
+		if (!load_effect(effect_files[i]))
+			std::printf("Failed to load '%s'.\n", effect_files[i].string().c_str());
+		load_durations[i] = std::chrono::high_resolution_clock::now() - start_time;
+	}
+
+	std::vector<size_t> load_order(effect_files.size());
+	for (size_t i = 0; i < load_order.size(); ++i)
+		load_order[i] = i;
+	std::stable_sort(load_order.begin(), load_order.end(), [&load_durations](size_t lhs, size_t rhs) { return load_durations[lhs] > load_durations[rhs]; });
+
+	duration total_duration = {};
+	for (const duration &load_duration : load_durations)
+		total_duration += load_duration;
+
+	std::printf("%zu effects, %s in total on a single thread, slowest effect %s\n",
+		effect_files.size(), format_ms(total_duration).c_str(), format_ms(load_durations[load_order.front()]).c_str());
+
+	duration static_slices_duration = duration::max(), shared_queue_duration = duration::max();
+	for (size_t run = 0; run < num_runs; ++run)
+	{
+		static_slices_duration = std::min(static_slices_duration, load_static_slices(effect_files, num_threads));
+		shared_queue_duration = std::min(shared_queue_duration, load_shared_queue(effect_files, load_order, num_threads));
+	}
+
+	std::printf("Measured with %zu threads on %u hardware threads (best of %zu runs): static slices %s, shared queue %s\n",
+		num_threads, std::thread::hardware_concurrency(), num_runs, format_ms(static_slices_duration).c_str(), format_ms(shared_queue_duration).c_str());
+
+	for (const size_t num_modeled_threads : { size_t(3), size_t(7), size_t(15) })
+		std::printf("Modeled with %zu threads from the single thread timings: static slices %s, shared queue %s\n",
+			num_modeled_threads, format_ms(model_static_slices(load_durations, num_modeled_threads)).c_str(), format_ms(model_shared_queue(load_durations, load_order, num_modeled_threads)).c_str());
+
+	return 0;
+}
@@ -0,0 +1,571 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_pass_analysis.hpp"
+#include <memory>
+
+using namespace reshadefx;
+
+static bool compile_hlsl(const std::string &source, module &module)
+{
+	const std::unique_ptr<codegen> codegen(create_codegen_hlsl(50, false, false));
+
+	parser parser;
+	if (!parser.parse(source, codegen.get()))
+		return false;
+
+	codegen->write_result(module);
+	return true;
+}
+
+// Two techniques, each with a pass that renders to an intermediate texture of the same size and a pass that samples it, using the vertex shader specified for the first pass
+static std::string make_intermediate_effect(const char *vertex_shader)
+{
+	return std::string(R"(
+		texture ColorTex : COLOR;
+		sampler ColorSampler { Texture = ColorTex; };
+		texture IntermediateTex1 { Width = 1920; Height = 1080; };
+		sampler IntermediateSampler1 { Texture = IntermediateTex1; };
+		texture IntermediateTex2 { Width = 1920; Height = 1080; };
+		sampler IntermediateSampler2 { Texture = IntermediateTex2; };
+
+		void PostProcessVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		}
+	)") + vertex_shader + R"(
+		float4 ColorPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(ColorSampler, texcoord); }
+		float4 CombinePS1(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(IntermediateSampler1, texcoord * 0.5); }
+		float4 CombinePS2(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(IntermediateSampler2, texcoord * 0.5); }
+
+		technique First { pass { VertexShader = IntermediateVS; PixelShader = ColorPS; RenderTarget = IntermediateTex1; } pass { VertexShader = PostProcessVS; PixelShader = CombinePS1; } }
+		technique Second { pass { VertexShader = IntermediateVS; PixelShader = ColorPS; RenderTarget = IntermediateTex2; } pass { VertexShader = PostProcessVS; PixelShader = CombinePS2; } }
+	)";
+}
+
+static std::vector<std::pair<std::string, std::string>> allocate_transient_textures(const module &module)
+{
+	transient_texture_allocator allocator;
+	for (const texture_info &texture : module.textures)
+		if (texture.semantic.empty())
+			allocator.add_texture(texture);
+
+	for (const technique_info &technique : module.techniques)
+	{
+		std::vector<pass_access> passes;
+		for (const pass_info &pass : technique.passes)
+			passes.push_back(analyze_pass_access(module, pass));
+		allocator.add_technique(passes);
+	}
+
+	return allocator.allocate();
+}
+
+static pass_access back_buffer_pass(bool reads, bool writes)
+{
+	pass_access access;
+	access.reads_back_buffer = reads;
+	access.writes_back_buffer = writes;
+	return access;
+}
+
+static pass_access texture_pass(std::vector<std::string> reads, std::vector<std::string> writes)
+{
+	pass_access access;
+	access.read_textures = std::move(reads);
+	access.written_textures = std::move(writes);
+	// Passes without any render targets render to the back buffer
+	access.writes_back_buffer = access.written_textures.empty();
+	return access;
+}
+
+static texture_info make_texture(const char *name, const char *semantic = "")
+{
+	texture_info info;
+	info.unique_name = name;
+	info.semantic = semantic;
+	info.width = 1920;
+	info.height = 1080;
+	info.render_target = true;
+	return info;
+}
+
+static sampler_info make_sampler(const char *name, const char *texture_name)
+{
+	sampler_info info;
+	info.unique_name = name;
+	info.texture_name = texture_name;
+	return info;
+}
+
+TEST_CASE(analyze_pass_access_back_buffer)
+{
+	module module;
+	module.textures.push_back(make_texture("BackBufferTex", "COLOR"));
+	module.textures.push_back(make_texture("BlurTex"));
+
+	pass_info pass;
+	pass.vs_entry_point = "PostProcessVS";
+	pass.ps_entry_point = "BlurPS";
+	pass.samplers.push_back(make_sampler("BackBuffer", "BackBufferTex"));
+	pass.samplers.push_back(make_sampler("Blur", "BlurTex"));
+
+	// Passes without render targets render to the back buffer and the back buffer is not listed as a texture
+	const pass_access access = analyze_pass_access(module, pass);
+	CHECK(access.reads_back_buffer);
+	CHECK(access.writes_back_buffer);
+	CHECK(access.read_textures.size() == 1 && access.read_textures[0] == "BlurTex");
+	CHECK(access.written_textures.empty());
+
+	pass.render_target_names[0] = "BlurTex";
+	pass.samplers.pop_back();
+
+	const pass_access access_to_texture = analyze_pass_access(module, pass);
+	CHECK(access_to_texture.reads_back_buffer);
+	CHECK(!access_to_texture.writes_back_buffer);
+	CHECK(access_to_texture.written_textures.size() == 1 && access_to_texture.written_textures[0] == "BlurTex");
+}
+
+TEST_CASE(back_buffer_copy_planner_copies_once_until_written)
+{
+	back_buffer_copy_planner planner;
+	planner.begin_frame();
+
+	// Two techniques that only sample the back buffer in their first pass and then render to textures share a single copy
+	CHECK(planner.next_pass(back_buffer_pass(true, false)));
+	CHECK(!planner.next_pass(back_buffer_pass(false, false)));
+	CHECK(!planner.next_pass(back_buffer_pass(true, false)));
+	CHECK(!planner.next_pass(back_buffer_pass(false, false)));
+}
+
+TEST_CASE(back_buffer_copy_planner_copies_after_write)
+{
+	back_buffer_copy_planner planner;
+	planner.begin_frame();
+
+	// A typical technique sequence: each technique samples the back buffer and writes the result back to it
+	CHECK(planner.next_pass(back_buffer_pass(true, true)));
+	CHECK(planner.next_pass(back_buffer_pass(true, true)));
+
+	// Passes that only write to the back buffer do not need a copy, but outdate it for the passes after them
+	CHECK(!planner.next_pass(back_buffer_pass(false, true)));
+	CHECK(!planner.next_pass(back_buffer_pass(false, false)));
+	CHECK(planner.next_pass(back_buffer_pass(true, false)));
+}
+
+TEST_CASE(back_buffer_copy_planner_never_sampled)
+{
+	back_buffer_copy_planner planner;
+	planner.begin_frame();
+
+	// Techniques that never sample the back buffer never need a copy, no matter how often they write to it
+	for (int i = 0; i < 4; ++i)
+		CHECK(!planner.next_pass(back_buffer_pass(false, true)));
+}
+
+TEST_CASE(back_buffer_copy_planner_begin_frame)
+{
+	back_buffer_copy_planner planner;
+	planner.begin_frame();
+	CHECK(planner.next_pass(back_buffer_pass(true, false)));
+	CHECK(!planner.next_pass(back_buffer_pass(true, false)));
+
+	// The application renders to the back buffer in between frames, so the copy is outdated at the beginning of every frame
+	planner.begin_frame();
+	CHECK(planner.next_pass(back_buffer_pass(true, false)));
+}
+
+TEST_CASE(analyze_pass_access_full_screen_triangle)
+{
+	// The full-screen triangle vertex shader with different parameter names, formatting and comments is still recognized
+	module module;
+	CHECK(compile_hlsl(make_intermediate_effect(R"(
+		void IntermediateVS(uint vertex_id : SV_VERTEXID, out float4 pos : SV_POSITION, out float2 uv : TEXCOORD0)
+		{
+			uv.x = (vertex_id == 2) ? 2.0 : 0.0; // Comment
+			uv.y = (vertex_id == 1) ? 2.0 : 0.0;
+			pos = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		}
+	)"), module));
+	CHECK(!module.entry_points.empty() && module.entry_points[0].is_full_screen_triangle);
+
+	const pass_access access = analyze_pass_access(module, module.techniques[0].passes[0]);
+	CHECK(access.overwritten_textures.size() == 1 && access.overwritten_textures[0] == "V__IntermediateTex1");
+}
+
+TEST_CASE(analyze_pass_access_custom_vertex_shader)
+{
+	// Vertex shaders that differ from the full-screen triangle in any way may leave pixels untouched, even when drawing three vertices
+	const char *const vertex_shaders[] = {
+		R"(
+		void IntermediateVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(1.0, -1.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		})",
+		R"(
+		void IntermediateVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			PostProcessVS(id, position, texcoord);
+			position.xy *= 0.5;
+		})",
+		R"(
+		static const float2 texcoord = float2(0.5, 0.5);
+		void IntermediateVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 uv : TEXCOORD)
+		{
+			uv.x = (id == 2) ? 2.0 : 0.0;
+			uv.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		})",
+	};
+
+	for (const char *const vertex_shader : vertex_shaders)
+	{
+		module module;
+		CHECK(compile_hlsl(make_intermediate_effect(vertex_shader), module));
+
+		const pass_access access = analyze_pass_access(module, module.techniques[0].passes[0]);
+		CHECK(access.written_textures.size() == 1);
+		CHECK(access.overwritten_textures.empty());
+		CHECK(allocate_transient_textures(module).empty());
+	}
+}
+
+TEST_CASE(analyze_pass_access_clear_render_targets)
+{
+	module module;
+	CHECK(compile_hlsl(make_intermediate_effect(R"(
+		void IntermediateVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			PostProcessVS(id, position, texcoord);
+			position.xy *= 0.5;
+		})"), module));
+
+	// Cleared render targets are overwritten entirely no matter what the vertex shader does
+	pass_info pass = module.techniques[0].passes[0];
+	pass.clear_render_targets = true;
+	CHECK(analyze_pass_access(module, pass).overwritten_textures.size() == 1);
+}
+
+TEST_CASE(transient_texture_allocator_shares_between_techniques)
+{
+	module module;
+	CHECK(compile_hlsl(make_intermediate_effect(R"(
+		void IntermediateVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		})"), module));
+
+	// Both intermediate textures are overwritten before they are sampled and only used within their technique, so they can share storage
+	const auto aliases = allocate_transient_textures(module);
+	CHECK(aliases.size() == 1 && aliases[0].first == "V__IntermediateTex2" && aliases[0].second == "V__IntermediateTex1");
+}
+
+TEST_CASE(transient_texture_allocator_preserves_contents)
+{
+	texture_info first = make_texture("First"), second = make_texture("Second"), third = make_texture("Third");
+
+	pass_access write_first;
+	write_first.written_textures = { "First" };
+	pass_access overwrite_second;
+	overwrite_second.written_textures = overwrite_second.overwritten_textures = { "Second" };
+	pass_access read_second;
+	read_second.read_textures = { "Second" };
+	pass_access overwrite_third;
+	overwrite_third.written_textures = overwrite_third.overwritten_textures = { "Third" };
+
+	transient_texture_allocator allocator;
+	allocator.add_texture(first);
+	allocator.add_texture(second);
+	allocator.add_texture(third);
+	// The first texture is not overwritten entirely, so it keeps its previous contents from the last frame and cannot be shared
+	allocator.add_technique({ write_first, overwrite_second, read_second });
+	// The third texture is used in a different technique than the second one, but the second one is used in two techniques, so only the third one is transient
+	allocator.add_technique({ overwrite_third, read_second });
+
+	CHECK(allocator.allocate().empty());
+	CHECK(allocator.saved_memory_size() == 0);
+
+	transient_texture_allocator overlapping_allocator;
+	overlapping_allocator.add_texture(second);
+	overlapping_allocator.add_texture(third);
+	// Lifetimes of both textures overlap within the same technique
+	overlapping_allocator.add_technique({ overwrite_second, overwrite_third, read_second });
+	CHECK(overlapping_allocator.allocate().empty());
+
+	transient_texture_allocator sequential_allocator;
+	sequential_allocator.add_texture(second);
+	sequential_allocator.add_texture(third);
+	pass_access read_third;
+	read_third.read_textures = { "Third" };
+	sequential_allocator.add_technique({ overwrite_second, read_second, overwrite_third, read_third });
+	const auto aliases = sequential_allocator.allocate();
+	CHECK(aliases.size() == 1 && aliases[0].first == "Third" && aliases[0].second == "Second");
+	CHECK(sequential_allocator.saved_memory_size() == texture_memory_size(third));
+}
+
+TEST_CASE(dead_pass_analysis_culls_unused_outputs)
+{
+	dead_pass_analysis analysis;
+	// A debug pass renders to a texture nothing samples, in between a blur that ends on the back buffer
+	analysis.add_technique({ texture_pass({}, { "Blur" }), texture_pass({}, { "Debug" }), texture_pass({ "Blur" }, {}) });
+
+	const auto culled = analysis.resolve();
+	CHECK(culled.size() == 1);
+	CHECK(culled[0] == std::vector<bool>({ false, true, false }));
+}
+
+TEST_CASE(dead_pass_analysis_culls_chains)
+{
+	dead_pass_analysis analysis;
+	// Culling the last pass of a chain that does not end on the back buffer leaves the passes producing its inputs without consumers too
+	analysis.add_technique({ texture_pass({}, { "A" }), texture_pass({ "A" }, { "B" }), texture_pass({ "B" }, { "C" }) });
+	// A compute pass writing to a texture that is not sampled anywhere
+	pass_access compute = texture_pass({ "A" }, { "D" });
+	compute.is_compute = true;
+	analysis.add_technique({ compute });
+
+	const auto culled = analysis.resolve();
+	CHECK(culled[0] == std::vector<bool>({ true, true, true }));
+	CHECK(culled[1] == std::vector<bool>({ true }));
+}
+
+TEST_CASE(dead_pass_analysis_keeps_storage_inputs)
+{
+	// A compute pass accesses the output of the pass before it through a storage object (and may read it that way), then writes a texture that is sampled on the way to the back buffer
+	pass_access compute;
+	compute.is_compute = true;
+	compute.written_textures = { "A", "B" };
+	compute.storage_textures = { "A", "B" };
+	// Another compute pass only accesses a texture nothing else uses, which does not keep it alive by itself
+	pass_access unused_compute;
+	unused_compute.is_compute = true;
+	unused_compute.written_textures = { "C" };
+	unused_compute.storage_textures = { "C" };
+
+	dead_pass_analysis analysis;
+	analysis.add_technique({ texture_pass({}, { "A" }), compute, texture_pass({ "B" }, {}), unused_compute });
+
+	const auto culled = analysis.resolve();
+	CHECK(culled[0] == std::vector<bool>({ false, false, false, true }));
+}
+
+TEST_CASE(analyze_pass_access_storage)
+{
+	module module;
+	CHECK(compile_hlsl(R"(
+		texture StorageTex { Width = 64; Height = 64; Format = RGBA8; };
+		storage Storage { Texture = StorageTex; };
+
+		void MainCS(uint3 id : SV_DispatchThreadID)
+		{
+			tex2Dstore(Storage, id.xy, float4(1.0, 0.0, 0.0, 1.0));
+		}
+
+		technique Main { pass { ComputeShader = MainCS<8, 8>; DispatchSizeX = 8; DispatchSizeY = 8; } }
+	)", module));
+
+	const pass_access access = analyze_pass_access(module, module.techniques[0].passes[0]);
+	CHECK(access.is_compute);
+	CHECK(access.storage_textures == std::vector<std::string>({ "V__StorageTex" }));
+	CHECK(access.written_textures == access.storage_textures);
+	CHECK(access.overwritten_textures.empty());
+}
+
+TEST_CASE(dead_pass_analysis_keeps_cross_technique_outputs)
+{
+	dead_pass_analysis analysis;
+	// A texture sampled by a later technique (or by an earlier one, in the next frame) keeps the pass writing it alive
+	analysis.add_technique({ texture_pass({ "History" }, {}) });
+	analysis.add_technique({ texture_pass({}, { "Shared" }) });
+	analysis.add_technique({ texture_pass({ "Shared" }, {}), texture_pass({}, { "History" }) });
+
+	const auto culled = analysis.resolve();
+	CHECK(culled[0] == std::vector<bool>({ false }));
+	CHECK(culled[1] == std::vector<bool>({ false }));
+	CHECK(culled[2] == std::vector<bool>({ false, false }));
+}
+
+TEST_CASE(texture_barrier_planner_merges_transitions)
+{
+	texture_barrier_planner planner;
+
+	// Rendering to a texture and then sampling it needs a transition in each direction
+	planner.require(texture_pass({}, { "Blur" }));
+	auto barriers = planner.flush();
+	CHECK(barriers.size() == 1 && barriers[0].texture_name == "Blur" && barriers[0].old_usage == texture_usage::shader_resource && barriers[0].new_usage == texture_usage::render_target);
+
+	// Rendering to the same texture again does not need any transition
+	planner.require(texture_pass({}, { "Blur" }));
+	CHECK(planner.flush().empty());
+
+	// Multiple requests before a flush are merged into a single transition from the current to the last requested usage
+	planner.require("Blur", texture_usage::shader_resource);
+	planner.require("Blur", texture_usage::unordered_access);
+	barriers = planner.flush();
+	CHECK(barriers.size() == 1 && barriers[0].old_usage == texture_usage::render_target && barriers[0].new_usage == texture_usage::unordered_access);
+
+	planner.require(texture_pass({ "Blur" }, {}));
+	barriers = planner.flush();
+	CHECK(barriers.size() == 1 && barriers[0].old_usage == texture_usage::unordered_access && barriers[0].new_usage == texture_usage::shader_resource);
+
+	// Textures are in the shader resource state already, so sampling them needs no transition
+	planner.require(texture_pass({ "Blur", "Noise" }, {}));
+	CHECK(planner.flush().empty());
+}
+
+TEST_CASE(texture_barrier_planner_unordered_access)
+{
+	texture_barrier_planner planner;
+
+	pass_access compute = texture_pass({}, { "Histogram" });
+	compute.is_compute = true;
+
+	planner.require(compute);
+	auto barriers = planner.flush();
+	CHECK(barriers.size() == 1 && barriers[0].new_usage == texture_usage::unordered_access);
+
+	// Successive compute passes writing the same texture still need a barrier, so that the second one sees the writes of the first
+	planner.require(compute);
+	barriers = planner.flush();
+	CHECK(barriers.size() == 1 && barriers[0].old_usage == texture_usage::unordered_access && barriers[0].new_usage == texture_usage::unordered_access);
+}
+
+TEST_CASE(texture_barrier_planner_finish)
+{
+	texture_barrier_planner planner;
+	planner.require(texture_pass({}, { "A", "B" }));
+	planner.flush();
+	planner.require(texture_pass({ "A" }, {}));
+	planner.flush();
+
+	// Only textures that are not in the shader resource state yet are transitioned back at the end of the frame
+	auto barriers = planner.finish();
+	CHECK(barriers.size() == 1 && barriers[0].texture_name == "B" && barriers[0].old_usage == texture_usage::render_target && barriers[0].new_usage == texture_usage::shader_resource);
+	CHECK(planner.finish().empty());
+}
+
+TEST_CASE(find_pass_fusion_candidates_same_texel_chain)
+{
+	module module;
+	CHECK(compile_hlsl(R"(
+		texture ColorTex : COLOR;
+		sampler ColorSampler { Texture = ColorTex; };
+		texture GradedTex { Width = 1920; Height = 1080; };
+		sampler GradedSampler { Texture = GradedTex; };
+		texture BloomTex { Width = 1920; Height = 1080; };
+		sampler BloomSampler { Texture = BloomTex; };
+
+		void PostProcessVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		}
+
+		float4 GradePS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(ColorSampler, texcoord) * 1.1; }
+		float4 VignettePS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(GradedSampler, texcoord) * (1.0 - length(texcoord - 0.5)); }
+		float4 BloomPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(ColorSampler, texcoord); }
+		float4 BlurPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(BloomSampler, texcoord + float2(0.001, 0.0)); }
+
+		technique Vignette { pass { VertexShader = PostProcessVS; PixelShader = GradePS; RenderTarget = GradedTex; } pass { VertexShader = PostProcessVS; PixelShader = VignettePS; } }
+		technique Bloom { pass { VertexShader = PostProcessVS; PixelShader = BloomPS; RenderTarget = BloomTex; } pass { VertexShader = PostProcessVS; PixelShader = BlurPS; } }
+	)", module));
+
+	// Only the first technique samples the intermediate texture at the unmodified texture coordinate
+	const auto candidates = find_pass_fusion_candidates(module, 1920, 1080);
+	CHECK(candidates.size() == 1);
+	CHECK(candidates[0].technique_index == 0 && candidates[0].pass_index == 0 && candidates[0].texture_name == "V__GradedTex");
+
+	// A different buffer size would make the back buffer sized pass cover other texels than the texture
+	CHECK(find_pass_fusion_candidates(module, 2560, 1440).empty());
+}
+
+TEST_CASE(memory_footprint_calculator_splits_shared_resources)
+{
+	const char *const common_source = R"(
+		texture ColorTex : COLOR;
+		sampler ColorSampler { Texture = ColorTex; };
+		texture SharedTex { Width = 1920; Height = 1080; Format = RGBA8; };
+		sampler SharedSampler { Texture = SharedTex; };
+
+		void PostProcessVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		}
+		float4 CopyPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(ColorSampler, texcoord); }
+		float4 SharedPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(SharedSampler, texcoord); }
+	)";
+
+	module first, second;
+	CHECK(compile_hlsl(std::string(common_source) + R"(
+		uniform float4 Tint = 1.0;
+		texture MaskTex { Width = 100; Height = 100; Format = R8; };
+		float4 TintPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return Tint; }
+
+		technique Copy { pass { VertexShader = PostProcessVS; PixelShader = CopyPS; RenderTarget = SharedTex; } pass { VertexShader = PostProcessVS; PixelShader = SharedPS; } }
+		technique Mask { pass { VertexShader = PostProcessVS; PixelShader = TintPS; RenderTarget = MaskTex; } }
+	)", first));
+	CHECK(compile_hlsl(std::string(common_source) + R"(
+		technique Show { pass { VertexShader = PostProcessVS; PixelShader = SharedPS; } }
+	)", second));
+
+	const size_t back_buffer_size = 1920 * 1080 * 4;
+	const size_t depth_buffer_size = 1920 * 1080 * 4;
+	memory_footprint_calculator calculator(back_buffer_size, depth_buffer_size);
+	calculator.add_effect(first);
+	calculator.add_effect(second);
+
+	std::vector<memory_footprint> effects;
+	std::vector<std::vector<memory_footprint>> techniques;
+	calculator.resolve(effects, techniques);
+	CHECK(effects.size() == 2 && techniques.size() == 2 && techniques[0].size() == 2 && techniques[1].size() == 1);
+
+	// The pooled texture and the back buffer copy are split between both effects, so that the footprints add up to the total
+	const size_t shared_size = 1920 * 1080 * 4;
+	CHECK(effects[0].texture_memory_size == shared_size / 2 + 100 * 100);
+	CHECK(effects[1].texture_memory_size == shared_size / 2);
+	CHECK(effects[0].buffer_copy_memory_size == back_buffer_size / 2);
+	CHECK(effects[1].buffer_copy_memory_size == back_buffer_size / 2);
+	CHECK(effects[0].total() + effects[1].total() == shared_size + 100 * 100 + back_buffer_size + first.total_uniform_size + second.total_uniform_size);
+
+	// Techniques only account for the resources their passes access (and the second effect declares the back buffer texture, but never samples it)
+	CHECK(techniques[0][0].texture_memory_size == shared_size / 2);
+	CHECK(techniques[0][0].buffer_copy_memory_size == back_buffer_size);
+	CHECK(techniques[0][1].texture_memory_size == 100 * 100);
+	CHECK(techniques[0][1].buffer_copy_memory_size == 0);
+	CHECK(techniques[1][0].texture_memory_size == shared_size / 2);
+	CHECK(techniques[1][0].buffer_copy_memory_size == 0);
+
+	// All techniques of an effect share its uniform buffer
+	CHECK(first.total_uniform_size != 0);
+	CHECK(effects[0].uniform_memory_size == first.total_uniform_size);
+	CHECK(techniques[0][0].uniform_memory_size == first.total_uniform_size / 2);
+}
+
+TEST_CASE(texture_memory_size_includes_mipmaps)
+{
+	texture_info texture = make_texture("Texture");
+	texture.width = 256;
+	texture.height = 64;
+	texture.levels = 9;
+	texture.format = texture_format::rgba16f;
+
+	// Mipmap levels stop shrinking in a dimension once it reaches one pixel
+	size_t expected_size = 0;
+	for (uint32_t width = 256, height = 64, level = 0; level < 9; ++level, width = width > 1 ? width / 2 : 1, height = height > 1 ? height / 2 : 1)
+		expected_size += width * height * 8;
+	CHECK(texture_memory_size(texture) == expected_size);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "effect_preprocessor.hpp"
+#include <algorithm>
+
+using namespace reshadefx;
+
+static bool is_referenced(const preprocessor &pp, const std::string &name)
+{
+	const std::vector<std::string> names = pp.referenced_macros();
+	return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+TEST_CASE(preprocessor_references_identifiers_in_code)
+{
+	// Defining a macro with the name of an identifier used in code changes the output, even if there was no such macro before
+	preprocessor pp;
+	pp.add_macro_definition("SCALE", "2.0");
+	CHECK(pp.append_string(
+		"float4 main() : SV_Target { return UNDEFINED_VALUE * SCALE; }\n"));
+
+	CHECK(is_referenced(pp, "UNDEFINED_VALUE"));
+	CHECK(is_referenced(pp, "SCALE"));
+	CHECK(is_referenced(pp, "main"));
+	CHECK(!is_referenced(pp, "NEVER_USED"));
+
+	// The list is sorted, so that it can be compared and stored as is
+	const std::vector<std::string> names = pp.referenced_macros();
+	CHECK(std::is_sorted(names.begin(), names.end()));
+}
+
+TEST_CASE(preprocessor_references_defined_in_conditions)
+{
+	preprocessor pp;
+	pp.add_macro_definition("ENABLED");
+	CHECK(pp.append_string(
+		"#if defined(ENABLED) && !defined MISSING\n"
+		"float a;\n"
+		"#endif\n"
+		"#if ENABLED_LEVEL > 1\n"
+		"float b;\n"
+		"#endif\n"));
+
+	CHECK(is_referenced(pp, "ENABLED"));
+	CHECK(is_referenced(pp, "MISSING"));
+	CHECK(is_referenced(pp, "ENABLED_LEVEL"));
+	CHECK(!is_referenced(pp, "defined"));
+}
+
+TEST_CASE(preprocessor_ignores_skipped_blocks)
+{
+	// Nothing in a block that is skipped is evaluated, so no macro there can affect the output (until the condition of the block changes, which references its own macros)
+	preprocessor pp;
+	CHECK(pp.append_string(
+		"#ifdef OUTER\n"
+		"#ifdef INNER_IFDEF\n"
+		"#endif\n"
+		"#ifndef INNER_IFNDEF\n"
+		"#endif\n"
+		"#if defined(INNER_IF)\n"
+		"#endif\n"
+		"#define INNER_DEFINE 1\n"
+		"float value = INNER_CODE;\n"
+		"#endif\n"
+		"#if 1\n"
+		"#elif AFTER_TAKEN_BRANCH\n"
+		"#endif\n"
+		"#if 0\n"
+		"#elif BEFORE_TAKEN_BRANCH\n"
+		"#endif\n"));
+
+	CHECK(is_referenced(pp, "OUTER"));
+	CHECK(!is_referenced(pp, "INNER_IFDEF"));
+	CHECK(!is_referenced(pp, "INNER_IFNDEF"));
+	CHECK(!is_referenced(pp, "INNER_IF"));
+	CHECK(!is_referenced(pp, "INNER_DEFINE"));
+	CHECK(!is_referenced(pp, "INNER_CODE"));
+
+	// Same for an #elif after a branch that was taken already
+	CHECK(!is_referenced(pp, "AFTER_TAKEN_BRANCH"));
+	CHECK(is_referenced(pp, "BEFORE_TAKEN_BRANCH"));
+}
+
+TEST_CASE(preprocessor_references_define_and_undef)
+{
+	// Whether a '#define' is a redefinition and what '#undef' removes depends on the macros defined from outside
+	preprocessor pp;
+	CHECK(pp.append_string(
+		"#define LOCAL_VALUE 1\n"
+		"#undef EXTERNAL_VALUE\n"));
+
+	CHECK(is_referenced(pp, "LOCAL_VALUE"));
+	CHECK(is_referenced(pp, "EXTERNAL_VALUE"));
+
+	// A macro that is only referenced in its own definition is still listed once
+	const std::vector<std::string> names = pp.referenced_macros();
+	CHECK(std::count(names.begin(), names.end(), "LOCAL_VALUE") == 1);
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_serialization.hpp"
+#include <memory>
+#include <cstring>
+
+using namespace reshadefx;
+
+static bool compile_hlsl(const std::string &source, unsigned int shader_model, bool uniforms_to_spec_constants, module &module)
+{
+	const std::unique_ptr<codegen> codegen(create_codegen_hlsl(shader_model, false, uniforms_to_spec_constants));
+
+	parser parser;
+	if (!parser.parse(source, codegen.get()))
+		return false;
+
+	codegen->write_result(module);
+	return true;
+}
+
+// Everything is written member by member, so writing the restored module again has to give the exact same data if nothing was lost
+// (this relies on 'minified_names' being empty, since the order of an unordered map is not stable)
+static bool round_trip(const module &original, module &restored)
+{
+	std::string data;
+	serialize_module(original, data);
+	if (!deserialize_module(data, restored))
+		return false;
+
+	std::string restored_data;
+	serialize_module(restored, restored_data);
+	return restored_data == data;
+}
+
+TEST_CASE(serialization_round_trip)
+{
+	const char *const source = R"(
+		uniform float Strength < ui_type = "slider"; ui_min = 0.0; ui_max = 1.0; ui_label = "Strength"; > = 0.5;
+		uniform int Mode < ui_type = "combo"; ui_items = "First\0Second\0"; > = 1;
+		uniform float Timer < source = "timer"; >;
+
+		texture ColorTex : COLOR;
+		sampler ColorSampler { Texture = ColorTex; SRGBTexture = true; };
+		texture StorageTex < pooled = true; > { Width = 256; Height = 128; Format = RGBA16F; };
+		sampler StorageSampler { Texture = StorageTex; AddressU = MIRROR; MagFilter = POINT; };
+		storage StorageTexStorage { Texture = StorageTex; };
+
+		void MainVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+		}
+
+		void MainCS(uint3 id : SV_DispatchThreadID)
+		{
+			tex2Dstore(StorageTexStorage, id.xy, float4(Strength, Mode, frac(Timer), 1.0));
+		}
+
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			return tex2D(ColorSampler, texcoord) * tex2D(StorageSampler, texcoord);
+		}
+
+		technique Main < ui_tooltip = "Round trip"; enabled = true; >
+		{
+			pass { ComputeShader = MainCS<8, 8>; DispatchSizeX = 32; DispatchSizeY = 16; }
+			pass { VertexShader = MainVS; PixelShader = MainPS; BlendEnable = true; DestBlend = INVSRCALPHA; }
+		}
+	)";
+
+	module original;
+	CHECK(compile_hlsl(source, 50, true, original));
+	CHECK(original.textures.size() == 2);
+	CHECK(original.samplers.size() == 2);
+	CHECK(original.storages.size() == 1);
+	CHECK(!original.spec_constants.empty());
+	CHECK(!original.textures[1].annotations.empty());
+	CHECK(!original.techniques[0].annotations.empty());
+	CHECK(original.minified_names.empty());
+
+	module restored;
+	CHECK(round_trip(original, restored));
+
+	CHECK(restored.hlsl == original.hlsl);
+	CHECK(restored.textures[1].unique_name == original.textures[1].unique_name);
+	CHECK(restored.textures[1].width == 256 && restored.textures[1].height == 128);
+	CHECK(restored.textures[1].annotations[0].name == "pooled");
+	CHECK(restored.samplers[0].srgb);
+	CHECK(restored.samplers[1].address_u == original.samplers[1].address_u);
+	CHECK(restored.storages[0].texture_name == original.storages[0].texture_name);
+	CHECK(restored.spec_constants.size() == original.spec_constants.size());
+	CHECK(restored.spec_constants[0].name == "Strength");
+	CHECK(restored.spec_constants[0].initializer_value.as_float[0] == 0.5f);
+	CHECK(restored.uniforms.size() == original.uniforms.size());
+	CHECK(restored.techniques[0].passes.size() == 2);
+	CHECK(restored.techniques[0].passes[0].cs_entry_point == original.techniques[0].passes[0].cs_entry_point);
+	CHECK(restored.techniques[0].passes[1].blend_enable);
+	CHECK(restored.techniques[0].passes[1].dest_blend == original.techniques[0].passes[1].dest_blend);
+	CHECK(restored.techniques[0].annotations.size() == original.techniques[0].annotations.size());
+	CHECK(restored.total_uniform_size == original.total_uniform_size);
+	CHECK(restored.per_frame_uniform_offset == original.per_frame_uniform_offset);
+	CHECK(restored.num_storage_bindings == original.num_storage_bindings);
+}
+
+TEST_CASE(serialization_round_trip_sm3_registers)
+{
+	// The vertex shader only reads the first uniform and the pixel shader only the second, so they get different register ranges
+	const char *const source = R"(
+		uniform float2 Offset = float2(0.1, 0.2);
+		uniform float4 Tint = float4(1.0, 0.9, 0.8, 1.0);
+
+		void MainVS(in uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+		{
+			texcoord.x = (id == 2) ? 2.0 : 0.0;
+			texcoord.y = (id == 1) ? 2.0 : 0.0;
+			position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0) + Offset, 0.0, 1.0);
+		}
+
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+		{
+			return Tint;
+		}
+
+		technique Main { pass { VertexShader = MainVS; PixelShader = MainPS; } }
+	)";
+
+	module original;
+	CHECK(compile_hlsl(source, 30, false, original));
+
+	module restored;
+	CHECK(round_trip(original, restored));
+
+	CHECK(restored.entry_points.size() == original.entry_points.size());
+	bool has_register_range = false;
+	for (size_t i = 0; i < original.entry_points.size(); ++i)
+	{
+		CHECK(restored.entry_points[i].name == original.entry_points[i].name);
+		CHECK(restored.entry_points[i].first_constant_register == original.entry_points[i].first_constant_register);
+		CHECK(restored.entry_points[i].num_constant_registers == original.entry_points[i].num_constant_registers);
+		has_register_range |= original.entry_points[i].first_constant_register != 0;
+	}
+	CHECK(has_register_range);
+}
+
+TEST_CASE(serialization_rejects_truncated_data)
+{
+	const char *const source = R"(
+		texture ColorTex : COLOR;
+		sampler ColorSampler { Texture = ColorTex; };
+		float4 MainPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(ColorSampler, texcoord); }
+		technique Main { pass { VertexShader = MainPS; PixelShader = MainPS; } }
+	)";
+
+	module original;
+	CHECK(compile_hlsl(source, 50, false, original));
+
+	std::string data;
+	serialize_module(original, data);
+
+	// Cutting off the data anywhere has to be detected, no matter which structure it ends up in the middle of
+	for (size_t size = 0; size < data.size(); ++size)
+	{
+		module restored;
+		CHECK(!deserialize_module(std::string_view(data.data(), size), restored));
+	}
+
+	// Same for data that was appended
+	module restored;
+	CHECK(!deserialize_module(data + '\0', restored));
+}
+
+TEST_CASE(serialization_rejects_other_version)
+{
+	module original;
+	original.hlsl = "float4 main() : SV_Target { return 0; }";
+
+	std::string data;
+	serialize_module(original, data);
+
+	module restored;
+	CHECK(deserialize_module(data, restored));
+
+	// The version follows the magic number at the start of the data
+	uint32_t version = 0;
+	std::memcpy(&version, data.data() + sizeof(uint32_t), sizeof(version));
+	CHECK(version == module_serialization_version);
+
+	for (const uint32_t other_version : { module_serialization_version - 1, module_serialization_version + 1 })
+	{
+		std::string other_data = data;
+		std::memcpy(other_data.data() + sizeof(uint32_t), &other_version, sizeof(other_version));
+
+		module other_restored;
+		CHECK(!deserialize_module(other_data, other_restored));
+	}
+
+	// And data that is not a module at all
+	std::string other_data = data;
+	other_data[0] ^= 0xFF;
+	CHECK(!deserialize_module(other_data, restored));
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "file_index.hpp"
+#include <fstream>
+
+using namespace reshade;
+using reshade::test::temporary_directory;
+
+TEST_CASE(file_index_hash_contents_outside_index)
+{
+	temporary_directory directory("file_index");
+	std::filesystem::create_directory(directory.path() / "Subdirectory");
+	std::ofstream(directory.path() / "Common.fxh") << "// Common\n";
+	std::ofstream(directory.path() / "Subdirectory" / "Common.fxh") << "// Common\n";
+
+	file_index files;
+	files.add_directory(directory.path());
+
+	// Files in the index and files that are read directly result in the same hash for the same contents
+	content_hash indexed_hash, hash;
+	CHECK(files.hash_contents(directory.path() / "Common.fxh", indexed_hash));
+	CHECK(files.hash_contents(directory.path() / "Subdirectory" / "Common.fxh", hash));
+	CHECK(indexed_hash == hash);
+
+	// Files outside the index are read every time, so modifications are noticed
+	std::ofstream(directory.path() / "Subdirectory" / "Common.fxh") << "// Modified\n";
+	CHECK(files.hash_contents(directory.path() / "Subdirectory" / "Common.fxh", hash));
+	CHECK(indexed_hash != hash);
+
+	CHECK(!files.hash_contents(directory.path() / "Missing.fxh", hash));
+	CHECK(!files.hash_contents(directory.path() / "Subdirectory" / "Missing.fxh", hash));
+}
+
+TEST_CASE(file_hashes_detect_modified_includes)
+{
+	temporary_directory directory("file_hashes");
+	std::filesystem::create_directory(directory.path() / "Subdirectory");
+	const std::vector<std::filesystem::path> included_files = { directory.path() / "Common.fxh", directory.path() / "Subdirectory" / "Nested.fxh" };
+	std::ofstream(included_files[0]) << "#include \"Subdirectory/Nested.fxh\"\n";
+	std::ofstream(included_files[1]) << "// Nested\n";
+
+	std::string manifest;
+	{
+		file_index files;
+		files.add_directory(directory.path());
+		CHECK(format_file_hashes(files, included_files, manifest));
+
+		std::vector<std::filesystem::path> paths;
+		CHECK(check_file_hashes(files, manifest, paths));
+		CHECK(paths == included_files);
+	}
+
+	// A nested include is modified, which does not change the files directly in the include path
+	std::ofstream(included_files[1]) << "// Modified\n";
+	{
+		file_index files;
+		files.add_directory(directory.path());
+
+		std::vector<std::filesystem::path> paths;
+		CHECK(!check_file_hashes(files, manifest, paths));
+	}
+
+	// An include is deleted
+	std::ofstream(included_files[1]) << "// Nested\n";
+	std::filesystem::remove(included_files[0]);
+	{
+		file_index files;
+		files.add_directory(directory.path());
+
+		std::vector<std::filesystem::path> paths;
+		CHECK(!check_file_hashes(files, manifest, paths));
+
+		// Missing files cannot be hashed in the first place
+		CHECK(!format_file_hashes(files, included_files, manifest));
+	}
+}
+
+TEST_CASE(file_hashes_malformed)
+{
+	file_index files;
+	std::vector<std::filesystem::path> paths;
+
+	// An empty list is valid, for effects that do not include any files
+	std::string manifest;
+	CHECK(format_file_hashes(files, {}, manifest) && manifest.empty());
+	CHECK(check_file_hashes(files, manifest, paths) && paths.empty());
+
+	CHECK(!check_file_hashes(files, "0123", paths));
+	CHECK(!check_file_hashes(files, "00000000000000000000000000000000 /Common.fxh", paths)); // Missing line feed
+	CHECK(!check_file_hashes(files, "00000000000000000000000000000000_/Common.fxh\n", paths));
+}
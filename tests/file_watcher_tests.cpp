@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "file_watcher.hpp"
+#include <chrono>
+#include <thread>
+#include <fstream>
+
+using namespace reshade;
+using reshade::test::temporary_directory;
+
+// Notifications arrive asynchronously, so check repeatedly until there are any (or a timeout is reached)
+static std::vector<std::filesystem::path> wait_for_modifications(file_watcher &watcher)
+{
+	std::vector<std::filesystem::path> modifications;
+	for (int i = 0; i < 100 && !watcher.check(modifications); ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	return modifications;
+}
+
+TEST_CASE(is_affected_by_modifications_source_and_includes)
+{
+	const std::filesystem::path source_file = "/shaders/Effect.fx";
+	const std::vector<std::filesystem::path> included_files = { "/shaders/ReShade.fxh", "/other/Common.fxh" };
+
+	CHECK(is_affected_by_modifications(source_file, included_files, { "/shaders/Effect.fx" }));
+	CHECK(is_affected_by_modifications(source_file, included_files, { "/textures/Noise.png", "/other/Common.fxh" }));
+	// Paths are compared after normalization, since the watched directories and the included files may be spelled differently
+	CHECK(is_affected_by_modifications(source_file, included_files, { "/shaders/./../other/Common.fxh" }));
+
+	CHECK(!is_affected_by_modifications(source_file, included_files, {}));
+	CHECK(!is_affected_by_modifications(source_file, included_files, { "/shaders/Other.fx", "/shaders/Other.fxh" }));
+}
+
+TEST_CASE(is_affected_by_modifications_unknown_includes)
+{
+	// Effects whose included files are not known are assumed to include every header, but not other effects
+	CHECK(is_affected_by_modifications("/shaders/Effect.fx", {}, { "/shaders/Any.fxh" }));
+	CHECK(!is_affected_by_modifications("/shaders/Effect.fx", {}, { "/shaders/Other.fx" }));
+}
+
+TEST_CASE(file_watcher_reports_modified_files)
+{
+	temporary_directory directory("file_watcher");
+	const std::filesystem::path effect_file = directory.path() / "Effect.fx";
+	const std::filesystem::path header_file = directory.path() / "Common.fxh";
+	std::ofstream(effect_file) << "#include \"Common.fxh\"\n";
+	std::ofstream(header_file) << "// Common\n";
+
+	file_watcher watcher({ directory.path() });
+
+	std::vector<std::filesystem::path> modifications;
+	CHECK(!watcher.check(modifications));
+
+	// Writing a file multiple times only reports it once
+	std::ofstream(header_file) << "// Modified\n";
+	std::ofstream(header_file, std::ios::app) << "// Modified again\n";
+
+	modifications = wait_for_modifications(watcher);
+	CHECK(modifications.size() == 1 && modifications[0] == header_file);
+	CHECK(is_affected_by_modifications(effect_file, { header_file }, modifications));
+	CHECK(!is_affected_by_modifications(directory.path() / "Other.fx", { directory.path() / "Other.fxh" }, modifications));
+
+	// Changes are only reported once
+	CHECK(!watcher.check(modifications));
+}
+
+TEST_CASE(file_watcher_reports_renamed_files)
+{
+	temporary_directory directory("file_watcher_rename");
+	std::filesystem::create_directory(directory.path() / "Subdirectory");
+
+	file_watcher watcher({ directory.path() });
+
+	// Editors often save to a temporary file and rename it afterwards, which counts as a modification of the file with the new name
+	std::ofstream(directory.path() / "Effect.fx.tmp") << "// Saved\n";
+	wait_for_modifications(watcher);
+	std::filesystem::rename(directory.path() / "Effect.fx.tmp", directory.path() / "Effect.fx");
+
+	std::vector<std::filesystem::path> modifications = wait_for_modifications(watcher);
+	CHECK(modifications.size() == 1 && modifications[0] == directory.path() / "Effect.fx");
+
+	// Subdirectories are not watched
+	std::ofstream(directory.path() / "Subdirectory" / "Effect.fx") << "// Saved\n";
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	CHECK(!watcher.check(modifications));
+}
+
+TEST_CASE(file_watcher_missing_directory)
+{
+	// Directories that cannot be watched are skipped
+	file_watcher watcher({ std::filesystem::temp_directory_path() / "reshade_file_watcher_does_not_exist" });
+
+	std::vector<std::filesystem::path> modifications;
+	CHECK(!watcher.check(modifications));
+}
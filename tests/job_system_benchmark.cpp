@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+// Stress test for the job system, which reports how long it takes to work through large numbers of small jobs:
+// - "throughput": several threads submit jobs of all priorities at once, each with a continuation
+// - "reloads": repeated batches of work, either by creating a set of threads for every batch (like effect reloads used to) or by submitting the same number of jobs
+// - "cancellation": a long queue of jobs that is cancelled right after it was submitted
+
+#include "job_system.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+using namespace reshade;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start_time)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count() / 1000.0;
+}
+
+// Some work that the compiler cannot optimize away, to stand in for a small job
+static void spin(std::atomic<uint64_t> &sink, unsigned int iterations)
+{
+	uint64_t value = iterations;
+	for (unsigned int i = 0; i < iterations; ++i)
+		value = value * 6364136223846793005ull + 1442695040888963407ull;
+	sink += value;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t num_threads = 0;
+	size_t num_jobs = 200000;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (0 == std::strcmp(argv[i], "--threads") && i + 1 < argc)
+			num_threads = std::strtoul(argv[++i], nullptr, 10);
+		else if (0 == std::strcmp(argv[i], "--jobs") && i + 1 < argc)
+			num_jobs = std::max<size_t>(std::strtoul(argv[++i], nullptr, 10), 100);
+		else
+		{
+			std::printf("usage: job_system_benchmark [--threads <count>] [--jobs <count>]\n");
+			return 1;
+		}
+	}
+
+	job_system jobs(num_threads);
+	std::atomic<uint64_t> sink = 0;
+	bool success = true;
+
+	std::printf("%zu worker threads on %u hardware threads\n", jobs.num_threads(), std::thread::hardware_concurrency());
+
+	{
+		const size_t num_producers = 4;
+		std::atomic<size_t> num_executed = 0;
+
+		const auto start_time = std::chrono::steady_clock::now();
+
+		std::vector<std::thread> producers;
+		for (size_t producer = 0; producer < num_producers; ++producer)
+			producers.emplace_back([&jobs, &sink, &num_executed, num_jobs, num_producers]() {
+				for (size_t i = 0; i < num_jobs / num_producers / 2; ++i)
+				{
+					const auto job = jobs.submit([&sink, &num_executed]() { spin(sink, 100); num_executed++; }, static_cast<job_system::priority>(i % 3));
+					jobs.then(job, [&sink, &num_executed]() { spin(sink, 100); num_executed++; });
+				}
+			});
+		for (std::thread &producer : producers)
+			producer.join();
+
+		jobs.wait_idle();
+
+		const double duration = elapsed_ms(start_time);
+		const size_t num_expected = num_jobs / num_producers / 2 * 2 * num_producers;
+		std::printf("throughput: %zu jobs from %zu threads in %.1f ms (%.0f jobs per second)\n", num_executed.load(), num_producers, duration, num_executed * 1000.0 / duration);
+
+		if (num_executed != num_expected)
+			success = false, std::printf("error: expected %zu jobs to be executed\n", num_expected);
+	}
+
+	{
+		const size_t num_reloads = 200;
+		const size_t num_items = 50;
+		const size_t num_reload_threads = std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1;
+
+		auto start_time = std::chrono::steady_clock::now();
+		for (size_t reload = 0; reload < num_reloads; ++reload)
+		{
+			std::atomic<size_t> next_item = 0;
+			std::vector<std::thread> threads;
+			for (size_t n = 0; n < num_reload_threads; ++n)
+				threads.emplace_back([&sink, &next_item]() {
+					while (next_item.fetch_add(1) < num_items)
+						spin(sink, 1000);
+				});
+			for (std::thread &thread : threads)
+				thread.join();
+		}
+		const double thread_duration = elapsed_ms(start_time);
+
+		start_time = std::chrono::steady_clock::now();
+		for (size_t reload = 0; reload < num_reloads; ++reload)
+		{
+			std::atomic<size_t> next_item = 0;
+			for (size_t n = 0; n < num_reload_threads; ++n)
+				jobs.submit([&sink, &next_item]() {
+					while (next_item.fetch_add(1) < num_items)
+						spin(sink, 1000);
+				});
+			jobs.wait_idle();
+		}
+		const double job_duration = elapsed_ms(start_time);
+
+		std::printf("reloads: %zu batches of %zu items in %.1f ms with %zu new threads per batch, %.1f ms with the job system\n", num_reloads, num_items, thread_duration, num_reload_threads, job_duration);
+	}
+
+	{
+		job_system::cancellation_token token;
+		std::atomic<size_t> num_executed = 0;
+
+		const auto start_time = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < num_jobs; ++i)
+			jobs.submit([&sink, &num_executed]() { spin(sink, 1000); num_executed++; }, job_system::priority::low, token);
+		token.cancel();
+		jobs.wait_idle();
+
+		std::printf("cancellation: %zu of %zu jobs executed before cancellation, queue drained after %.1f ms\n", num_executed.load(), num_jobs, elapsed_ms(start_time));
+	}
+
+	return success ? 0 : 1;
+}
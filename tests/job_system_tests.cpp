@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "job_system.hpp"
+#include <chrono>
+
+using namespace reshade;
+
+// Occupies the only worker thread of a job system until it is released, so that the jobs submitted in the meantime stay in the queue
+class blocking_job
+{
+public:
+	explicit blocking_job(job_system &jobs)
+	{
+		_handle = jobs.submit([this]() {
+			std::unique_lock<std::mutex> lock(_mutex);
+			_started = true;
+			_signal.notify_all();
+			_signal.wait(lock, [this]() { return _released; });
+		});
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_signal.wait(lock, [this]() { return _started; });
+	}
+
+	void release()
+	{
+		{	const std::lock_guard<std::mutex> lock(_mutex);
+			_released = true;
+		}
+
+		_signal.notify_all();
+		_handle->wait();
+	}
+
+private:
+	bool _started = false;
+	bool _released = false;
+	std::mutex _mutex;
+	std::condition_variable _signal;
+	job_system::job_handle _handle;
+};
+
+TEST_CASE(job_system_priorities)
+{
+	job_system jobs(1);
+	blocking_job blocker(jobs);
+
+	std::mutex order_mutex;
+	std::vector<int> order;
+	const auto record = [&order_mutex, &order](int value) {
+		return [&order_mutex, &order, value]() {
+			const std::lock_guard<std::mutex> lock(order_mutex);
+			order.push_back(value);
+		};
+	};
+
+	jobs.submit(record(3), job_system::priority::low);
+	jobs.submit(record(2), job_system::priority::normal);
+	jobs.submit(record(0), job_system::priority::high);
+	jobs.submit(record(4), job_system::priority::low);
+	jobs.submit(record(1), job_system::priority::high);
+
+	// Waiting jobs of higher priority start first, jobs of the same priority in the order they were submitted
+	blocker.release();
+	jobs.wait_idle();
+	CHECK(order == std::vector<int>({ 0, 1, 2, 3, 4 }));
+}
+
+TEST_CASE(job_system_continuations)
+{
+	job_system jobs(2);
+
+	std::atomic<int> value = 0;
+	const auto first = jobs.submit([&value]() { value = 1; });
+	const auto second = jobs.then(first, [&value]() { value = value * 10 + 2; });
+	const auto third = jobs.then(second, [&value]() { value = value * 10 + 3; });
+
+	third->wait();
+	CHECK(first->is_done() && second->is_done());
+	CHECK(value == 123);
+
+	// Continuations of jobs that are done already are queued right away
+	const auto fourth = jobs.then(first, [&value]() { value = 4; });
+	fourth->wait();
+	CHECK(value == 4);
+}
+
+TEST_CASE(job_system_cancellation_before_start)
+{
+	job_system jobs(1);
+	blocking_job blocker(jobs);
+
+	job_system::cancellation_token token;
+	bool executed = false, continuation_executed = false;
+	const auto job = jobs.submit([&executed]() { executed = true; }, job_system::priority::normal, token);
+	// Continuations are still queued when their parent is skipped, since they have their own token
+	const auto continuation = jobs.then(job, [&continuation_executed]() { continuation_executed = true; });
+
+	token.cancel();
+	blocker.release();
+	jobs.wait_idle();
+
+	CHECK(job->is_done() && !executed);
+	CHECK(continuation->is_done() && continuation_executed);
+}
+
+TEST_CASE(job_system_cancellation_while_running)
+{
+	job_system jobs(1);
+
+	CHECK(!job_system::is_current_job_cancelled());
+
+	job_system::cancellation_token token;
+	std::atomic<bool> started = false, observed_cancellation = false;
+	const auto job = jobs.submit([&started, &observed_cancellation]() {
+		started = true;
+		// Long running jobs check for cancellation periodically and return early
+		const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (!job_system::is_current_job_cancelled() && std::chrono::steady_clock::now() < timeout)
+			std::this_thread::yield();
+		observed_cancellation = job_system::is_current_job_cancelled();
+	}, job_system::priority::normal, token);
+
+	while (!started)
+		std::this_thread::yield();
+
+	token.cancel();
+	job->wait();
+	CHECK(observed_cancellation);
+
+	// The next job on the same worker thread is not affected by the cancelled token
+	std::atomic<bool> cancelled_in_next_job = true;
+	jobs.submit([&cancelled_in_next_job]() { cancelled_in_next_job = job_system::is_current_job_cancelled(); })->wait();
+	CHECK(!cancelled_in_next_job);
+}
+
+TEST_CASE(job_system_stress)
+{
+	job_system jobs(4);
+
+	// Submit from several threads at once, with a mix of priorities, continuations and cancelled jobs
+	std::atomic<size_t> num_executed = 0;
+	std::vector<std::thread> producers;
+	size_t num_expected = 0;
+	for (size_t producer = 0; producer < 4; ++producer)
+	{
+		num_expected += 2500 + 2500 - 250;
+		producers.emplace_back([&jobs, &num_executed]() {
+			for (size_t i = 0; i < 2500; ++i)
+			{
+				job_system::cancellation_token token;
+				if (i % 10 == 0)
+					token.cancel();
+
+				const auto job = jobs.submit([&num_executed]() { num_executed++; }, static_cast<job_system::priority>(i % 3));
+				jobs.then(job, [&num_executed]() { num_executed++; }, job_system::priority::normal, token);
+			}
+		});
+	}
+
+	for (std::thread &producer : producers)
+		producer.join();
+
+	jobs.wait_idle();
+
+	// Every job ran exactly once, except for the cancelled continuations
+	CHECK(num_executed == num_expected);
+}
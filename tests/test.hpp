@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace reshade::test
+{
+	struct test_case
+	{
+		const char *name;
+		void(*func)();
+	};
+
+	/// <summary>
+	/// Returns the list of all test cases, which they add themselves to during static initialization.
+	/// </summary>
+	std::vector<test_case> &test_cases();
+
+	/// <summary>
+	/// Record a failed check in the test case that is currently running.
+	/// </summary>
+	void report_failure(const char *file, int line, const char *expression);
+
+	struct registration
+	{
+		registration(const char *name, void(*func)()) { test_cases().push_back({ name, func }); }
+	};
+
+	/// <summary>
+	/// A directory with a unique name that is deleted again with all its contents when the test is done.
+	/// </summary>
+	class temporary_directory
+	{
+	public:
+		explicit temporary_directory(const char *name) :
+			_path(std::filesystem::temp_directory_path() / (std::string("reshade_") + name + '_' + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())))
+		{
+			std::filesystem::create_directories(_path);
+		}
+		~temporary_directory()
+		{
+			std::error_code ec;
+			std::filesystem::remove_all(_path, ec);
+		}
+
+		const std::filesystem::path &path() const { return _path; }
+
+	private:
+		std::filesystem::path _path;
+	};
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static const reshade::test::registration name##_registration(#name, &name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) reshade::test::report_failure(__FILE__, __LINE__, #expression); } while (false)
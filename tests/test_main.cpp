@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include <cstdio>
+#include <cstring>
+
+static unsigned int s_num_failures = 0;
+
+std::vector<reshade::test::test_case> &reshade::test::test_cases()
+{
+	static std::vector<test_case> cases;
+	return cases;
+}
+
+void reshade::test::report_failure(const char *file, int line, const char *expression)
+{
+	std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+	s_num_failures++;
+}
+
+int main(int argc, char *argv[])
+{
+	// Only run the test cases whose name starts with the prefix passed on the command line (if any)
+	const char *const prefix = argc > 1 ? argv[1] : "";
+
+	unsigned int num_failed_cases = 0, num_cases = 0;
+	for (const reshade::test::test_case &test_case : reshade::test::test_cases())
+	{
+		if (std::strncmp(test_case.name, prefix, std::strlen(prefix)) != 0)
+			continue;
+
+		const unsigned int num_previous_failures = s_num_failures;
+		test_case.func();
+		num_cases++;
+
+		const bool failed = s_num_failures != num_previous_failures;
+		if (failed)
+			num_failed_cases++;
+
+		std::printf("%s %s\n", failed ? "FAILED" : "passed", test_case.name);
+	}
+
+	std::printf("%u of %u test cases passed\n", num_cases - num_failed_cases, num_cases);
+
+	return num_failed_cases == 0 && num_cases != 0 ? 0 : 1;
+}
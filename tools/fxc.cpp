@@ -6,6 +6,7 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_pass_analysis.hpp"
 #include "version.h"
 #include <cstdlib>
 #include <cstring>
@@ -29,7 +30,12 @@ Options:
 
   --glsl                    Print GLSL code for the previously specified entry point.
   --hlsl                    Print HLSL code for the previously specified entry point.
+  --minify                  Remove unreachable functions and shorten identifiers and whitespace in GLSL code (ignored with -Zi).
   --shader-model <value>    HLSL shader model version. Can be 30, 40, 41, 50, ...
+  --reduced-precision       Use minimum precision types (HLSL shader model 5 and up) or "RelaxedPrecision" (SPIR-V) for values that do not need full precision.
+  --register-map            Print the location of every uniform variable and the constant registers each pass reads from (HLSL shader model 3).
+  --fusion-candidates       Print pairs of consecutive passes that could be fused into one, because the second only reads the output of the first at the same texel (no fused code is generated).
+  --cost-report             Print a static estimate of the texture fetches and arithmetic operations of every entry point and of the work every pass does at the given buffer size.
 
   --width                   Value of the 'BUFFER_WIDTH' preprocessor macro.
   --height                  Value of the 'BUFFER_HEIGHT' preprocessor macro.
@@ -53,6 +59,11 @@ int main(int argc, char *argv[])
 	bool debug_info = false;
 	bool invert_y_axis = false;
 	bool spec_constants = false;
+	bool minify = false;
+	bool reduced_precision = false;
+	bool register_map = false;
+	bool fusion_candidates = false;
+	bool cost_report = false;
 	unsigned int shader_model = 50;
 
 	reshadefx::parser parser;
@@ -101,6 +112,16 @@ int main(int argc, char *argv[])
 				invert_y_axis = true;
 			else if (0 == std::strcmp(arg, "--spec-constants"))
 				spec_constants = true;
+			else if (0 == std::strcmp(arg, "--minify"))
+				minify = true;
+			else if (0 == std::strcmp(arg, "--reduced-precision"))
+				reduced_precision = true;
+			else if (0 == std::strcmp(arg, "--register-map"))
+				register_map = true;
+			else if (0 == std::strcmp(arg, "--fusion-candidates"))
+				fusion_candidates = true;
+			else if (0 == std::strcmp(arg, "--cost-report"))
+				cost_report = true;
 
 			if (i + 1 >= argc)
 				continue;
@@ -160,11 +181,11 @@ int main(int argc, char *argv[])
 
 	std::unique_ptr<reshadefx::codegen> backend;
 	if (print_glsl)
-		backend.reset(reshadefx::create_codegen_glsl(debug_info, spec_constants));
+		backend.reset(reshadefx::create_codegen_glsl(debug_info, spec_constants, false, false, minify));
 	else if (print_hlsl)
-		backend.reset(reshadefx::create_codegen_hlsl(shader_model, debug_info, spec_constants));
+		backend.reset(reshadefx::create_codegen_hlsl(shader_model, debug_info, spec_constants, reduced_precision));
 	else
-		backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, invert_y_axis));
+		backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, false, invert_y_axis, reduced_precision));
 
 	if (!parser.parse(pp.output(), backend.get()))
 	{
@@ -188,5 +209,109 @@ int main(int argc, char *argv[])
 			reinterpret_cast<const char *>(module.spirv.data()), module.spirv.size() * sizeof(uint32_t));
 	}
 
+	// The reports are printed in addition to the generated code (or object file)
+	if (cost_report)
+	{
+		const auto print_shader_cost = [](const reshadefx::shader_cost &cost) {
+			std::cout << cost.texture_fetches << " texture fetches, " << cost.alu_operations << " ALU operations";
+			if (cost.has_unbounded_loops)
+				std::cout << " (loops with unknown iteration count counted once)";
+		};
+
+		std::cout << "// Entry point costs (per invocation, or per thread group for compute shaders):" << std::endl;
+		for (const reshadefx::entry_point &entry_point : module.entry_points)
+		{
+			std::cout << "//   " << entry_point.name << ": ";
+			print_shader_cost(entry_point.cost);
+			std::cout << std::endl;
+		}
+
+		std::cout << "// Pass costs at " << buffer_width << 'x' << buffer_height << ':' << std::endl;
+		for (const reshadefx::technique_info &technique : module.techniques)
+		{
+			for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
+			{
+				const reshadefx::pass_info &pass = technique.passes[pass_index];
+				const reshadefx::pass_cost cost = reshadefx::estimate_pass_cost(module, pass, std::strtoul(buffer_width, nullptr, 10), std::strtoul(buffer_height, nullptr, 10));
+
+				std::cout << "//   " << technique.name << '[' << pass_index << ']';
+				if (!pass.name.empty())
+					std::cout << " (" << pass.name << ')';
+				std::cout << ": " << cost.invocations << (pass.cs_entry_point.empty() ? " pixels, " : " thread groups, ") << cost.texture_fetches << " texture fetches, " << cost.alu_operations << " ALU operations, " << cost.render_target_bandwidth << " bytes render target bandwidth" << std::endl;
+			}
+		}
+	}
+
+	if (fusion_candidates)
+	{
+		const auto print_pass = [&module](size_t technique_index, size_t pass_index) {
+			const reshadefx::pass_info &pass = module.techniques[technique_index].passes[pass_index];
+
+			std::cout << module.techniques[technique_index].name << '[' << pass_index << ']';
+			if (!pass.name.empty())
+				std::cout << " (" << pass.name << ')';
+		};
+
+		const std::vector<reshadefx::pass_fusion_candidate> candidates = reshadefx::find_pass_fusion_candidates(module, std::strtoul(buffer_width, nullptr, 10), std::strtoul(buffer_height, nullptr, 10));
+
+		std::cout << "// Pass fusion candidates (" << candidates.size() << ", not fused):" << std::endl;
+		for (const reshadefx::pass_fusion_candidate &candidate : candidates)
+		{
+			std::cout << "//   ";
+			print_pass(candidate.technique_index, candidate.pass_index);
+			std::cout << " + ";
+			print_pass(candidate.technique_index, candidate.pass_index + 1);
+			std::cout << ": " << (candidate.texture_name.empty() ? "back buffer" : candidate.texture_name) << std::endl;
+		}
+	}
+
+	if (register_map)
+	{
+		const bool constant_registers = print_hlsl && shader_model < 40;
+
+		std::cout << "// Uniform variables (" << module.total_uniform_size << " bytes, updated every frame from offset " << module.per_frame_uniform_offset << "):" << std::endl;
+		for (const reshadefx::uniform_info &info : module.uniforms)
+		{
+			std::cout << "//   " << info.name << ": ";
+			if (constant_registers && info.size < 16 && !info.type.is_array() && !info.type.is_matrix())
+				std::cout << 'c' << info.offset / 16 << '.' << std::string("xyzw").substr((info.offset % 16) / 4, info.size / 4);
+			else if (constant_registers)
+				std::cout << 'c' << info.offset / 16 << "-c" << (info.offset + info.size - 1) / 16;
+			else
+				std::cout << "offset " << info.offset << ", size " << info.size;
+			std::cout << std::endl;
+		}
+
+		if (constant_registers)
+		{
+			const auto print_register_range = [&module](const std::string &entry_point_name) {
+				const auto entry_point = std::find_if(module.entry_points.begin(), module.entry_points.end(),
+					[&entry_point_name](const auto &ep) { return ep.name == entry_point_name; });
+				if (entry_point == module.entry_points.end() || entry_point->num_constant_registers == 0)
+					std::cout << "none";
+				else
+					std::cout << 'c' << entry_point->first_constant_register << "-c" << entry_point->first_constant_register + entry_point->num_constant_registers - 1;
+			};
+
+			std::cout << "// Constant registers read by each pass:" << std::endl;
+			for (const reshadefx::technique_info &technique : module.techniques)
+			{
+				for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
+				{
+					const reshadefx::pass_info &pass = technique.passes[pass_index];
+
+					std::cout << "//   " << technique.name << '[' << pass_index << ']';
+					if (!pass.name.empty())
+						std::cout << " (" << pass.name << ')';
+					std::cout << ": vs ";
+					print_register_range(pass.vs_entry_point);
+					std::cout << ", ps ";
+					print_register_range(pass.ps_entry_point);
+					std::cout << std::endl;
+				}
+			}
+		}
+	}
+
 	return 0;
 }